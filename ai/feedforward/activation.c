@@ -1,10 +1,105 @@
 #include "activation.h"
 
+#include <stdlib.h>
+#include <stdbool.h>
 #include <math.h>
+#include <pthread.h>
+
+/*******************************************
+ *               Local types               *
+ *******************************************/
+// M_PI isn't part of C99
+#define ACT_PI 3.14159265358979323846
+
+// Number of intervals in every lookup table
+#define ACT_TABLE_SIZE 4096
+
+// Samples of a function at ACT_TABLE_SIZE + 1 evenly spaced points between
+//  <min> and <max>, values in between are linearly interpolated.
+typedef struct act_table_s {
+  float min;
+  float max;
+  float scale;
+  float values[ACT_TABLE_SIZE + 1];
+} act_table_t;
+
+/*******************************************
+ *             Local variables             *
+ *******************************************/
+static activation_mode_t defaultMode = activation_mode_exact;
+
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT;
+static act_table_t sigmoidTable;
+static act_table_t tanhTable;
+static act_table_t atanTable;
+static act_table_t softplusTable;
+// Only positive half since it's symmetric
+static act_table_t gaussianTable;
+// One full period, indexed with wrap around
+static act_table_t sinTable;
 
 /*******************************************
  *             Local functions             *
  *******************************************/
+static void fillTable( act_table_t *table, float min, float max, double (*func)( double ) )
+{
+  int i;
+  table->min = min;
+  table->max = max;
+  table->scale = ACT_TABLE_SIZE / (max - min);
+  for( i = 0; i <= ACT_TABLE_SIZE; i++ ) {
+    table->values[i] = (float)func( min + (max - min) * i / (double)ACT_TABLE_SIZE );
+  }
+}
+
+// Values outside of the table are clamped to the first or last entry
+static inline float lookup( const act_table_t *table, float val )
+{
+  if( val <= table->min ) {
+    return table->values[0];
+  }
+  if( val >= table->max ) {
+    return table->values[ACT_TABLE_SIZE];
+  }
+
+  float pos = (val - table->min) * table->scale;
+  int idx = (int)pos;
+  if( idx >= ACT_TABLE_SIZE ) {
+    idx = ACT_TABLE_SIZE - 1;
+  }
+  float frac = pos - idx;
+
+  return table->values[idx] + (table->values[idx+1] - table->values[idx]) * frac;
+}
+
+static double sigmoid( double val )  { return 1.0 / (1.0 + exp(-val)); }
+static double softplus( double val ) { return log1p(exp(val)); }
+static double gaussian( double val ) { return exp(-(val*val)); }
+
+static void initTables( void )
+{
+  fillTable( &sigmoidTable,  -16.0, 16.0, sigmoid );
+  fillTable( &tanhTable,      -8.0,  8.0, tanh );
+  fillTable( &atanTable,       0.0,  1.0, atan );
+  fillTable( &softplusTable, -16.0, 16.0, softplus );
+  fillTable( &gaussianTable,   0.0,  6.0, gaussian );
+  fillTable( &sinTable,        0.0,  2.0 * ACT_PI, sin );
+}
+
+static inline float fastSin( float val )
+{
+  // Range reduction in double precision to keep the phase accurate for large inputs
+  double pos = val * (ACT_TABLE_SIZE / (2.0 * ACT_PI));
+  // Keeps the conversion below defined, a float this large has no phase left anyway
+  if( !(fabs( pos ) < 0x1p52) ) {
+    return sinf( val );
+  }
+  double whole = floor( pos );
+  int idx = (int)((int64_t)whole & (ACT_TABLE_SIZE - 1));
+  float frac = (float)(pos - whole);
+
+  return sinTable.values[idx] + (sinTable.values[idx+1] - sinTable.values[idx]) * frac;
+}
 
 /*******************************************
  *           Exported functions            *
@@ -64,6 +159,69 @@ float act_sin( float val )
   return sinf(val);
 }
 
+// The fast functions pass NaN through just like their exact counterparts.
+float act_sigmoid_fast( float val )
+{
+  if( val != val ) return val;
+  return lookup( &sigmoidTable, val );
+}
+
+float act_tanh_fast( float val )
+{
+  if( val != val ) return val;
+  return lookup( &tanhTable, val );
+}
+
+float act_atan_fast( float val )
+{
+  if( val != val ) return val;
+
+  // atan(x) = pi/2 - atan(1/x) for x > 1, and the function is odd
+  float absVal = fabsf( val );
+  float res;
+  if( absVal <= 1.0 ) {
+    res = lookup( &atanTable, absVal );
+  } else {
+    res = (float)(ACT_PI / 2.0) - lookup( &atanTable, 1.0 / absVal );
+  }
+
+  return val < 0 ? -res : res;
+}
+
+float act_softplus_fast( float val )
+{
+  if( val != val ) return val;
+  // ln(1 + exp(x)) = x + ln(1 + exp(-x)), where the last term is negligible here
+  if( val >= softplusTable.max ) {
+    return val;
+  }
+  return lookup( &softplusTable, val );
+}
+
+float act_gaussian_fast( float val )
+{
+  if( val != val ) return val;
+  return lookup( &gaussianTable, fabsf( val ) );
+}
+
+float act_sinc_fast( float val )
+{
+  if( val != val ) return val;
+
+  // Division by a small value magnifies the table error, use the series instead
+  if( fabsf( val ) < 1.0 ) {
+    float sq = val * val;
+    return 1.0 - sq / 6.0 * (1.0 - sq / 20.0 * (1.0 - sq / 42.0 * (1.0 - sq / 72.0)));
+  }
+  return fastSin( val ) / val;
+}
+
+float act_sin_fast( float val )
+{
+  if( val != val ) return val;
+  return fastSin( val );
+}
+
 act_func activationToFunction( activation_type_t activation )
 {
   switch( activation ) {
@@ -95,6 +253,66 @@ act_func activationToFunction( activation_type_t activation )
   }
 }
 
+act_func activationToFastFunction( activation_type_t activation )
+{
+  switch( activation ) {
+  case activation_sigmoid:
+    return act_sigmoid_fast;
+  case activation_tanh:
+    return act_tanh_fast;
+  case activation_atan:
+    return act_atan_fast;
+  case activation_softplus:
+    return act_softplus_fast;
+  case activation_gaussian:
+    return act_gaussian_fast;
+  case activation_sinc:
+    return act_sinc_fast;
+  case activation_sin:
+    return act_sin_fast;
+
+  default:
+    return activationToFunction( activation );
+  }
+}
+
+act_func activationToFunctionMode( activation_type_t activation, activation_mode_t mode )
+{
+  if( mode == activation_mode_default ) {
+    mode = defaultMode;
+  }
+
+  if( mode != activation_mode_fast ) {
+    return activationToFunction( activation );
+  }
+
+  activationInitTables();
+  return activationToFastFunction( activation );
+}
+
+void activationInitTables( void )
+{
+  pthread_once( &tablesOnce, initTables );
+}
+
+void activationSetDefaultMode( activation_mode_t mode )
+{
+  if( mode == activation_mode_default ) {
+    mode = activation_mode_exact;
+  }
+
+  if( mode == activation_mode_fast ) {
+    activationInitTables();
+  }
+
+  defaultMode = mode;
+}
+
+activation_mode_t activationGetDefaultMode( void )
+{
+  return defaultMode;
+}
+
 activation_type_t randomActivation( uint32_t allowedActivations )
 {
   if( allowedActivations != activation_any ) {
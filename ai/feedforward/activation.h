@@ -22,6 +22,26 @@ typedef enum activation_type_e {
   activation_any       = 0x000
 } activation_type_t;
 
+// Selects how activation functions are calculated.  The exact versions use
+//  libm and are the reference, the fast versions use interpolated lookup
+//  tables with the maximum absolute errors listed below.
+typedef enum activation_mode_e {
+  activation_mode_default = 0, // Use whatever activationSetDefaultMode() chose
+  activation_mode_exact   = 1,
+  activation_mode_fast    = 2
+} activation_mode_t;
+
+// Maximum absolute error of the fast functions compared to the exact ones,
+//  verified by testActivation for |x| < 1e5 wherever the exact function
+//  doesn't overflow.
+#define ACT_FAST_MAX_ERROR_SIGMOID  1.0e-6f
+#define ACT_FAST_MAX_ERROR_TANH     2.0e-6f
+#define ACT_FAST_MAX_ERROR_ATAN     2.0e-7f
+#define ACT_FAST_MAX_ERROR_SOFTPLUS 3.0e-6f
+#define ACT_FAST_MAX_ERROR_GAUSSIAN 1.0e-6f
+#define ACT_FAST_MAX_ERROR_SINC     1.0e-6f
+#define ACT_FAST_MAX_ERROR_SIN      1.0e-6f
+
 typedef float (*act_func) ( float val );
 
 float act_linear( float val );
@@ -35,7 +55,32 @@ float act_softplus( float val );
 float act_gaussian( float val );
 float act_sinc( float val );
 float act_sin( float val );
+
+float act_sigmoid_fast( float val );
+float act_tanh_fast( float val );
+float act_atan_fast( float val );
+float act_softplus_fast( float val );
+float act_gaussian_fast( float val );
+float act_sinc_fast( float val );
+float act_sin_fast( float val );
+
+// Returns the exact version of an activation function.
 act_func activationToFunction( activation_type_t activation );
+// Returns the exact or fast version of an activation function.  Functions
+//  without a fast version are the same in both modes.
+act_func activationToFunctionMode( activation_type_t activation, activation_mode_t mode );
+// Returns the fast version of an activation function without setting up the
+//  lookup tables, see activationInitTables().
+act_func activationToFastFunction( activation_type_t activation );
+
+// Sets up the lookup tables of the fast functions, only the first call does
+//  anything.  Done by activationToFunctionMode(), activationSetDefaultMode()
+//  and ffnNetworkSetActivationMode() whenever fast mode is asked for.
+void activationInitTables( void );
+
+// Mode used by everything set to activation_mode_default, exact unless changed.
+void activationSetDefaultMode( activation_mode_t mode );
+activation_mode_t activationGetDefaultMode( void );
 activation_type_t randomActivation( uint32_t allowedActivations );
 
 #endif
@@ -0,0 +1,292 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "network.h"
+#include "topologies.h"
+#include "perfcounters.h"
+
+// Neurons in the single layer networks used for the connection sweep
+#define SWEEP_NEURONS 64
+
+typedef struct bench_case_s {
+  const char         *name;
+  const char         *kind;
+  uint64_t            numInputs;
+  uint64_t            numLayers;
+  // Large enough for any of the trained networks
+  ffn_layer_params_t  layerParams[ARKANOID_NET_LAYERS];
+  activation_mode_t   mode;
+} bench_case_t;
+
+static const struct option *getOptlist()
+{
+  static struct option optlist[] = {
+    {"min-time", required_argument, NULL, 't'},
+    {"filter",   required_argument, NULL, 'f'},
+    {"counters", no_argument,       NULL, 'c'},
+
+    {"help",     no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  return optlist;
+}
+
+static void usage( char *progname )
+{
+  printf( "Usage: %s [OPTION]...\n", progname );
+  printf( "Measure how fast ffnNetworkRun() is for a number of network shapes and\n"
+	  "print the results as JSON.\n\n" );
+  printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
+  printf( "  -t, --min-time=FLOAT       seconds to run each case for, defaults to 0.5\n" );
+  printf( "  -f, --filter=STRING        only run cases whose name contains STRING\n" );
+  printf( "  -c, --counters             add hardware performance counters per inference\n" );
+
+  printf( "  -h, --help                 display this message and exit\n" );
+}
+
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Print the available counters divided by <count> as a JSON object
+static void printCounters( const char *name, const perf_values_t *values, double count )
+{
+  bool first = true;
+  int i;
+
+  printf( ", \"%s\": {", name );
+  for( i = 0; i < perf_counter_count; i++ ) {
+    if( perfCountersAvailable( i ) ) {
+      printf( "%s\"%s\": %.1f", first ? "" : ", ", perfCounterName( i ), values->value[i] / count );
+      first = false;
+    }
+  }
+  if( perfCountersAvailable( perf_cycles ) && perfCountersAvailable( perf_instructions ) &&
+      values->value[perf_cycles] > 0 ) {
+    printf( ", \"ipc\": %.3f", (double)values->value[perf_instructions] / values->value[perf_cycles] );
+  }
+  printf( "}" );
+}
+
+// Bytes read from memory for every multiply-accumulate, weights and inputs
+//  always and the connection index for neurons that aren't linearly connected.
+static double bytesPerMac( ffn_network_t *net )
+{
+  uint64_t lay, neur;
+  double bytes = 0;
+  double macs = 0;
+  for( lay = 0; lay < ffnNetworkGetNumLayers( net ); lay++ ) {
+    for( neur = 0; neur < ffnNetworkGetLayerNumNeurons( net, lay ); neur++ ) {
+      uint64_t numConnections = ffnNetworkGetLayerNeuronNumConnections( net, lay, neur );
+      uint64_t perMac = sizeof(float) + sizeof(float);
+      if( ffnNetworkGetLayerNeuronSeed( net, lay, neur ) != 0 ) {
+	perMac += sizeof(uint64_t);
+      }
+      bytes += numConnections * perMac;
+      macs += numConnections;
+    }
+  }
+
+  return macs > 0 ? bytes / macs : 0;
+}
+
+static bool runCase( const bench_case_t *bc, double minTime, bool first )
+{
+  // Same seed for every case so the connections are comparable between
+  //  commits, no matter which cases are filtered out
+  srand( 1 );
+
+  ffn_network_t *net = ffnNetworkCreate( bc->numInputs, bc->numLayers,
+					 (ffn_layer_params_t*)bc->layerParams, true );
+  if( net == NULL ) {
+    fprintf( stderr, "Unable to create network for %s\n", bc->name );
+    return false;
+  }
+  ffnNetworkSetActivationMode( net, bc->mode );
+
+  float *inputs = malloc( sizeof(float) * bc->numInputs );
+  if( inputs == NULL ) {
+    ffnNetworkDestroy( net );
+    return false;
+  }
+
+  uint64_t i;
+  for( i = 0; i < bc->numInputs; i++ ) {
+    inputs[i] = rand() / (float)RAND_MAX;
+  }
+
+  // Warm up caches and tables
+  ffnNetworkRun( net, inputs );
+
+  uint64_t iterations = 0;
+  uint64_t batch = 1;
+  perf_values_t startCounters, endCounters;
+  perfCountersRead( &startCounters );
+  double start = now();
+  double elapsed;
+  do {
+    for( i = 0; i < batch; i++ ) {
+      ffnNetworkRun( net, inputs );
+    }
+    iterations += batch;
+    if( batch < 1024 ) {
+      batch *= 2;
+    }
+    elapsed = now() - start;
+  } while( elapsed < minTime );
+  perfCountersRead( &endCounters );
+  for( i = 0; i < perf_counter_count; i++ ) {
+    endCounters.value[i] -= startCounters.value[i];
+  }
+
+  uint64_t macs = ffnNetworkGetNumWeights( net );
+  double nsPerInference = elapsed * 1e9 / iterations;
+
+  printf( "%s    {\"name\": \"%s\", \"kind\": \"%s\", \"mode\": \"%s\", \"inputs\": %llu, \"layers\": [",
+	  first ? "" : ",\n", bc->name, bc->kind,
+	  bc->mode == activation_mode_fast ? "fast" : "exact",
+	  (unsigned long long)bc->numInputs );
+  for( i = 0; i < bc->numLayers; i++ ) {
+    printf( "%s{\"neurons\": %llu, \"connections\": %llu, \"activations\": %u}",
+	    i ? ", " : "",
+	    (unsigned long long)bc->layerParams[i].numNeurons,
+	    (unsigned long long)bc->layerParams[i].numConnections,
+	    bc->layerParams[i].allowedActivations );
+  }
+  printf( "], \"macs\": %llu, \"iterations\": %llu, \"ns_per_inference\": %.1f, "
+	  "\"gmac_per_s\": %.4f, \"bytes_per_mac\": %.2f",
+	  (unsigned long long)macs, (unsigned long long)iterations, nsPerInference,
+	  macs / nsPerInference, bytesPerMac( net ) );
+  if( perfCountersEnabled() ) {
+    printCounters( "counters_per_inference", &endCounters, iterations );
+  }
+  printf( "}" );
+  fflush( stdout );
+
+  free( inputs );
+  ffnNetworkDestroy( net );
+  return true;
+}
+
+int main( int argc, char *argv[] )
+{
+  double minTime = 0.5;
+  char *filter = NULL;
+  bool counters = false;
+
+  int c;
+  while( (c = getopt_long (argc, argv, "t:f:ch",
+			   getOptlist(), NULL)) != -1 ) {
+    switch(c) {
+    case 't': // Optional
+      minTime = strtod(optarg, NULL);
+      break;
+    case 'f': // Optional
+      filter = optarg;
+      break;
+    case 'c': // Optional
+      counters = true;
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  if( counters && !perfCountersEnable() ) {
+    fprintf( stderr, "Performance counters unavailable (%s), continuing without them\n",
+	     strerror( errno ) );
+  }
+
+  static const uint64_t connectionCounts[] = {16, 64, 256, 1024, 4096, 16384, 30720};
+  static const activation_type_t activations[] = {
+    activation_linear, activation_relu, activation_step, activation_sigmoid,
+    activation_tanh, activation_atan, activation_softsign, activation_softplus,
+    activation_gaussian, activation_sinc, activation_sin
+  };
+  static const char *activationNames[] = {
+    "linear", "relu", "step", "sigmoid", "tanh", "atan",
+    "softsign", "softplus", "gaussian", "sinc", "sin"
+  };
+  const int numConnectionCounts = sizeof(connectionCounts) / sizeof(connectionCounts[0]);
+  const int numActivations = sizeof(activations) / sizeof(activations[0]);
+
+  bench_case_t *cases = malloc( sizeof(bench_case_t) * (2 * numConnectionCounts + 2 * numActivations + 2) );
+  char (*names)[64] = malloc( 64 * (2 * numConnectionCounts + 2 * numActivations + 2) );
+  if( cases == NULL || names == NULL ) {
+    return -1;
+  }
+
+  int numCases = 0;
+  int i;
+
+  // Fully connected layers read their inputs linearly, seeded layers gather
+  //  from a frame sized input array.
+  for( i = 0; i < numConnectionCounts; i++ ) {
+    bench_case_t *bc = &cases[numCases];
+    snprintf( names[numCases], 64, "dense_%llu", (unsigned long long)connectionCounts[i] );
+    *bc = (bench_case_t) {names[numCases], "dense", connectionCounts[i], 1,
+			  {{SWEEP_NEURONS, connectionCounts[i], activation_linear}},
+			  activation_mode_exact};
+    numCases++;
+
+    bc = &cases[numCases];
+    snprintf( names[numCases], 64, "seeded_%llu", (unsigned long long)connectionCounts[i] );
+    *bc = (bench_case_t) {names[numCases], "seeded", ARKANOID_SCREEN_INPUTS, 1,
+			  {{SWEEP_NEURONS, connectionCounts[i], activation_linear}},
+			  activation_mode_exact};
+    numCases++;
+  }
+
+  // Activation functions matter most for small dense layers
+  for( i = 0; i < numActivations; i++ ) {
+    activation_mode_t mode;
+    for( mode = activation_mode_exact; mode <= activation_mode_fast; mode++ ) {
+      bench_case_t *bc = &cases[numCases];
+      snprintf( names[numCases], 64, "activation_%s_%s", activationNames[i],
+		mode == activation_mode_fast ? "fast" : "exact" );
+      *bc = (bench_case_t) {names[numCases], "activation", 16, 1,
+			    {{256, 16, activations[i]}},
+			    mode};
+      numCases++;
+    }
+  }
+
+  // The networks actually trained by threadTrainer and game
+  cases[numCases] = (bench_case_t) {"addtrainer", "topology", ADDTRAINER_INPUTS, ADDTRAINER_LAYERS,
+				    .mode = activation_mode_exact};
+  addTrainerLayers( cases[numCases++].layerParams );
+  cases[numCases] = (bench_case_t) {"arkanoid", "topology", ARKANOID_SCREEN_INPUTS, ARKANOID_NET_LAYERS,
+				    .mode = activation_mode_exact};
+  arkanoidLayers( cases[numCases++].layerParams, ARKANOID_SCREEN_INPUTS, true );
+
+  printf( "{\n  \"benchmark\": \"bench_ffn\",\n  \"min_time\": %g,\n  \"results\": [\n", minTime );
+  bool first = true;
+  bool failed = false;
+  for( i = 0; i < numCases; i++ ) {
+    if( filter != NULL && strstr( cases[i].name, filter ) == NULL ) {
+      continue;
+    }
+    if( runCase( &cases[i], minTime, first ) ) {
+      first = false;
+    } else {
+      failed = true;
+    }
+  }
+  printf( "\n  ]\n}\n" );
+
+  free( names );
+  free( cases );
+  return failed ? -1 : 0;
+}
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 // List of static functions used for squashing values
@@ -100,6 +101,127 @@ ffn_layer_t *ffnLayerCreate( uint64_t size, uint64_t inputs, uint64_t connection
   return NULL;
 }
 
+ffn_layer_t *ffnLayerCopy( ffn_layer_t *layer )
+{
+  assert( layer != NULL );
+
+  uint64_t i, last;
+  ffn_layer_t *tmp;
+
+  tmp = malloc( sizeof(ffn_layer_t) );
+  if( tmp == NULL ) {
+    goto layer_copy_err_object;
+  }
+
+  tmp->allowedActivations = layer->allowedActivations;
+  tmp->numNeurons = layer->numNeurons;
+  tmp->numConnections = layer->numConnections;
+
+  tmp->neurons = malloc( tmp->numNeurons * sizeof(ffn_neuron_t*) );
+  if( tmp->neurons == NULL ) {
+    goto layer_copy_err_neurons;
+  }
+
+  for( i = 0; i < tmp->numNeurons; i++ ) {
+    tmp->neurons[i] = ffnNeuronCopy( layer->neurons[i] );
+    if( tmp->neurons[i] == NULL ) {
+      fprintf( stderr, "ffnLayerCopy() - Unable to copy neuron %d\n", (int) i );
+      last = i;
+      goto layer_copy_err_neurons_copy;
+    }
+  }
+
+  tmp->values = malloc( sizeof(float) * tmp->numNeurons );
+  if( tmp->values == NULL ) {
+    goto layer_copy_err_values;
+  }
+  memcpy( tmp->values, layer->values, sizeof(float) * tmp->numNeurons );
+
+  return tmp;
+
+
+  // Error handling
+ layer_copy_err_values:
+  last = tmp->numNeurons;
+
+ layer_copy_err_neurons_copy:
+  for( i = 0; i < last; i++ ) {
+    ffnNeuronDestroy( tmp->neurons[i] );
+  }
+  free( tmp->neurons );
+
+ layer_copy_err_neurons:
+  free( tmp );
+
+ layer_copy_err_object:
+  return NULL;
+}
+
+ffn_layer_t *ffnLayerCreateFromNeurons( uint64_t size, uint32_t allowedActivations, ffn_neuron_t **neurons )
+{
+  assert( neurons != NULL );
+
+  uint64_t i;
+  ffn_layer_t *layer = malloc( sizeof(ffn_layer_t) );
+  if( layer == NULL ) {
+    return NULL;
+  }
+
+  layer->values = malloc( sizeof(float) * size );
+  if( layer->values == NULL ) {
+    free( layer );
+    return NULL;
+  }
+
+  layer->allowedActivations = allowedActivations;
+  layer->numNeurons = size;
+  layer->neurons = neurons;
+  layer->numConnections = 0;
+  for( i = 0; i < layer->numNeurons; i++ ) {
+    if( ffnNeuronGetNumConnections( layer->neurons[i] ) > layer->numConnections ) {
+      layer->numConnections = ffnNeuronGetNumConnections( layer->neurons[i] );
+    }
+    layer->values[i] = 0.0;
+  }
+
+  return layer;
+}
+
+ffn_layer_t *ffnLayerPrune( ffn_layer_t *layer, float threshold )
+{
+  assert( layer != NULL );
+
+  uint64_t i;
+  ffn_neuron_t **neurons = malloc( layer->numNeurons * sizeof(ffn_neuron_t*) );
+  if( neurons == NULL ) {
+    return NULL;
+  }
+
+  for( i = 0; i < layer->numNeurons; i++ ) {
+    neurons[i] = ffnNeuronPrune( layer->neurons[i], threshold );
+    if( neurons[i] == NULL ) {
+      fprintf( stderr, "ffnLayerPrune() - Unable to prune neuron %d\n", (int) i );
+      goto layer_prune_err;
+    }
+  }
+
+  ffn_layer_t *tmp = ffnLayerCreateFromNeurons( layer->numNeurons, layer->allowedActivations, neurons );
+  if( tmp == NULL ) {
+    goto layer_prune_err;
+  }
+
+  return tmp;
+
+
+  // Error handling
+ layer_prune_err:
+  while( i-- ) {
+    ffnNeuronDestroy( neurons[i] );
+  }
+  free( neurons );
+  return NULL;
+}
+
 void ffnLayerDestroy( ffn_layer_t *layer )
 {
   assert( layer != NULL );
@@ -124,13 +246,31 @@ void ffnLayerMutate( ffn_layer_t *layer, double mutateRate )
 }
 
 bool ffnLayerRun( ffn_layer_t *layer, float *inputs )
+{
+  return ffnLayerRunMode( layer, inputs, activation_mode_default );
+}
+
+bool ffnLayerRunMode( ffn_layer_t *layer, float *inputs, activation_mode_t mode )
 {
   assert( layer != NULL );
   assert( inputs != NULL );
 
   uint64_t neur;
   for( neur = 0; neur < layer->numNeurons; neur++ ) {
-    layer->values[neur] = ffnNeuronRun( layer->neurons[neur], inputs );
+    layer->values[neur] = ffnNeuronRunMode( layer->neurons[neur], inputs, mode );
+  }
+
+  return true;
+}
+
+bool ffnLayerRunU8Mode( ffn_layer_t *layer, const uint8_t *inputs, float scale, activation_mode_t mode )
+{
+  assert( layer != NULL );
+  assert( inputs != NULL );
+
+  uint64_t neur;
+  for( neur = 0; neur < layer->numNeurons; neur++ ) {
+    layer->values[neur] = ffnNeuronRunU8Mode( layer->neurons[neur], inputs, scale, mode );
   }
 
   return true;
@@ -240,7 +380,29 @@ uint64_t ffnLayerGetNeuronConnection( ffn_layer_t *layer, uint64_t neuron, uint6
 {
   assert( layer != NULL );
   assert( neuron < layer->numNeurons );
-  assert( index < layer->numConnections );
+  assert( index < ffnNeuronGetNumConnections( layer->neurons[neuron] ) );
 
   return ffnNeuronGetConnection( layer->neurons[neuron], index );
 }
+
+uint64_t ffnLayerGetNeuronNumConnections( ffn_layer_t *layer, uint64_t neuron )
+{
+  assert( layer != NULL );
+  assert( neuron < layer->numNeurons );
+
+  return ffnNeuronGetNumConnections( layer->neurons[neuron] );
+}
+
+bool ffnLayerIsPruned( ffn_layer_t *layer )
+{
+  assert( layer != NULL );
+
+  uint64_t i;
+  for( i = 0; i < layer->numNeurons; i++ ) {
+    if( ffnNeuronIsExplicit( layer->neurons[i] ) ) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -28,6 +28,19 @@ typedef struct ffn_layer_params_s {
 //  randomly generated, otherwise they will be created empty.
 ffn_layer_t *ffnLayerCreate( uint64_t size, uint64_t inputs, uint64_t connections, uint32_t allowedActivations, bool initialise );
 
+// Create an exact duplicate of a layer with its own memory.
+ffn_layer_t *ffnLayerCopy( ffn_layer_t *layer );
+
+// Create a layer from already existing neurons.  The layer takes ownership of
+//  the neurons and the array holding them.  The number of connections of the
+//  layer is that of its largest neuron.
+ffn_layer_t *ffnLayerCreateFromNeurons( uint64_t size, uint32_t allowedActivations, ffn_neuron_t **neurons );
+
+// Create a compacted copy of a layer where each neuron only keeps the
+//  connections with weights larger than <threshold> in absolute value.  The
+//  number of connections of the new layer is that of its largest neuron.
+ffn_layer_t *ffnLayerPrune( ffn_layer_t *layer, float threshold );
+
 // Destroys a layer and frees its memory.
 void ffnLayerDestroy( ffn_layer_t *layer );
 
@@ -40,8 +53,17 @@ void ffnLayerMutate( ffn_layer_t *layer, double mutateRate );
 
 // Performs all calculations for a layer.
 bool ffnLayerRun( ffn_layer_t *layer, float *inputs );
+// Same as above, but with activation functions calculated as given by <mode>.
+//  Fast mode expects activationInitTables() to have been called.
+bool ffnLayerRunMode( ffn_layer_t *layer, float *inputs, activation_mode_t mode );
+// Same as above, but the inputs are bytes and input i is inputs[i] * <scale>.
+//  Only useful for layers reading a uint8 sensor directly.
+bool ffnLayerRunU8Mode( ffn_layer_t *layer, const uint8_t *inputs, float scale, activation_mode_t mode );
 
 // Layer manipulation functions
+// Connections of every neuron, or the most any neuron has in a pruned layer.
+//  Go through ffnLayerGetNeuronNumConnections() when looping over neurons
+//  that may be pruned.
 uint64_t ffnLayerGetNumConnections( ffn_layer_t *layer );
 uint64_t ffnLayerGetNumNeurons( ffn_layer_t *layer );
 uint32_t ffnLayerGetAllowedActivations( ffn_layer_t *layer );
@@ -63,4 +85,8 @@ float             ffnLayerGetNeuronWeight(     ffn_layer_t *layer, uint64_t neur
 void              ffnLayerSetNeuronActivation( ffn_layer_t *layer, uint64_t neuron, activation_type_t activation );
 activation_type_t ffnLayerGetNeuronActivation( ffn_layer_t *layer, uint64_t neuron );
 uint64_t          ffnLayerGetNeuronConnection( ffn_layer_t *layer, uint64_t neuron, uint64_t index );
+uint64_t          ffnLayerGetNeuronNumConnections( ffn_layer_t *layer, uint64_t neuron );
+
+// True if any neuron in the layer has explicit connections, i.e. the layer is pruned.
+bool ffnLayerIsPruned( ffn_layer_t *layer );
 #endif
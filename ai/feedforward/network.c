@@ -2,15 +2,296 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
 
 #include "activation.h"
 
+// Pruned networks can't be described by seeds, they are stored in a format
+//  with explicit connections that starts with this tag.  Regular networks
+//  always start with the upper bytes of the number of inputs, i.e. zeros.
+#define FFN_SPARSE_MAGIC "FFNS"
+#define FFN_SPARSE_MAGIC_LEN 4
+
 /*******************************************
  *             Local functions             *
  *******************************************/
+static void putU64( uint8_t *bytes, uint64_t *i, uint64_t val )
+{
+  int shift;
+  for( shift = 56; shift >= 0; shift -= 8 ) {
+    bytes[(*i)++] = (val >> shift) & 0xff;
+  }
+}
+
+static void putU32( uint8_t *bytes, uint64_t *i, uint32_t val )
+{
+  int shift;
+  for( shift = 24; shift >= 0; shift -= 8 ) {
+    bytes[(*i)++] = (val >> shift) & 0xff;
+  }
+}
+
+static void putFloat( uint8_t *bytes, uint64_t *i, float val )
+{
+  uint32_t tmp;
+  memcpy( &tmp, &val, sizeof(tmp) );
+  putU32( bytes, i, tmp );
+}
+
+// The getters return false if the data ends too early.
+static bool getU64( uint64_t len, uint8_t *data, uint64_t *i, uint64_t *val )
+{
+  if( *i + sizeof(uint64_t) > len ) {
+    return false;
+  }
+
+  int n;
+  *val = 0;
+  for( n = 0; n < sizeof(uint64_t); n++ ) {
+    *val <<= 8; *val |= data[(*i)++];
+  }
+  return true;
+}
+
+static bool getU32( uint64_t len, uint8_t *data, uint64_t *i, uint32_t *val )
+{
+  if( *i + sizeof(uint32_t) > len ) {
+    return false;
+  }
+
+  int n;
+  *val = 0;
+  for( n = 0; n < sizeof(uint32_t); n++ ) {
+    *val <<= 8; *val |= data[(*i)++];
+  }
+  return true;
+}
+
+static bool getFloat( uint64_t len, uint8_t *data, uint64_t *i, float *val )
+{
+  uint32_t tmp;
+  if( !getU32( len, data, i, &tmp ) ) {
+    return false;
+  }
+  memcpy( val, &tmp, sizeof(tmp) );
+  return true;
+}
+
+// Layout: magic, numInputs, numLayers, then for each layer its allowed
+//  activations and number of neurons followed by every neuron as number of
+//  connections, (input, weight) pairs, bias and activation.
+static uint64_t serialiseSparse( ffn_network_t *network, uint8_t **data )
+{
+  uint64_t length = FFN_SPARSE_MAGIC_LEN + 2 * sizeof(uint64_t);
+  uint64_t i, lay, neur, src;
+
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    length += sizeof(uint32_t) + sizeof(uint64_t);
+    for( neur = 0; neur < ffnLayerGetNumNeurons( network->layers[lay] ); neur++ ) {
+      length += sizeof(uint64_t) + sizeof(float) + 1;
+      length += ffnLayerGetNeuronNumConnections( network->layers[lay], neur ) * (sizeof(uint64_t) + sizeof(float));
+    }
+  }
+
+  uint8_t *bytes = malloc(length);
+  if( bytes == NULL ) {
+    return 0;
+  }
+
+  memcpy( bytes, FFN_SPARSE_MAGIC, FFN_SPARSE_MAGIC_LEN );
+  i = FFN_SPARSE_MAGIC_LEN;
+  putU64( bytes, &i, network->numInputs );
+  putU64( bytes, &i, network->numLayers );
+
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    ffn_layer_t *layer = network->layers[lay];
+    putU32( bytes, &i, ffnLayerGetAllowedActivations( layer ) );
+    putU64( bytes, &i, ffnLayerGetNumNeurons( layer ) );
+
+    for( neur = 0; neur < ffnLayerGetNumNeurons( layer ); neur++ ) {
+      uint64_t numConnections = ffnLayerGetNeuronNumConnections( layer, neur );
+      putU64( bytes, &i, numConnections );
+      for( src = 0; src < numConnections; src++ ) {
+	putU64( bytes, &i, ffnLayerGetNeuronConnection( layer, neur, src ) );
+	putFloat( bytes, &i, ffnLayerGetNeuronWeight( layer, neur, src ) );
+      }
+      putFloat( bytes, &i, ffnLayerGetNeuronBias( layer, neur ) );
+      bytes[i++] = (uint8_t)ffnLayerGetNeuronActivation( layer, neur );
+    }
+  }
+
+  assert( i == length );
+
+  *data = bytes;
+  return length;
+}
+
+static ffn_layer_t *unserialiseSparseLayer( uint64_t len, uint8_t *data, uint64_t *i, uint64_t numInputs )
+{
+  uint32_t allowedActivations;
+  uint64_t numNeurons, neur, src;
+
+  if( !getU32( len, data, i, &allowedActivations ) ||
+      !getU64( len, data, i, &numNeurons ) ||
+      numNeurons < 1 ||
+      // Every neuron takes at least this many bytes, protects the allocation below
+      numNeurons > (len - *i) / (sizeof(uint64_t) + sizeof(float) + 1) ) {
+    return NULL;
+  }
+
+  ffn_neuron_t **neurons = malloc( sizeof(ffn_neuron_t*) * numNeurons );
+  if( neurons == NULL ) {
+    return NULL;
+  }
+
+  uint64_t *connections = NULL;
+  float *weights = NULL;
+
+  for( neur = 0; neur < numNeurons; neur++ ) {
+    uint64_t numConnections;
+    float bias;
+
+    if( !getU64( len, data, i, &numConnections ) ||
+	numConnections > (len - *i) / (sizeof(uint64_t) + sizeof(float)) ) {
+      goto sparse_layer_err;
+    }
+
+    connections = malloc( sizeof(uint64_t) * (numConnections ? numConnections : 1) );
+    weights = malloc( sizeof(float) * (numConnections ? numConnections : 1) );
+    if( connections == NULL || weights == NULL ) {
+      goto sparse_layer_err;
+    }
+
+    for( src = 0; src < numConnections; src++ ) {
+      if( !getU64( len, data, i, &connections[src] ) ||
+	  !getFloat( len, data, i, &weights[src] ) ||
+	  connections[src] >= numInputs ) {
+	goto sparse_layer_err;
+      }
+    }
+
+    if( !getFloat( len, data, i, &bias ) || *i >= len ) {
+      goto sparse_layer_err;
+    }
+
+    neurons[neur] = ffnNeuronCreateExplicit( numInputs, (activation_type_t)data[(*i)++],
+					     numConnections, connections, weights, bias );
+    free( connections );
+    free( weights );
+    connections = NULL;
+    weights = NULL;
+    if( neurons[neur] == NULL ) {
+      goto sparse_layer_err;
+    }
+  }
+
+  ffn_layer_t *layer = ffnLayerCreateFromNeurons( numNeurons, allowedActivations, neurons );
+  if( layer != NULL ) {
+    return layer;
+  }
+
+
+  // Error handling
+ sparse_layer_err:
+  free( connections );
+  free( weights );
+  while( neur-- ) {
+    ffnNeuronDestroy( neurons[neur] );
+  }
+  free( neurons );
+  return NULL;
+}
+
+static ffn_network_t *unserialiseSparse( uint64_t len, uint8_t *data )
+{
+  uint64_t i = FFN_SPARSE_MAGIC_LEN;
+  uint64_t numInputs, numLayers, lay;
+
+  if( !getU64( len, data, &i, &numInputs ) ||
+      !getU64( len, data, &i, &numLayers ) ||
+      numInputs < 1 || numLayers < 1 ||
+      numLayers > len ) {
+    return NULL;
+  }
+
+  ffn_network_t *tmp = malloc(sizeof(ffn_network_t));
+  if( tmp == NULL ) {
+    return NULL;
+  }
+
+  tmp->numInputs = numInputs;
+  tmp->numLayers = numLayers;
+  tmp->activationMode = activation_mode_default;
+  tmp->layers = malloc( numLayers * sizeof(ffn_layer_t*) );
+  if( tmp->layers == NULL ) {
+    free( tmp );
+    return NULL;
+  }
+
+  for( lay = 0; lay < numLayers; lay++ ) {
+    // First layer reads the network inputs, the rest the previous layer
+    uint64_t layerInputs = lay == 0 ? numInputs : ffnLayerGetNumNeurons( tmp->layers[lay-1] );
+    tmp->layers[lay] = unserialiseSparseLayer( len, data, &i, layerInputs );
+    if( tmp->layers[lay] == NULL ) {
+      while( lay-- ) {
+	ffnLayerDestroy( tmp->layers[lay] );
+      }
+      free( tmp->layers );
+      free( tmp );
+      return NULL;
+    }
+  }
+
+  return tmp;
+}
+
+// Create a network where every layer is pruned with its own threshold.
+static ffn_network_t *pruneLayers( ffn_network_t *network, float *thresholds )
+{
+  ffn_network_t *tmp = malloc(sizeof(ffn_network_t));
+  if( tmp == NULL ) {
+    return NULL;
+  }
+
+  tmp->numInputs = network->numInputs;
+  tmp->numLayers = network->numLayers;
+  tmp->activationMode = network->activationMode;
+  tmp->layers = malloc( tmp->numLayers * sizeof(ffn_layer_t*) );
+  if( tmp->layers == NULL ) {
+    free( tmp );
+    return NULL;
+  }
+
+  uint64_t lay;
+  for( lay = 0; lay < tmp->numLayers; lay++ ) {
+    tmp->layers[lay] = ffnLayerPrune( network->layers[lay], thresholds[lay] );
+    if( tmp->layers[lay] == NULL ) {
+      while( lay-- ) {
+	ffnLayerDestroy( tmp->layers[lay] );
+      }
+      free( tmp->layers );
+      free( tmp );
+      return NULL;
+    }
+  }
+
+  return tmp;
+}
+
+static int compFloat( const void *a, const void *b )
+{
+  float f1 = *(const float*)a;
+  float f2 = *(const float*)b;
+
+  if( f1 < f2 )
+    return -1;
+  if( f1 == f2 )
+    return 0;
+  return 1;
+}
 
 
 /*******************************************
@@ -29,6 +310,7 @@ ffn_network_t *ffnNetworkCreate( uint64_t inputs, uint64_t layers, ffn_layer_par
 
   tmp->numInputs = inputs;
   tmp->numLayers = layers;
+  tmp->activationMode = activation_mode_default;
 
   tmp->layers = malloc( layers * sizeof(ffn_layer_t*) );
   if( tmp->layers == NULL ) {
@@ -68,33 +350,33 @@ ffn_network_t *ffnNetworkCopy( ffn_network_t *network )
 {
   assert( network != NULL );
 
-  ffn_layer_params_t *layerParams = ffnNetworkGetLayerParams( network );
-  if( layerParams == NULL ) {
+  ffn_network_t *tmp = malloc(sizeof(ffn_network_t));
+  if( tmp == NULL ) {
     return NULL;
   }
 
-  ffn_network_t *tmp = ffnNetworkCreate( network->numInputs,
-					 network->numLayers,
-					 layerParams,
-					 false );
-  free( layerParams );
-  if( tmp == NULL ) {
+  tmp->numInputs = network->numInputs;
+  tmp->numLayers = network->numLayers;
+  tmp->activationMode = network->activationMode;
+
+  tmp->layers = malloc( tmp->numLayers * sizeof(ffn_layer_t*) );
+  if( tmp->layers == NULL ) {
+    free( tmp );
     return NULL;
   }
 
-  uint64_t lay, neur, src;
-
+  // Layers are duplicated as they are, no need to go through the setters and
+  //  regenerate every connection from its seed.
+  uint64_t lay;
   for( lay = 0; lay < tmp->numLayers; lay++ ) {
-    for( neur = 0; neur < ffnNetworkGetLayerNumNeurons( network, lay ); neur++ ) {
-      ffnNetworkSetLayerNeuronSeed( tmp, lay, neur, ffnNetworkGetLayerNeuronSeed( network, lay, neur ) );
-
-      ffnNetworkSetLayerNeuronBias( tmp, lay, neur, ffnNetworkGetLayerNeuronBias( network, lay, neur ) );
-
-      for( src = 0; src < ffnNetworkGetLayerNumConnections( network, lay ); src++ ) {
-	ffnNetworkSetLayerNeuronWeight( tmp, lay, neur, src, ffnNetworkGetLayerNeuronWeight( network, lay, neur, src ) );
+    tmp->layers[lay] = ffnLayerCopy( network->layers[lay] );
+    if( tmp->layers[lay] == NULL ) {
+      while( lay-- ) {
+	ffnLayerDestroy( tmp->layers[lay] );
       }
-
-      ffnNetworkSetLayerNeuronActivation( tmp, lay, neur, ffnNetworkGetLayerNeuronActivation( network, lay, neur ) );
+      free( tmp->layers );
+      free( tmp );
+      return NULL;
     }
   }
 
@@ -113,6 +395,76 @@ void ffnNetworkDestroy( ffn_network_t *network )
   free( network );
 }
 
+ffn_network_t *ffnNetworkPrune( ffn_network_t *network, float threshold )
+{
+  assert( network != NULL );
+
+  float *thresholds = malloc( sizeof(float) * network->numLayers );
+  if( thresholds == NULL ) {
+    return NULL;
+  }
+
+  uint64_t lay;
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    thresholds[lay] = threshold;
+  }
+
+  ffn_network_t *tmp = pruneLayers( network, thresholds );
+  free( thresholds );
+
+  return tmp;
+}
+
+ffn_network_t *ffnNetworkPruneToSparsity( ffn_network_t *network, double sparsity )
+{
+  assert( network != NULL );
+  assert( sparsity >= 0.0 && sparsity <= 1.0 );
+
+  float *thresholds = malloc( sizeof(float) * network->numLayers );
+  if( thresholds == NULL ) {
+    return NULL;
+  }
+
+  uint64_t lay, neur, src;
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    ffn_layer_t *layer = network->layers[lay];
+    uint64_t numWeights = 0;
+    for( neur = 0; neur < ffnLayerGetNumNeurons( layer ); neur++ ) {
+      numWeights += ffnLayerGetNeuronNumConnections( layer, neur );
+    }
+
+    uint64_t numRemoved = (uint64_t)(sparsity * numWeights);
+    if( numRemoved == 0 ) {
+      // Keep everything, including weights that are exactly zero
+      thresholds[lay] = -1.0;
+      continue;
+    }
+
+    float *magnitudes = malloc( sizeof(float) * numWeights );
+    if( magnitudes == NULL ) {
+      free( thresholds );
+      return NULL;
+    }
+
+    uint64_t i = 0;
+    for( neur = 0; neur < ffnLayerGetNumNeurons( layer ); neur++ ) {
+      for( src = 0; src < ffnLayerGetNeuronNumConnections( layer, neur ); src++ ) {
+	magnitudes[i++] = fabsf( ffnLayerGetNeuronWeight( layer, neur, src ) );
+      }
+    }
+    qsort( magnitudes, numWeights, sizeof(float), compFloat );
+
+    // Everything up to and including the last removed magnitude goes
+    thresholds[lay] = magnitudes[numRemoved - 1];
+    free( magnitudes );
+  }
+
+  ffn_network_t *tmp = pruneLayers( network, thresholds );
+  free( thresholds );
+
+  return tmp;
+}
+
 ffn_network_t *ffnNetworkCombineOnWeights( ffn_network_t *mother, ffn_network_t *father )
 {
   assert( mother != NULL );
@@ -122,7 +474,8 @@ ffn_network_t *ffnNetworkCombineOnWeights( ffn_network_t *mother, ffn_network_t
 
   // Networks have to have exactly the same structure
   if( mother->numInputs  != father->numInputs ||
-      mother->numLayers  != father->numLayers ) {
+      mother->numLayers  != father->numLayers ||
+      ffnNetworkIsPruned( mother ) || ffnNetworkIsPruned( father ) ) {
     return NULL;
   }
   for( lay = 0; lay < mother->numLayers; lay++ ) {
@@ -145,6 +498,7 @@ ffn_network_t *ffnNetworkCombineOnWeights( ffn_network_t *mother, ffn_network_t
   if( tmp == NULL ) {
     return NULL;
   }
+  tmp->activationMode = mother->activationMode;
 
   for( lay = 0; lay < tmp->numLayers; lay++ ) {
     for( neur = 0; neur < ffnLayerGetNumNeurons( tmp->layers[lay] ); neur++ ) {
@@ -158,7 +512,7 @@ ffn_network_t *ffnNetworkCombineOnWeights( ffn_network_t *mother, ffn_network_t
 				    ffnNetworkGetLayerNeuronBias( mother, lay, neur ) :
 				    ffnNetworkGetLayerNeuronBias( father, lay, neur ) );
 
-      for( src = 0; src < ffnLayerGetNumConnections( tmp->layers[lay] ); src++ ) {
+      for( src = 0; src < ffnLayerGetNeuronNumConnections( tmp->layers[lay], neur ); src++ ) {
 	ffnNetworkSetLayerNeuronWeight( tmp, lay, neur, src,
 					rand() & 1 ?
 					ffnNetworkGetLayerNeuronWeight( mother, lay, neur, src ) :
@@ -184,7 +538,8 @@ ffn_network_t *ffnNetworkCombineOnNeurons( ffn_network_t *mother, ffn_network_t
 
   // Networks have to have exactly the same structure
   if( mother->numInputs  != father->numInputs ||
-      mother->numLayers  != father->numLayers ) {
+      mother->numLayers  != father->numLayers ||
+      ffnNetworkIsPruned( mother ) || ffnNetworkIsPruned( father ) ) {
     return NULL;
   }
   for( lay = 0; lay < mother->numLayers; lay++ ) {
@@ -207,6 +562,7 @@ ffn_network_t *ffnNetworkCombineOnNeurons( ffn_network_t *mother, ffn_network_t
   if( tmp == NULL ) {
     return NULL;
   }
+  tmp->activationMode = mother->activationMode;
 
   for( lay = 0; lay < tmp->numLayers; lay++ ) {
     for( neur = 0; neur < ffnLayerGetNumNeurons( tmp->layers[lay] ); neur++ ) {
@@ -222,7 +578,7 @@ ffn_network_t *ffnNetworkCombineOnNeurons( ffn_network_t *mother, ffn_network_t
       ffnNetworkSetLayerNeuronBias( tmp, lay, neur,
 				    ffnNetworkGetLayerNeuronBias( parent, lay, neur ) );
 
-      for( src = 0; src < ffnLayerGetNumConnections( tmp->layers[lay] ); src++ ) {
+      for( src = 0; src < ffnLayerGetNeuronNumConnections( tmp->layers[lay], neur ); src++ ) {
 	ffnNetworkSetLayerNeuronWeight( tmp, lay, neur, src,
 					ffnNetworkGetLayerNeuronWeight( parent, lay, neur, src ) );
       }
@@ -251,17 +607,121 @@ void ffnNetworkRun( ffn_network_t *network, float *inputs )
   assert( inputs != NULL );
 
   uint64_t lay;
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    ffnNetworkRunLayer( network, lay, inputs );
+  }
+}
+
+void ffnNetworkRunLayer( ffn_network_t *network, uint64_t layer, float *inputs )
+{
+  assert( network != NULL );
+  assert( layer < network->numLayers );
+
+  activation_mode_t mode = network->activationMode;
+  if( mode == activation_mode_default ) {
+    mode = activationGetDefaultMode();
+  }
 
   // Special treatment for first layer
-  ffnLayerRun( network->layers[0], inputs );
+  if( layer == 0 ) {
+    assert( inputs != NULL );
+    ffnLayerRunMode( network->layers[0], inputs, mode );
+  } else {
+    ffnLayerRunMode( network->layers[layer],
+		     ffnLayerGetValues( network->layers[layer-1] ), mode );
+  }
+}
+
+void ffnNetworkRunU8( ffn_network_t *network, const uint8_t *inputs, float scale )
+{
+  assert( network != NULL );
+  assert( inputs != NULL );
+
+  uint64_t lay;
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    ffnNetworkRunLayerU8( network, lay, inputs, scale );
+  }
+}
+
+void ffnNetworkRunLayerU8( ffn_network_t *network, uint64_t layer, const uint8_t *inputs, float scale )
+{
+  assert( network != NULL );
+  assert( layer < network->numLayers );
 
-  // Any remaining layers
-  for( lay = 1; lay < network->numLayers; lay++ ) {
-    ffnLayerRun( network->layers[lay],
-		 ffnLayerGetValues( network->layers[lay-1] ) );
+  activation_mode_t mode = network->activationMode;
+  if( mode == activation_mode_default ) {
+    mode = activationGetDefaultMode();
+  }
+
+  // Only the first layer reads the bytes, the others work as usual
+  if( layer == 0 ) {
+    assert( inputs != NULL );
+    ffnLayerRunU8Mode( network->layers[0], inputs, scale, mode );
+  } else {
+    ffnLayerRunMode( network->layers[layer],
+		     ffnLayerGetValues( network->layers[layer-1] ), mode );
   }
 }
 
+void ffnNetworkSetActivationMode( ffn_network_t *network, activation_mode_t mode )
+{
+  assert( network != NULL );
+
+  // Set up the tables here rather than on every activation
+  if( mode == activation_mode_fast ) {
+    activationInitTables();
+  }
+  network->activationMode = mode;
+}
+
+activation_mode_t ffnNetworkGetActivationMode( ffn_network_t *network )
+{
+  assert( network != NULL );
+  return network->activationMode;
+}
+
+bool ffnNetworkCompareOutputs( ffn_network_t *reference, ffn_network_t *network,
+			       uint64_t numSamples, float *samples, ffn_deviation_t *deviation )
+{
+  assert( reference != NULL );
+  assert( network != NULL );
+  assert( deviation != NULL );
+
+  if( reference->numInputs != network->numInputs ||
+      ffnNetworkGetNumOutputs( reference ) != ffnNetworkGetNumOutputs( network ) ) {
+    return false;
+  }
+
+  uint64_t sample, out;
+  uint64_t numOutputs = ffnNetworkGetNumOutputs( reference );
+  double sumError = 0;
+
+  deviation->numSamples = numSamples;
+  deviation->maxAbsError = 0;
+  deviation->meanAbsError = 0;
+
+  for( sample = 0; sample < numSamples; sample++ ) {
+    float *inputs = &samples[sample * reference->numInputs];
+    ffnNetworkRun( reference, inputs );
+    ffnNetworkRun( network, inputs );
+
+    for( out = 0; out < numOutputs; out++ ) {
+      double error = fabs( (double)ffnNetworkGetOutputValue( reference, out ) -
+			   (double)ffnNetworkGetOutputValue( network, out ) );
+      sumError += error;
+      if( error > deviation->maxAbsError ) {
+	deviation->maxAbsError = error;
+      }
+    }
+  }
+
+  if( numSamples > 0 ) {
+    deviation->meanAbsError = sumError / (double)(numSamples * numOutputs);
+  }
+
+  return true;
+}
+
 float ffnNetworkGetOutputValue( ffn_network_t *network, uint64_t idx )
 {
   assert( network != NULL );
@@ -328,6 +788,11 @@ ffn_network_t *ffnNetworkUnserialise( uint64_t len, uint8_t *data )
 {
   assert( data != NULL );
 
+  if( len >= FFN_SPARSE_MAGIC_LEN &&
+      memcmp( data, FFN_SPARSE_MAGIC, FFN_SPARSE_MAGIC_LEN ) == 0 ) {
+    return unserialiseSparse( len, data );
+  }
+
   if( len < 2 * sizeof(uint64_t) ) {
     return NULL;
   }
@@ -417,7 +882,7 @@ ffn_network_t *ffnNetworkUnserialise( uint64_t len, uint8_t *data )
       ffnNetworkSetLayerNeuronSeed( tmp, lay, neur, seed );
 
       // Weights
-      for( src = 0; src < ffnLayerGetNumConnections( tmp->layers[lay] ); src++ ) {
+      for( src = 0; src < ffnLayerGetNeuronNumConnections( tmp->layers[lay], neur ); src++ ) {
 	uint32_t val = 0;
 	val <<= 8; val |= data[i++];
 	val <<= 8; val |= data[i++];
@@ -452,6 +917,10 @@ uint64_t ffnNetworkSerialise( ffn_network_t *network, uint8_t **data )
   assert( network != NULL );
   assert( data != NULL );
 
+  if( ffnNetworkIsPruned( network ) ) {
+    return serialiseSparse( network, data );
+  }
+
   uint64_t length = 0;
   uint8_t *bytes;
 
@@ -628,6 +1097,43 @@ uint64_t ffnNetworkGetNumOutputConnections( ffn_network_t *network )
   return ffnNetworkGetLayerNumConnections( network, network->numLayers - 1 );
 }
 
+uint64_t ffnNetworkGetLayerNeuronNumConnections( ffn_network_t *network, uint64_t layer, uint64_t neuron )
+{
+  assert( network != NULL );
+  assert( layer < network->numLayers );
+  assert( neuron < ffnLayerGetNumNeurons( network->layers[layer] ) );
+
+  return ffnLayerGetNeuronNumConnections( network->layers[layer], neuron );
+}
+
+uint64_t ffnNetworkGetNumWeights( ffn_network_t *network )
+{
+  assert( network != NULL );
+
+  uint64_t lay, neur, numWeights = 0;
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    for( neur = 0; neur < ffnLayerGetNumNeurons( network->layers[lay] ); neur++ ) {
+      numWeights += ffnLayerGetNeuronNumConnections( network->layers[lay], neur );
+    }
+  }
+
+  return numWeights;
+}
+
+bool ffnNetworkIsPruned( ffn_network_t *network )
+{
+  assert( network != NULL );
+
+  uint64_t lay;
+  for( lay = 0; lay < network->numLayers; lay++ ) {
+    if( ffnLayerIsPruned( network->layers[lay] ) ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 void ffnNetworkSetLayerNeuronSeed( ffn_network_t *network, uint64_t layer, uint64_t neuron, uint64_t seed )
 {
   assert( network != NULL );
@@ -669,7 +1175,7 @@ void ffnNetworkSetLayerNeuronWeight( ffn_network_t *network, uint64_t layer, uin
   assert( network != NULL );
   assert( layer < network->numLayers );
   assert( neuron < ffnLayerGetNumNeurons( network->layers[layer] ) );
-  assert( source < ffnLayerGetNumConnections( network->layers[layer] ) );
+  assert( source < ffnLayerGetNeuronNumConnections( network->layers[layer], neuron ) );
 
   ffnLayerSetNeuronWeight( network->layers[layer], neuron, source, weight );
 }
@@ -679,7 +1185,7 @@ float ffnNetworkGetLayerNeuronWeight( ffn_network_t *network, uint64_t layer, ui
   assert( network != NULL );
   assert( layer < network->numLayers );
   assert( neuron < ffnLayerGetNumNeurons( network->layers[layer] ) );
-  assert( source < ffnLayerGetNumConnections( network->layers[layer] ) );
+  assert( source < ffnLayerGetNeuronNumConnections( network->layers[layer], neuron ) );
 
   return ffnLayerGetNeuronWeight( network->layers[layer], neuron, source );
 }
@@ -763,7 +1269,7 @@ void ffnNetworkPrint( ffn_network_t *network )
     printf( "      connections: [\n" );
     for( j = 0; j < ffnLayerGetNumNeurons( network->layers[i] ); j++ ) {
       printf( "        [\n" );
-      for( k = 0; k < ffnLayerGetNumConnections( network->layers[i] ); k++ ) {
+      for( k = 0; k < ffnLayerGetNeuronNumConnections( network->layers[i], j ); k++ ) {
 	printf( "          %llu,\n", (unsigned long long)ffnLayerGetNeuronConnection( network->layers[i], j, k ) );
       }
       printf( "        ],\n" );
@@ -778,7 +1284,7 @@ void ffnNetworkPrint( ffn_network_t *network )
     printf( "      weights: [\n" );
     for( j = 0; j < ffnLayerGetNumNeurons( network->layers[i] ); j++ ) {
       printf( "        [\n" );
-      for( k = 0; k < ffnLayerGetNumConnections( network->layers[i] ); k++ ) {
+      for( k = 0; k < ffnLayerGetNeuronNumConnections( network->layers[i], j ); k++ ) {
 	printf( "          %f,\n", ffnLayerGetNeuronWeight( network->layers[i], j, k ) );
       }
       printf( "        ],\n" );
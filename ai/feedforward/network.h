@@ -16,11 +16,22 @@ typedef struct ffn_network_s ffn_network_t;
 typedef struct ffn_layer_s ffn_layer_t;
 typedef struct ffn_neuron_s ffn_neuron_t;
 
+// Output deviation between two networks, see ffnNetworkCompareOutputs().
+typedef struct ffn_deviation_s {
+  uint64_t numSamples;
+  // Largest and mean absolute difference over all outputs and samples
+  double   maxAbsError;
+  double   meanAbsError;
+} ffn_deviation_t;
+
 typedef struct ffn_network_s {
   // Size of network.
   uint64_t      numInputs;
   uint64_t      numLayers;
   ffn_layer_t **layers;
+  // How activation functions are calculated when running the network.  It's
+  //  a runtime setting that is copied and inherited but not saved.
+  activation_mode_t activationMode;
 } ffn_network_t;
 
 /*******************************************
@@ -34,16 +45,28 @@ ffn_network_t *ffnNetworkCreate( uint64_t inputs, uint64_t layers, ffn_layer_par
 // Create a duplicate of another network, but with its own memory.
 ffn_network_t *ffnNetworkCopy( ffn_network_t *network );
 
+// Create a compacted inference network that only keeps connections with weights
+//  larger than <threshold> in absolute value.  Each neuron gets its own list of
+//  connections, so the result can't be used for combining with other networks,
+//  but it can be run, mutated, saved and loaded like any other network.
+ffn_network_t *ffnNetworkPrune( ffn_network_t *network, float threshold );
+
+// Same as ffnNetworkPrune(), but the threshold is chosen per layer so that
+//  approximately <sparsity> (0.0 - 1.0) of its connections are removed.
+ffn_network_t *ffnNetworkPruneToSparsity( ffn_network_t *network, double sparsity );
+
 // Free memory used by a network.
 void ffnNetworkDestroy( ffn_network_t *network );
 
-// Generate a network from a specification file.
+// Generate a network from a specification file.  The activation mode isn't
+//  part of the file, so loaded networks get activation_mode_default.
 ffn_network_t *ffnNetworkLoadFile( char *filename );
 
 // Save a network to a specification file.
 bool ffnNetworkSaveFile( ffn_network_t *network, char *filename );
 
-// Generate a network from a byte stream.
+// Generate a network from a byte stream, with activation_mode_default just
+//  like ffnNetworkLoadFile().
 ffn_network_t *ffnNetworkUnserialise( uint64_t len, uint8_t *data );
 
 // Generate a byte stream from a network, will allocate memory for *data
@@ -61,10 +84,12 @@ ffn_layer_params_t *ffnNetworkGetLayerParams( ffn_network_t *network );
  *******************************************/
 // Randomly combine two networks.  Their dimensions must be identical.
 //  Goes through all neurons and selects weights randomly from parents.
+//  The child gets the activation mode of <mother>.
 ffn_network_t *ffnNetworkCombineOnWeights( ffn_network_t *mother, ffn_network_t *father );
 
 // Randomly combine two networks.  Their dimensions must be identical.
 //  Goes through all layers and selects neurons randomly from parents.
+//  The child gets the activation mode of <mother>.
 ffn_network_t *ffnNetworkCombineOnNeurons( ffn_network_t *mother, ffn_network_t *father );
 
 // Randomly change some weight/bias or connection seed in the network.
@@ -77,6 +102,25 @@ void ffnNetworkMutate( ffn_network_t *network, double mutateRate );
  *******************************************/
 // Run the network once with the specified input array.
 void ffnNetworkRun( ffn_network_t *network, float *inputs );
+// Run a single layer of the network, <inputs> is only used by the first layer,
+//  the others read the values of the layer before.  Running every layer in
+//  order is the same as ffnNetworkRun(), mostly useful for measurements.
+void ffnNetworkRunLayer( ffn_network_t *network, uint64_t layer, float *inputs );
+// Same as the two above, but with byte inputs straight from a uint8 sensor.
+//  Input i is inputs[i] * <scale>, which gives the same result as running
+//  the network on the scaled floats, apart from rounding.
+void ffnNetworkRunU8( ffn_network_t *network, const uint8_t *inputs, float scale );
+void ffnNetworkRunLayerU8( ffn_network_t *network, uint64_t layer, const uint8_t *inputs, float scale );
+
+// Run two networks with the same dimensions on <numSamples> input arrays laid out
+//  after each other in <samples> and measure how much the outputs differ.
+bool ffnNetworkCompareOutputs( ffn_network_t *reference, ffn_network_t *network,
+			       uint64_t numSamples, float *samples, ffn_deviation_t *deviation );
+
+// Choose between exact and fast activation functions for a network.  The
+//  default mode follows activationSetDefaultMode().
+void              ffnNetworkSetActivationMode( ffn_network_t *network, activation_mode_t mode );
+activation_mode_t ffnNetworkGetActivationMode( ffn_network_t *network );
 
 // Get the output value for the specified output neuron.
 float ffnNetworkGetOutputValue( ffn_network_t *network, uint64_t idx );
@@ -87,9 +131,18 @@ uint64_t ffnNetworkGetNumLayers( ffn_network_t *network );
 uint64_t ffnNetworkGetLayerNumNeurons( ffn_network_t *network, uint64_t layer );
 uint64_t ffnNetworkGetNumOutputs( ffn_network_t *network );
 
-// Get the number of connections each neuron in a layer has.
+// Get the number of connections each neuron in a layer has, for pruned layers
+//  the most any of its neurons has.
 uint64_t ffnNetworkGetLayerNumConnections( ffn_network_t *network, uint64_t layer );
 uint64_t ffnNetworkGetOutputNumConnections( ffn_network_t *network );
+// Pruned networks have a different number of connections for each neuron.
+uint64_t ffnNetworkGetLayerNeuronNumConnections( ffn_network_t *network, uint64_t layer, uint64_t neuron );
+
+// Total number of weights in the network, not counting biases.
+uint64_t ffnNetworkGetNumWeights( ffn_network_t *network );
+
+// True if the network has been created by ffnNetworkPrune().
+bool ffnNetworkIsPruned( ffn_network_t *network );
 
 // Manipulate a layer.  If a seed is set to 0, the connections will be linear rather than random.
 void              ffnNetworkSetLayerNeuronSeed(       ffn_network_t *network, uint64_t layer, uint64_t neuron, uint64_t seed );
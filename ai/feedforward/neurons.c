@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
@@ -18,9 +19,14 @@ typedef struct ffn_neuron_s {
 
   // What type of activation function to use for neuron
   activation_type_t activation;
+  // The exact and fast versions of it, resolved once when it's set
+  act_func exactFunction;
+  act_func fastFunction;
 
   // Seed used to randomly connect neuron to inputs
   uint64_t seed;
+  // Connections were given explicitly rather than generated from the seed
+  bool explicitConnections;
   // Number of connections to previous layer
   uint64_t numConnections;
   // The array of connections
@@ -71,6 +77,25 @@ static void mutateValue( float *target )
   }
 }
 
+static void setActivation( ffn_neuron_t *neuron, activation_type_t activation )
+{
+  neuron->activation = activation;
+  neuron->exactFunction = activationToFunction( activation );
+  neuron->fastFunction = activationToFastFunction( activation );
+}
+
+static int compConnection( const void *a, const void *b )
+{
+  uint64_t c1 = *(const uint64_t*)a;
+  uint64_t c2 = *(const uint64_t*)b;
+
+  if( c1 < c2 )
+    return -1;
+  if( c1 == c2 )
+    return 0;
+  return 1;
+}
+
 // A seed = 0 creates a linear mapping rather than a random one
 static void createConnections( uint64_t seed, uint64_t sourceSize, uint64_t numConnections, uint64_t positions[] )
 {
@@ -113,6 +138,7 @@ ffn_neuron_t *ffnNeuronCreate( uint64_t numInputs, activation_type_t activationT
   }
 
   tmp->seed = seed;
+  tmp->explicitConnections = false;
   createConnections( tmp->seed,
 		     numInputs,
 		     tmp->numConnections,
@@ -126,7 +152,7 @@ ffn_neuron_t *ffnNeuronCreate( uint64_t numInputs, activation_type_t activationT
     return NULL;
   }
 
-  tmp->activation = activationType;
+  setActivation( tmp, activationType );
   tmp->bias = randomVal( -1, 1 );
   for( i = 0; i < numConnections; i++ ) {
     tmp->weights[i] = randomVal( -1, 1 );
@@ -135,6 +161,78 @@ ffn_neuron_t *ffnNeuronCreate( uint64_t numInputs, activation_type_t activationT
   return tmp;
 }
 
+ffn_neuron_t *ffnNeuronCreateExplicit( uint64_t numInputs, activation_type_t activationType, uint64_t numConnections, const uint64_t *connections, const float *weights, float bias )
+{
+  ffn_neuron_t *tmp = malloc(sizeof(ffn_neuron_t));
+  if( tmp == NULL ) {
+    return NULL;
+  }
+
+  tmp->numInputs = numInputs;
+  setActivation( tmp, activationType );
+  tmp->seed = 0;
+  tmp->explicitConnections = true;
+  tmp->bias = bias;
+
+  tmp->numConnections = numConnections;
+  // Always allocate something so a neuron without connections behaves like any other
+  tmp->connections = malloc( sizeof(uint64_t) * (numConnections ? numConnections : 1) );
+  if( tmp->connections == NULL ) {
+    free( tmp );
+    return NULL;
+  }
+
+  tmp->weights = malloc( sizeof(float) * (numConnections ? numConnections : 1) );
+  if( tmp->weights == NULL ) {
+    fprintf( stderr, "ffnNeuronCreateExplicit() - Unable to allocate memory\n" );
+    free( tmp->connections );
+    free( tmp );
+    return NULL;
+  }
+
+  uint64_t i;
+  for( i = 0; i < numConnections; i++ ) {
+    assert( connections[i] < numInputs );
+    tmp->connections[i] = connections[i];
+    tmp->weights[i] = weights[i];
+  }
+
+  return tmp;
+}
+
+// Copies connections and weights directly instead of regenerating connections
+//  from the seed, which makes this a lot cheaper than creating a new neuron.
+ffn_neuron_t *ffnNeuronCopy( ffn_neuron_t *neuron )
+{
+  assert( neuron != NULL );
+
+  ffn_neuron_t *tmp = malloc(sizeof(ffn_neuron_t));
+  if( tmp == NULL ) {
+    return NULL;
+  }
+
+  *tmp = *neuron;
+
+  // Pruned neurons may have no connections, malloc( 0 ) could return NULL
+  tmp->connections = malloc( sizeof(uint64_t) * (neuron->numConnections ? neuron->numConnections : 1) );
+  if( tmp->connections == NULL ) {
+    free( tmp );
+    return NULL;
+  }
+  memcpy( tmp->connections, neuron->connections, sizeof(uint64_t) * neuron->numConnections );
+
+  tmp->weights = malloc( sizeof(float) * (neuron->numConnections ? neuron->numConnections : 1) );
+  if( tmp->weights == NULL ) {
+    fprintf( stderr, "ffnNeuronCopy() - Unable to allocate memory\n" );
+    free( tmp->connections );
+    free( tmp );
+    return NULL;
+  }
+  memcpy( tmp->weights, neuron->weights, sizeof(float) * neuron->numConnections );
+
+  return tmp;
+}
+
 void ffnNeuronDestroy( ffn_neuron_t *neuron )
 {
   assert( neuron != NULL );
@@ -145,6 +243,11 @@ void ffnNeuronDestroy( ffn_neuron_t *neuron )
 
 // Run a neuron and return its result
 float ffnNeuronRun( ffn_neuron_t *neuron, float *inputs )
+{
+  return ffnNeuronRunMode( neuron, inputs, activation_mode_default );
+}
+
+float ffnNeuronRunMode( ffn_neuron_t *neuron, float *inputs, activation_mode_t mode )
 {
   assert( neuron != NULL );
   assert( inputs != NULL );
@@ -152,7 +255,7 @@ float ffnNeuronRun( ffn_neuron_t *neuron, float *inputs )
   int i;
   float sum = neuron->bias;
 
-  if( neuron->seed != 0 ) {
+  if( neuron->seed != 0 || neuron->explicitConnections ) {
     for( i = 0; i < neuron->numConnections; i++ ) {
       sum += inputs[neuron->connections[i]] * neuron->weights[i];
     }
@@ -163,7 +266,83 @@ float ffnNeuronRun( ffn_neuron_t *neuron, float *inputs )
     }
   }
 
-  return activationToFunction( neuron->activation ) ( sum );
+  if( mode == activation_mode_default ) {
+    mode = activationGetDefaultMode();
+  }
+  return (mode == activation_mode_fast ? neuron->fastFunction : neuron->exactFunction) ( sum );
+}
+
+float ffnNeuronRunU8Mode( ffn_neuron_t *neuron, const uint8_t *inputs, float scale, activation_mode_t mode )
+{
+  assert( neuron != NULL );
+  assert( inputs != NULL );
+
+  int i;
+  float sum = 0;
+
+  if( neuron->seed != 0 || neuron->explicitConnections ) {
+    for( i = 0; i < neuron->numConnections; i++ ) {
+      sum += inputs[neuron->connections[i]] * neuron->weights[i];
+    }
+  } else {
+    for( i = 0; i < neuron->numConnections; i++ ) {
+      sum += inputs[i] * neuron->weights[i];
+    }
+  }
+
+  if( mode == activation_mode_default ) {
+    mode = activationGetDefaultMode();
+  }
+  // Every input has the same scale, so it's applied once to the whole sum
+  return (mode == activation_mode_fast ? neuron->fastFunction : neuron->exactFunction) ( neuron->bias + sum * scale );
+}
+
+ffn_neuron_t *ffnNeuronPrune( ffn_neuron_t *neuron, float threshold )
+{
+  assert( neuron != NULL );
+
+  uint64_t i, numKept = 0;
+  uint64_t *kept = malloc( sizeof(uint64_t) * (neuron->numConnections ? neuron->numConnections : 1) );
+  float *weights = malloc( sizeof(float) * (neuron->numConnections ? neuron->numConnections : 1) );
+  if( kept == NULL || weights == NULL ) {
+    free( kept );
+    free( weights );
+    return NULL;
+  }
+
+  // Gather the remaining inputs in order so duplicates end up next to each other
+  for( i = 0; i < neuron->numConnections; i++ ) {
+    if( fabsf( neuron->weights[i] ) > threshold ) {
+      kept[numKept++] = ffnNeuronGetConnection( neuron, i );
+    }
+  }
+  qsort( kept, numKept, sizeof(uint64_t), compConnection );
+
+  uint64_t numUnique = 0;
+  for( i = 0; i < numKept; i++ ) {
+    if( numUnique == 0 || kept[numUnique-1] != kept[i] ) {
+      kept[numUnique++] = kept[i];
+    }
+  }
+
+  // Sum the weights of every connection going to the same input
+  for( i = 0; i < numUnique; i++ ) {
+    weights[i] = 0;
+  }
+  for( i = 0; i < neuron->numConnections; i++ ) {
+    if( fabsf( neuron->weights[i] ) > threshold ) {
+      uint64_t source = ffnNeuronGetConnection( neuron, i );
+      uint64_t *pos = bsearch( &source, kept, numUnique, sizeof(uint64_t), compConnection );
+      weights[pos - kept] += neuron->weights[i];
+    }
+  }
+
+  ffn_neuron_t *tmp = ffnNeuronCreateExplicit( neuron->numInputs, neuron->activation,
+					       numUnique, kept, weights, neuron->bias );
+  free( kept );
+  free( weights );
+
+  return tmp;
 }
 
 void ffnNeuronMutate( ffn_neuron_t *neuron, double mutateRate, uint32_t allowedActivations )
@@ -184,7 +363,7 @@ void ffnNeuronMutate( ffn_neuron_t *neuron, double mutateRate, uint32_t allowedA
 
   // Change a few activation functions
   if( rand() / (RAND_MAX + 1.0) < mutateRate  / 10.0 ) {
-    neuron->activation = randomActivation( allowedActivations );
+    setActivation( neuron, randomActivation( allowedActivations ) );
   }
 }
 
@@ -192,6 +371,11 @@ void ffnNeuronSetSeed( ffn_neuron_t *neuron, uint64_t seed )
 {
   assert( neuron != NULL );
 
+  // Explicit connections can't be regenerated from a seed
+  if( neuron->explicitConnections ) {
+    return;
+  }
+
   if( seed != neuron->seed ) {
     neuron->seed = seed;
     createConnections( neuron->seed,
@@ -242,7 +426,7 @@ void ffnNeuronSetActivation( ffn_neuron_t *neuron, activation_type_t activation
 {
   assert( neuron != NULL );
 
-  neuron->activation = activation;
+  setActivation( neuron, activation );
 }
 
 activation_type_t ffnNeuronGetActivation( ffn_neuron_t *neuron )
@@ -259,3 +443,17 @@ uint64_t ffnNeuronGetConnection( ffn_neuron_t *neuron, uint64_t index )
 
   return neuron->connections[index];
 }
+
+uint64_t ffnNeuronGetNumConnections( ffn_neuron_t *neuron )
+{
+  assert( neuron != NULL );
+
+  return neuron->numConnections;
+}
+
+bool ffnNeuronIsExplicit( ffn_neuron_t *neuron )
+{
+  assert( neuron != NULL );
+
+  return neuron->explicitConnections;
+}
@@ -17,6 +17,14 @@ typedef struct ffn_neuron_s ffn_neuron_t;
 // Creates a new neuron
 ffn_neuron_t *ffnNeuronCreate( uint64_t numInputs, activation_type_t activationType, uint64_t numConnections, uint64_t seed, bool initialise );
 
+// Creates a neuron from an explicit list of connections and weights, the
+//  connections are not tied to a seed and every neuron can have a different
+//  number of them.  Used for compacted networks.
+ffn_neuron_t *ffnNeuronCreateExplicit( uint64_t numInputs, activation_type_t activationType, uint64_t numConnections, const uint64_t *connections, const float *weights, float bias );
+
+// Creates an exact duplicate of a neuron with its own memory.
+ffn_neuron_t *ffnNeuronCopy( ffn_neuron_t *neuron );
+
 // Free memory et c.
 void ffnNeuronDestroy( ffn_neuron_t *neuron );
 
@@ -25,6 +33,16 @@ void ffnNeuronDestroy( ffn_neuron_t *neuron );
  *******************************************/
 // Run a neuron and return its result.
 float ffnNeuronRun( ffn_neuron_t *neuron, float *inputs );
+// Same as above, but with the activation function calculated as given by <mode>.
+//  Fast mode expects activationInitTables() to have been called.
+float ffnNeuronRunMode( ffn_neuron_t *neuron, float *inputs, activation_mode_t mode );
+// Same as above, but the inputs are bytes and input i is inputs[i] * <scale>.
+float ffnNeuronRunU8Mode( ffn_neuron_t *neuron, const uint8_t *inputs, float scale, activation_mode_t mode );
+
+// Creates an explicit neuron with only the connections whose weights have an
+//  absolute value larger than <threshold>.  Connections to the same input are
+//  merged and the remaining ones are sorted on input index.
+ffn_neuron_t *ffnNeuronPrune( ffn_neuron_t *neuron, float threshold );
 
 // Perform random mutations in the neuron.
 void ffnNeuronMutate( ffn_neuron_t *neuron, double mutateRate, uint32_t allowedActivations );
@@ -39,5 +57,7 @@ float             ffnNeuronGetWeight(     ffn_neuron_t *neuron, uint64_t source
 void              ffnNeuronSetActivation( ffn_neuron_t *neuron, activation_type_t activation );
 activation_type_t ffnNeuronGetActivation( ffn_neuron_t *neuron );
 uint64_t          ffnNeuronGetConnection( ffn_neuron_t *neuron, uint64_t index );
+uint64_t          ffnNeuronGetNumConnections( ffn_neuron_t *neuron );
+bool              ffnNeuronIsExplicit( ffn_neuron_t *neuron );
 
 #endif
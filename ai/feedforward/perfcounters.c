@@ -0,0 +1,232 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "perfcounters.h"
+
+#ifdef __linux__
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#endif
+
+static const char *counterNames[perf_counter_count] = {
+  [perf_cycles]       = "cycles",
+  [perf_instructions] = "instructions",
+  [perf_cache_misses] = "cache_misses",
+  [perf_dtlb_misses]  = "dtlb_misses",
+};
+
+static bool enabled = false;
+static bool available[perf_counter_count] = {false, };
+
+const char *perfCounterName( perf_counter_t counter )
+{
+  return counterNames[counter];
+}
+
+bool perfCountersEnabled( void )
+{
+  return enabled;
+}
+
+bool perfCountersAvailable( perf_counter_t counter )
+{
+  return enabled && available[counter];
+}
+
+#ifdef __linux__
+
+static const struct {
+  uint32_t type;
+  uint64_t config;
+} counterEvents[perf_counter_count] = {
+  [perf_cycles]       = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  [perf_instructions] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  [perf_cache_misses] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+  [perf_dtlb_misses]  = {PERF_TYPE_HW_CACHE,
+			 PERF_COUNT_HW_CACHE_DTLB |
+			 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+typedef struct perf_group_s {
+  int fd[perf_counter_count];
+  int leader;
+
+  // Position of each counter in the group read, -1 if it isn't in the group
+  int slot[perf_counter_count];
+  int numOpen;
+} perf_group_t;
+
+// Layout of a PERF_FORMAT_GROUP read with both times
+typedef struct perf_read_s {
+  uint64_t nr;
+  uint64_t timeEnabled;
+  uint64_t timeRunning;
+  uint64_t values[perf_counter_count];
+} perf_read_t;
+
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t groupKey;
+
+// Marks threads that failed to open their group so they don't keep trying
+static perf_group_t failedGroup;
+
+static void closeGroup( void *arg )
+{
+  perf_group_t *group = arg;
+  int i;
+
+  if( group == NULL || group == &failedGroup ) {
+    return;
+  }
+
+  for( i = 0; i < perf_counter_count; i++ ) {
+    if( group->fd[i] >= 0 ) {
+      close( group->fd[i] );
+    }
+  }
+  free( group );
+}
+
+static void createKey( void )
+{
+  pthread_key_create( &groupKey, closeGroup );
+}
+
+// Open every counter in <wanted> for the calling thread, all in one group so
+//  they count over exactly the same instructions.
+static perf_group_t *openGroup( const bool *wanted )
+{
+  perf_group_t *group = malloc( sizeof(perf_group_t) );
+  int i;
+
+  if( group == NULL ) {
+    return NULL;
+  }
+
+  group->leader = -1;
+  group->numOpen = 0;
+  for( i = 0; i < perf_counter_count; i++ ) {
+    group->fd[i] = -1;
+    group->slot[i] = -1;
+
+    if( !wanted[i] ) {
+      continue;
+    }
+
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof(attr) );
+    attr.size = sizeof(attr);
+    attr.type = counterEvents[i].type;
+    attr.config = counterEvents[i].config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP |
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = syscall( __NR_perf_event_open, &attr, 0, -1, group->leader, PERF_FLAG_FD_CLOEXEC );
+    if( fd < 0 ) {
+      continue;
+    }
+
+    if( group->leader < 0 ) {
+      group->leader = fd;
+    }
+    group->fd[i] = fd;
+    group->slot[i] = group->numOpen++;
+  }
+
+  if( group->numOpen == 0 ) {
+    int err = errno;
+    free( group );
+    errno = err;
+    return NULL;
+  }
+
+  return group;
+}
+
+bool perfCountersEnable( void )
+{
+  static const bool all[perf_counter_count] = {true, true, true, true};
+  perf_group_t *group;
+  int i;
+
+  pthread_once( &keyOnce, createKey );
+
+  // Probe with the calling thread, other threads open the same counters so
+  //  their results can be added up
+  group = openGroup( all );
+  if( group == NULL ) {
+    return false;
+  }
+
+  for( i = 0; i < perf_counter_count; i++ ) {
+    available[i] = group->fd[i] >= 0;
+  }
+  closeGroup( pthread_getspecific( groupKey ) );
+  pthread_setspecific( groupKey, group );
+
+  enabled = true;
+  return true;
+}
+
+bool perfCountersRead( perf_values_t *values )
+{
+  perf_group_t *group;
+  perf_read_t buf;
+  int i;
+
+  memset( values, 0, sizeof(perf_values_t) );
+  if( !enabled ) {
+    return false;
+  }
+
+  group = pthread_getspecific( groupKey );
+  if( group == NULL ) {
+    group = openGroup( available );
+    pthread_setspecific( groupKey, group ? group : &failedGroup );
+  }
+  if( group == NULL || group == &failedGroup ) {
+    return false;
+  }
+
+  if( read( group->leader, &buf, sizeof(buf) ) < (ssize_t)(3 * sizeof(uint64_t)) ) {
+    return false;
+  }
+
+  // Scale up when the kernel had to multiplex the counters with other users
+  double scale = 1.0;
+  if( buf.timeRunning > 0 && buf.timeRunning < buf.timeEnabled ) {
+    scale = (double)buf.timeEnabled / buf.timeRunning;
+  }
+
+  for( i = 0; i < perf_counter_count; i++ ) {
+    if( group->slot[i] >= 0 && group->slot[i] < buf.nr ) {
+      values->value[i] = buf.values[group->slot[i]] * scale;
+    }
+  }
+
+  return true;
+}
+
+#else
+
+bool perfCountersEnable( void )
+{
+  errno = ENOSYS;
+  return false;
+}
+
+bool perfCountersRead( perf_values_t *values )
+{
+  memset( values, 0, sizeof(perf_values_t) );
+  return false;
+}
+
+#endif
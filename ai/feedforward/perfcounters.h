@@ -0,0 +1,42 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Hardware performance counters read with perf_event_open().  Every thread
+//  that reads them gets its own counter group, opened on the first read and
+//  closed when the thread quits.  Counters that can't be opened, e.g. in a
+//  virtual machine or with a strict perf_event_paranoid, read as zero.
+typedef enum perf_counter_e {
+  perf_cycles,
+  perf_instructions,
+  perf_cache_misses,
+  perf_dtlb_misses,
+
+  perf_counter_count
+} perf_counter_t;
+
+typedef struct perf_values_s {
+  uint64_t value[perf_counter_count];
+} perf_values_t;
+
+// Turn the counters on for all threads.  Returns false, with errno set, when
+//  none of the counters are available, reads keep returning false then.
+bool perfCountersEnable( void );
+
+// Returns true if perfCountersEnable() succeeded.
+bool perfCountersEnabled( void );
+
+// Returns true if <counter> could be opened when the counters were enabled.
+bool perfCountersAvailable( perf_counter_t counter );
+
+// Short name of <counter>, e.g. "cache_misses"
+const char *perfCounterName( perf_counter_t counter );
+
+// Read the calling thread's counters into <values>.  The values only mean
+//  something relative to an earlier read on the same thread.  Returns false,
+//  with <values> zeroed, when the counters are disabled or unavailable.
+bool perfCountersRead( perf_values_t *values );
+
+#endif
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <float.h>
+
+#include "activation.h"
+
+typedef struct act_test_s {
+  const char        *name;
+  activation_type_t  type;
+  float              maxError;
+} act_test_t;
+
+// Largest absolute difference between the exact and fast version of a function
+static double measureError( activation_type_t type, float low, float high, float step, float *worstInput )
+{
+  act_func exact = activationToFunctionMode( type, activation_mode_exact );
+  act_func fast  = activationToFunctionMode( type, activation_mode_fast );
+  double worst = 0;
+  float val;
+
+  for( val = low; val <= high; val += step ) {
+    // exp() overflows in the exact softplus, the fast one keeps going
+    if( isinf( exact( val ) ) ) {
+      continue;
+    }
+
+    double error = fabs( (double)exact( val ) - (double)fast( val ) );
+    if( error > worst ) {
+      worst = error;
+      *worstInput = val;
+    }
+  }
+
+  return worst;
+}
+
+int main( void )
+{
+  const act_test_t tests[] = {
+    {"sigmoid",  activation_sigmoid,  ACT_FAST_MAX_ERROR_SIGMOID},
+    {"tanh",     activation_tanh,     ACT_FAST_MAX_ERROR_TANH},
+    {"atan",     activation_atan,     ACT_FAST_MAX_ERROR_ATAN},
+    {"softplus", activation_softplus, ACT_FAST_MAX_ERROR_SOFTPLUS},
+    {"gaussian", activation_gaussian, ACT_FAST_MAX_ERROR_GAUSSIAN},
+    {"sinc",     activation_sinc,     ACT_FAST_MAX_ERROR_SINC},
+    {"sin",      activation_sin,      ACT_FAST_MAX_ERROR_SIN},
+  };
+  const int numTests = sizeof(tests) / sizeof(tests[0]);
+  bool failed = false;
+  int i;
+
+  for( i = 0; i < numTests; i++ ) {
+    float worstInput = 0;
+    // Densely around the interesting part, coarsely far out
+    double error = measureError( tests[i].type, -64.0, 64.0, 1.0 / 4096.0, &worstInput );
+    double farError = measureError( tests[i].type, -1.0e5, 1.0e5, 0.37, &worstInput );
+    if( farError > error ) {
+      error = farError;
+    }
+
+    bool ok = error <= tests[i].maxError;
+    printf( "%-9s max error %.3e at %g (limit %.3e) %s\n",
+	    tests[i].name, error, worstInput, tests[i].maxError, ok ? "OK" : "FAIL" );
+    if( !ok ) {
+      failed = true;
+    }
+  }
+
+  // NaN has to survive in both modes
+  for( i = 0; i < numTests; i++ ) {
+    float res = activationToFunctionMode( tests[i].type, activation_mode_fast )( NAN );
+    if( res == res ) {
+      printf( "%-9s does not return NaN for NaN\n", tests[i].name );
+      failed = true;
+    }
+  }
+
+  // Out of range values have no phase left but must still behave like sinf()
+  const float farValues[] = {INFINITY, -INFINITY, 1.0e30, -FLT_MAX};
+  int j;
+  for( j = 0; j < sizeof(farValues) / sizeof(farValues[0]); j++ ) {
+    float res = act_sin_fast( farValues[j] );
+    float ref = act_sin( farValues[j] );
+    if( !(res == ref || (res != res && ref != ref)) ) {
+      printf( "sin       returns %g instead of %g for %g\n", res, ref, farValues[j] );
+      failed = true;
+    }
+  }
+
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "network.h"
+
+#define TEST_INPUTS  64
+#define TEST_LAYERS  3
+#define TEST_SAMPLES 64
+
+// Sparsities every layer of a pruned network has to reach, within this much
+static const double sparsities[] = {0.25, 0.5, 0.9};
+#define SPARSITY_TOLERANCE 0.01
+
+// Connections of every neuron in <layer> added up
+static uint64_t countLayerWeights( ffn_network_t *network, uint64_t layer )
+{
+  uint64_t neur, count = 0;
+  for( neur = 0; neur < ffnNetworkGetLayerNumNeurons( network, layer ); neur++ ) {
+    count += ffnNetworkGetLayerNeuronNumConnections( network, layer, neur );
+  }
+  return count;
+}
+
+// True if <network> gives exactly the outputs of <reference> on <samples>
+static bool sameOutputs( ffn_network_t *reference, ffn_network_t *network, float *samples )
+{
+  ffn_deviation_t deviation;
+  return ffnNetworkCompareOutputs( reference, network, TEST_SAMPLES, samples, &deviation ) &&
+    deviation.maxAbsError == 0.0;
+}
+
+// True if <network> comes back from being serialised with the same outputs
+static bool survivesRoundTrip( ffn_network_t *network, float *samples )
+{
+  uint8_t *data;
+  uint64_t len = ffnNetworkSerialise( network, &data );
+  if( len == 0 ) {
+    return false;
+  }
+
+  ffn_network_t *loaded = ffnNetworkUnserialise( len, data );
+  free( data );
+  if( loaded == NULL ) {
+    return false;
+  }
+
+  bool success = ffnNetworkIsPruned( loaded ) == ffnNetworkIsPruned( network ) &&
+    sameOutputs( network, loaded, samples );
+  ffnNetworkDestroy( loaded );
+  return success;
+}
+
+int main( void )
+{
+  // Fully connected, randomly connected neurons can have the same input more
+  //  than once and pruning merges those, which rounds differently
+  ffn_layer_params_t layers[TEST_LAYERS] = {
+    {64, TEST_INPUTS, activation_sigmoid},
+    {32, 64,          activation_tanh},
+    { 4, 32,          activation_sigmoid},
+  };
+  bool failed = false;
+  uint64_t i, lay;
+
+  srand( 1 );
+  ffn_network_t *net = ffnNetworkCreate( TEST_INPUTS, TEST_LAYERS, layers, true );
+  float *samples = malloc( sizeof(float) * TEST_INPUTS * TEST_SAMPLES );
+  if( net == NULL || samples == NULL ) {
+    fprintf( stderr, "Unable to create network\n" );
+    return -1;
+  }
+  for( i = 0; i < TEST_INPUTS * TEST_SAMPLES; i++ ) {
+    samples[i] = rand() / (float)RAND_MAX * 2.0 - 1.0;
+  }
+
+  // Nothing but zero weights goes at threshold 0, which don't change a thing
+  ffn_network_t *pruned = ffnNetworkPrune( net, 0.0 );
+  if( pruned == NULL || ffnNetworkIsPruned( net ) || !ffnNetworkIsPruned( pruned ) ) {
+    printf( "threshold 0   not pruned FAIL\n" );
+    return -1;
+  }
+  bool ok = sameOutputs( net, pruned, samples );
+  printf( "threshold 0   same outputs as the dense network %s\n", ok ? "OK" : "FAIL" );
+  failed |= !ok;
+
+  // Pruned networks have their own connections per neuron, there's nothing
+  //  to combine them on
+  ok = ffnNetworkCombineOnNeurons( pruned, pruned ) == NULL &&
+    ffnNetworkCombineOnNeurons( net, pruned ) == NULL;
+  printf( "threshold 0   not combined on neurons %s\n", ok ? "OK" : "FAIL" );
+  failed |= !ok;
+  ffnNetworkDestroy( pruned );
+
+  for( i = 0; i < sizeof(sparsities) / sizeof(sparsities[0]); i++ ) {
+    pruned = ffnNetworkPruneToSparsity( net, sparsities[i] );
+    if( pruned == NULL ) {
+      printf( "sparsity %.2f not pruned FAIL\n", sparsities[i] );
+      failed = true;
+      continue;
+    }
+
+    for( lay = 0; lay < TEST_LAYERS; lay++ ) {
+      uint64_t before = countLayerWeights( net, lay );
+      double sparsity = 1.0 - countLayerWeights( pruned, lay ) / (double)before;
+      ok = sparsity >= sparsities[i] - SPARSITY_TOLERANCE &&
+	sparsity <= sparsities[i] + SPARSITY_TOLERANCE;
+      printf( "sparsity %.2f layer %llu has %.3f %s\n",
+	      sparsities[i], (unsigned long long)lay, sparsity, ok ? "OK" : "FAIL" );
+      failed |= !ok;
+    }
+
+    ok = survivesRoundTrip( pruned, samples );
+    printf( "sparsity %.2f same outputs after a round trip %s\n", sparsities[i], ok ? "OK" : "FAIL" );
+    failed |= !ok;
+    ffnNetworkDestroy( pruned );
+  }
+
+  free( samples );
+  ffnNetworkDestroy( net );
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef TOPOLOGIES_H
+#define TOPOLOGIES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "layer.h"
+
+// The networks trained by threadTrainer and game.  They're described here
+//  rather than in the trainers so the benchmarks measure the same networks.
+
+// threadTrainer adds two numbers of ADDTRAINER_BITS bits, one input per bit
+#define ADDTRAINER_BITS   8
+#define ADDTRAINER_INPUTS (2 * ADDTRAINER_BITS)
+#define ADDTRAINER_LAYERS 3
+
+static inline void addTrainerLayers( ffn_layer_params_t layers[ADDTRAINER_LAYERS] )
+{
+  layers[0] = (ffn_layer_params_t) {64, ADDTRAINER_INPUTS, activation_sigmoid};
+  layers[1] = (ffn_layer_params_t) {32, 64,                activation_sigmoid};
+  layers[2] = (ffn_layer_params_t) { 8, 32,                activation_sigmoid};
+}
+
+// game gives Arkanoid networks the last ARKANOID_NET_FRAMES frames of a
+//  sensor followed by ARKANOID_NET_RANDOM random values
+#define ARKANOID_NET_FRAMES 2
+#define ARKANOID_NET_RANDOM 5
+#define ARKANOID_NET_LAYERS 4
+// Inputs of a network reading a sensor of <size> values
+#define ARKANOID_NET_INPUTS( size ) (ARKANOID_NET_FRAMES * (uint64_t)(size) + ARKANOID_NET_RANDOM)
+// Inputs of a network reading the full 640x480 screen
+#define ARKANOID_SCREEN_INPUTS ARKANOID_NET_INPUTS( 640 * 480 )
+
+// The screen is mostly empty so a few connections per neuron are enough,
+//  every value of the state matters
+static inline void arkanoidLayers( ffn_layer_params_t layers[ARKANOID_NET_LAYERS], uint64_t numInputs, bool screen )
+{
+  layers[0] = (ffn_layer_params_t) {400, screen ? numInputs * 0.05 : numInputs, activation_any};
+  layers[1] = (ffn_layer_params_t) {200,  50, activation_any};
+  layers[2] = (ffn_layer_params_t) { 25, 100, activation_any};
+  layers[3] = (ffn_layer_params_t) {  1,  25, activation_tanh};
+}
+
+#endif
@@ -5,8 +5,87 @@
 
 #include <stdint.h>
 
+// Options for createArkanoidWithOptions(), zero everything for the defaults
+typedef struct arkanoid_options_s {
+	// GAME_FLAG_*
+	uint32_t flags;
+	// Paint the whole screen every time instead of only what changed,
+	//  mostly useful for testing
+	bool full_redraw;
+	// Make the screen sensor this many times smaller in each direction, every
+	//  sensor pixel is the average of the pixels it covers.  Has to divide
+	//  640 and 480, 0 and 1 give the full resolution.
+	uint32_t sensor_scale;
+	// Element type of the screen sensor.  A uint8 screen is a quarter of the
+	//  size, its pixels are multiples of sensor->scale so full resolution
+	//  screens hold exactly the same values as float ones.
+	sensor_type_t sensor_type;
+	// Play with integer physics instead of floats.  Fixed point games come
+	//  out exactly the same whatever the compiler, flags or CPU, but they
+	//  don't play the same as float games with the same seed.
+	bool fixed_point;
+} arkanoid_options_t;
+
+#define ARKANOID_SCREEN_WIDTH 640
+#define ARKANOID_SCREEN_HEIGHT 480
+
+// Sensors of every Arkanoid game, in order
+#define ARKANOID_SENSOR_SCREEN 0
+#define ARKANOID_SENSOR_STATE 1
+#define ARKANOID_NUM_SENSORS 2
+
+#define ARKANOID_NUM_BLOCKS 50
+
+// Layout of the SENSOR_STATE sensor, a single row of floats.  Positions and
+//  sizes are fractions of the screen width or height, the ball direction is
+//  in multiples of its speed and the health of every block goes from 1 down
+//  to 0 once it's gone.  The blocks are listed row by row from the top left.
+//  It's cheap to fill in and still works with GAME_FLAG_NO_RENDER.
+typedef enum arkanoid_state_e {
+	arkanoid_state_ball_x,
+	arkanoid_state_ball_y,
+	arkanoid_state_ball_dx,
+	arkanoid_state_ball_dy,
+	arkanoid_state_paddle_x,
+	arkanoid_state_paddle_width,
+	arkanoid_state_blocks,
+
+	ARKANOID_STATE_SIZE = arkanoid_state_blocks + ARKANOID_NUM_BLOCKS
+} arkanoid_state_t;
+
+// Arkanoid through the generic interface, create() takes an
+//  arkanoid_options_t, step() is fastForwardArkanoid() and games are
+//  destroyed with destroyArkanoid()
+extern const game_interface_t arkanoidInterface;
+
 // Set max_rounds to -1 in order to continue playing until death
 game_t *createArkanoid( int32_t max_rounds, unsigned int seed );
+// Same as createArkanoid(), <options> can be NULL for the defaults
+game_t *createArkanoidWithOptions( int32_t max_rounds, unsigned int seed, const arkanoid_options_t *options );
 void destroyArkanoid( game_t *game );
+// Start <game> over as if it was just created with <seed>, keeping its
+//  options and memory.  Much cheaper than destroying it and creating a new
+//  one, only what changed on the screen is painted again.
+void resetArkanoid( game_t *game, unsigned int seed );
+
+// The two halves of an update, advancing the game without painting the
+//  screen sensor and painting it from the current state.  Mostly useful for
+//  measurements, game->_update() only simulates and gameGetSensor() paints
+//  when the screen has changed since it was last painted.
+void simulateArkanoid( game_t *game, input_t input );
+void redrawArkanoid( game_t *game );
+
+// Checked by fastForwardArkanoid(), returns true to stop there.  <data> is
+//  whatever was given to fastForwardArkanoid().
+typedef bool (*arkanoid_stop_t)( game_t *game, void *data );
+
+// Play up to <max_steps> steps with <input> and return how many were played,
+//  the same as gameUpdateRepeat() down to the last bit.  Stretches where the
+//  ball flies freely, with nothing but the ball and paddle moving, are worked
+//  out at once instead of step by step.  Stops early when the game is over
+//  or when <stop>, if it isn't NULL, returns true.  It's called after every
+//  step where the ball could have hit something, so it sees a new score,
+//  broken block or bounce on the step it happens.
+uint32_t fastForwardArkanoid( game_t *game, input_t input, uint32_t max_steps, arkanoid_stop_t stop, void *data );
 
 #endif // MY_GAME_H
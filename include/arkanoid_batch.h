@@ -0,0 +1,47 @@
+#ifndef ARKANOID_BATCH_H
+#define ARKANOID_BATCH_H
+
+#include "game.h"
+#include "arkanoid.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Many Arkanoid games stepped together.  The games are kept as arrays of
+//  every value instead of a structure per game, so a step runs through each
+//  part of the physics for all games in turn.  Every game plays exactly the
+//  same as one made by createArkanoid() with the same seed and inputs.
+//
+// Nothing is painted while stepping, the screens are drawn on demand into
+//  buffers owned by the caller.  They look the same as a full resolution
+//  float SENSOR_SCREEN.
+typedef struct arkanoid_batch_s {
+	const uint32_t num_games;
+	// Games that aren't over yet
+	const uint32_t num_running;
+	// One per game, the same as the score and game_over of a game_t
+	const int32_t *scores;
+	const bool *game_over;
+} arkanoid_batch_t;
+
+// Create <num_games> games, game i is seeded with <seeds>[i].  Set
+//  <max_rounds> to -1 in order to continue playing until death.
+arkanoid_batch_t *createArkanoidBatch( uint32_t num_games, int32_t max_rounds, const unsigned int *seeds );
+void destroyArkanoidBatch( arkanoid_batch_t *batch );
+
+// Advance every game that isn't over by one step, game i gets <inputs>[i].
+//  Games that are over are left alone.
+void simulateArkanoidBatch( arkanoid_batch_t *batch, const input_t *inputs );
+
+// Draw the screen of game <game> into <pixels>, which has room for
+//  ARKANOID_SCREEN_HEIGHT rows of ARKANOID_SCREEN_WIDTH floats with
+//  <row_stride> floats from the start of one row to the next.
+void drawArkanoidBatch( arkanoid_batch_t *batch, uint32_t game, float *pixels, size_t row_stride );
+// Draw every game, game i starts <game_stride> floats after game i - 1.
+void drawArkanoidBatchAll( arkanoid_batch_t *batch, float *pixels, size_t game_stride, size_t row_stride );
+
+// Write what the SENSOR_STATE sensor of game <game> would hold, see
+//  arkanoid_state_t, to <state> which has room for ARKANOID_STATE_SIZE floats.
+void getArkanoidBatchState( arkanoid_batch_t *batch, uint32_t game, float *state );
+
+#endif // ARKANOID_BATCH_H
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 // up, down, left and right are self-explanatory, actions contains four
 //  different inputs that are game specific, e.g. jump or fire.
@@ -11,32 +12,203 @@ typedef struct input_s {
 	float actions[4];
 } input_t;
 
+// Flags that can be given to a game when it's created
+// Never produce any screen data, for players that only look at the score or
+//  the game state.  The data of the screen sensor is NULL.
+#define GAME_FLAG_NO_RENDER 0x1
+
+// Element types of sensor data
+typedef enum sensor_type_e {
+	// One float per element in data
+	sensor_type_float,
+	// One byte per element in data_u8, the value is data_u8[i] * scale
+	sensor_type_uint8
+} sensor_type_t;
+
 #define SENSOR_SCREEN "screen"
+#define SENSOR_STATE "state"
 // A structure generated by the game implementation, it is used to hold
 //  sensory data such as screen data, audio et c.  The name indicates what
-//  it is supposed to be, and can be defined by the game itself.  Currenly
-//  only "screen" is predefined and supports a depth of either 1 or 3
-//  depending on if the game uses gray scale or RGB colour.
+//  it is supposed to be, and can be defined by the game itself.  Two names
+//  are predefined, "screen" supports a depth of either 1 or 3 depending on
+//  if the game uses gray scale or RGB colour, and "state" is a game specific
+//  vector of floats describing the game directly, e.g. object positions.
+//  The data may be produced lazily, use gameGetSensor() to get it up to date.
 typedef struct sensor_s {
 	const char *name;
 	const uint32_t height;
 	const uint32_t width;
 	const uint32_t depth;
+	// Only the data pointer matching the type is set
+	const sensor_type_t type;
+	const float scale;
 	const float *data;
+	const uint8_t *data_u8;
 } sensor_t;
 
 // A structure generated by the game implementation, the player can't change
 //  any of the values, they're only for information purposes.
 struct game_s;
+struct game_interface_s;
 typedef struct game_s {
 	const uint32_t num_sensors;
 	const sensor_t *sensors;
 	const int32_t score;
 	const bool game_over;
+	// GAME_FLAG_* given when the game was created
+	const uint32_t flags;
+	// Bytes needed to hold a snapshot, see gameSnapshot()
+	const uint32_t snapshot_size;
 
 	// Sends a new input to the game and requests a new state to be written
 	//  into <game>.
 	void(*_update)(struct game_s* game, input_t input);
+	// Brings the data of sensor <index> up to date and returns it.
+	const sensor_t *(*_get_sensor)(struct game_s* game, uint32_t index);
+	// See gameSnapshot() and gameRestore(), NULL without GAME_CAP_SNAPSHOT
+	void(*_snapshot)(struct game_s* game, void *snapshot);
+	void(*_restore)(struct game_s* game, const void *snapshot);
+	// The kind of game this is, everything else it can do
+	const struct game_interface_s *game_interface;
 } game_t;
 
+// Capabilities of a game, which of the optional parts of game_interface_t
+//  it has.  The helpers below fall back to something slower where they can.
+// reset() starts a game over without creating a new one
+#define GAME_CAP_RESET 0x1
+// Games can be snapshot, restored and cloned
+#define GAME_CAP_SNAPSHOT 0x2
+// step() plays repeated inputs faster than one _update() at a time
+#define GAME_CAP_STEP 0x4
+// step_batch() steps many games faster than one at a time
+#define GAME_CAP_BATCH 0x8
+
+// Everything needed to create, play and get rid of a kind of game without
+//  knowing which one it is, so trainers can pool, batch and snapshot any
+//  game.  Every game implementation has one, see arkanoidInterface.
+typedef struct game_interface_s {
+	const char *name;
+	// GAME_CAP_*
+	uint32_t capabilities;
+
+	// Creates a game from <seed> that ends after <max_rounds> steps, or
+	//  never with -1.  <options> are specific to the game, NULL gives the
+	//  defaults.  Returns NULL if it can't be created.
+	struct game_s *(*create)(int32_t max_rounds, unsigned int seed, const void *options);
+	void(*destroy)(struct game_s* game);
+	// The rest is optional and NULL when the capability is missing
+	void(*reset)(struct game_s* game, unsigned int seed);
+	struct game_s *(*clone)(struct game_s* game);
+	uint32_t(*step)(struct game_s* game, input_t input, uint32_t repeat);
+	void(*step_batch)(struct game_s** games, const input_t *inputs, uint32_t num_games);
+} game_interface_t;
+
+// Create a game of the kind <game_interface> describes, see create()
+static inline game_t *gameCreate(const game_interface_t *game_interface, int32_t max_rounds, unsigned int seed, const void *options)
+{
+	return game_interface->create(max_rounds, seed, options);
+}
+
+static inline void gameDestroy(game_t *game)
+{
+	if (game) {
+		game->game_interface->destroy(game);
+	}
+}
+
+// Start <game> over as if it was just created with <seed>, keeping its
+//  options.  Only for games with GAME_CAP_RESET, others have to be destroyed
+//  and created again.
+static inline void gameReset(game_t *game, unsigned int seed)
+{
+	game->game_interface->reset(game, seed);
+}
+
+// Returns sensor <index> of <game> with data matching the latest update.
+//  Games only produce sensor data when it's asked for, so this is the only
+//  way to read it.
+static inline const sensor_t *gameGetSensor(game_t *game, uint32_t index)
+{
+	return game->_get_sensor(game, index);
+}
+
+// Sends <input> to <game> for <repeat> steps in a row, or until the game is
+//  over, and returns the number of steps it played.  The score adds up the
+//  points of every step.  Sensors are only produced when they're asked for,
+//  so nothing is painted for the steps in between.
+static inline uint32_t gameUpdateRepeat(game_t *game, input_t input, uint32_t repeat)
+{
+	uint32_t steps;
+	for (steps = 0; steps < repeat && !game->game_over; steps++) {
+		game->_update(game, input);
+	}
+	return steps;
+}
+
+// Same as gameUpdateRepeat(), through step() when the game has one
+static inline uint32_t gameStep(game_t *game, input_t input, uint32_t repeat)
+{
+	if (game->game_interface->step) {
+		return game->game_interface->step(game, input, repeat);
+	}
+	return gameUpdateRepeat(game, input, repeat);
+}
+
+// Sends <inputs>[i] to <games>[i] for one step, games that are over are
+//  left alone.  The games all have to be of the <game_interface> kind.
+static inline void gameStepBatch(const game_interface_t *game_interface, game_t **games, const input_t *inputs, uint32_t num_games)
+{
+	uint32_t i;
+	if (game_interface->step_batch) {
+		game_interface->step_batch(games, inputs, num_games);
+		return;
+	}
+	for (i = 0; i < num_games; i++) {
+		if (!games[i]->game_over) {
+			games[i]->_update(games[i], inputs[i]);
+		}
+	}
+}
+
+// Writes the state of <game> to <snapshot>, which has room for
+//  game->snapshot_size bytes.  A snapshot is a flat block of memory that can
+//  be copied around freely, it holds no pointers.  Snapshots of games in the
+//  same state are identical, so they can be compared with memcmp().
+static inline void gameSnapshot(game_t *game, void *snapshot)
+{
+	game->_snapshot(game, snapshot);
+}
+
+// Puts <game> back in the state <snapshot> was taken in, it has to come from
+//  a game of the same kind.  Options given when the game was created, such as
+//  the screen format and max rounds, stay as they are.  The sensors are
+//  produced again when they're next asked for.
+static inline void gameRestore(game_t *game, const void *snapshot)
+{
+	game->_restore(game, snapshot);
+}
+
+// Returns a new game with the same options in the same state as <game>, or
+//  NULL if it can't be created or the game has no GAME_CAP_SNAPSHOT.
+//  Destroy it with gameDestroy().
+static inline game_t *gameClone(game_t *game)
+{
+	if (game->game_interface->clone == NULL) {
+		return NULL;
+	}
+	return game->game_interface->clone(game);
+}
+
+// Returns the index of the sensor called <name>, or -1 if <game> has none.
+static inline int32_t gameFindSensor(const game_t *game, const char *name)
+{
+	uint32_t i;
+	for (i = 0; i < game->num_sensors; i++) {
+		if (strcmp(game->sensors[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
 #endif // GAME_H
@@ -1,6 +1,7 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <string.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <float.h>
@@ -13,7 +14,12 @@
 #include <pthread.h>
 
 #include "network.h"
+#include "topologies.h"
 #include "population.h"
+#include "checkpoint.h"
+#include "phasetimer.h"
+#include "perfcounters.h"
+#include "trace.h"
 #include "jobhandler.h"
 #include "progress.h"
 
@@ -31,8 +37,13 @@ typedef struct neuron_job_s {
   // Seed to initialise random number generation with
   unsigned int  seed;
 
+  // Index of the network in the population
+  unsigned int  individual;
+
   // Place to save the score of the network
   unsigned int *score;
+  // Place to save the number of additions the network has made
+  uint64_t     *frames;
 
   // Signal indicating if the task should stop running a network and pick a new job
   bool         *stop;
@@ -41,13 +52,55 @@ typedef struct neuron_job_s {
   bool         *done;
 } neuron_job_t;
 
+// Everything a training run needs except for the number of threads
+typedef struct train_params_s {
+  // Place to store network definitions
+  char          *outputFolder;
+  unsigned long  runningSeed;
+  int            numCheckpointThreads;
+  unsigned int   numNets;
+  unsigned int   numRounds;
+  unsigned int   firstGeneration;
+  unsigned int   numGenerations;
+  // How many bits to calculate scores for in the first generation
+  int            numBits;
+  // Network definition files used to initialise the first generation
+  int            numFiles;
+  char         **files;
+} train_params_t;
+
+// What a training run spent its time on, used by the benchmark mode.  A
+//  frame is one addition.
+typedef struct train_stats_s {
+  uint64_t networks;
+  uint64_t frames;
+  double   wallTime;
+  double   evalTime;
+  double   respawnTime;
+  double   checkpointTime;
+  // Hash of every score in every generation
+  uint64_t checksum;
+} train_stats_t;
+
 static bool saveAllNetsAndQuit = false;
 static bool started = false;
-static const int maxBits = 8;
+// Tells the training threads to quit once the job queue is empty
+static bool stopThreads = false;
+// Progress is only printed outside of the benchmark mode
+static bool verbose = true;
+static const int maxBits = ADDTRAINER_BITS;
 
 static pthread_mutex_t net_mutex;
 
 #define START_BITS 256
+#define FAST_ACTIVATIONS 257
+#define BENCHMARK 258
+#define PERF_COUNTERS 259
+#define TRACE 260
+
+// Defaults used by --benchmark unless given explicitly
+#define BENCHMARK_SEED 0x5eed
+#define BENCHMARK_NETS 10
 
 static const struct option *getOptlist()
 {
@@ -59,8 +112,13 @@ static const struct option *getOptlist()
     {"networks",      required_argument, NULL, 'n'},
     {"rounds",        required_argument, NULL, 'r'},
     {"output-folder", required_argument, NULL, 'o'},
+    {"checkpoint-threads", required_argument, NULL, 'c'},
+    {"fast-activations", no_argument,     NULL, FAST_ACTIVATIONS},
     {"bits",          required_argument, NULL, 'b'},
     {"start-bits",    required_argument, NULL, START_BITS},
+    {"benchmark",     required_argument, NULL, BENCHMARK},
+    {"perf-counters", no_argument,       NULL, PERF_COUNTERS},
+    {"trace",         required_argument, NULL, TRACE},
 
     {"help",          no_argument,       NULL, 'h'},
     {0, 0, 0, 0}
@@ -87,17 +145,31 @@ static void usage( char *progname )
   printf( "File arguments will be loaded as neural networks and used to initialise\n"
 	  "the first generation of the population.\n\n" );
   printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
-  printf( "  -t, --threads=INT          number of parallel threads to run\n" );
+  printf( "  -t, --threads=INT          number of parallel threads to run, 1 unless given\n"
+	  "                             except for --benchmark\n" );
   printf( "  -s, --seed=HEX             seed value for random generator. \n"
 	  "                             Useful to replicate previous results\n" );
   printf( "  -g, --generations=INT      number of generations to train for\n" );
   printf( "  -f, --first-gen=INT        generation to begin at, useful for resuming\n" );
   printf( "  -n, --networks=INT         networks per population\n" );
   printf( "  -r, --rounds=INT           number of additions to perform per generation\n" );
+  printf( "  -o, --output-folder=DIR    folder to save networks in\n" );
+  printf( "  -c, --checkpoint-threads=INT\n"
+	  "                             number of background threads writing networks to disk\n" );
+  printf( "      --fast-activations     use lookup tables instead of libm for activation\n"
+	  "                             functions, see activation.h for the errors\n" );
 
   printf( "  -b, --bits=INT             number of bits in the addition\n" );
   printf( "      --start-bits=INT       number of bits to compare in the beginning, defaults\n" );
   printf( "                             to all bits in numbers to add\n" );
+  printf( "      --benchmark=INT        train for INT generations with 1, 2, 4 ... up to\n"
+	  "                             --threads threads (defaults to the number of cores)\n"
+	  "                             and report the throughput as JSON.  Uses seed %x\n"
+	  "                             and %d networks unless given\n", BENCHMARK_SEED, BENCHMARK_NETS );
+  printf( "      --perf-counters        add cycles, instructions, cache and dTLB misses to\n"
+	  "                             the phase timings, needs a PHASE_TIMERS=1 build\n" );
+  printf( "      --trace=FILE           write what every thread is doing to FILE as Chrome\n"
+	  "                             trace-event JSON\n" );
 
   printf( "  -h, --help                 display this message and exit\n" );
 }
@@ -117,7 +189,7 @@ static bool isNetworkCorrect( ffn_network_t *net, ffn_layer_params_t *lp )
 }
 
 // individual == -1 means save all, otherwise save only specified individual
-static void savePopulation( char *folder, population_t *population, int individual, unsigned int generation, unsigned int seed, unsigned int rounds )
+static void savePopulation( checkpoint_writer_t *writer, char *folder, population_t *population, int individual, unsigned int generation, unsigned int seed, unsigned int rounds )
 {
 #define SAVE_NET_FORMAT "%s/0x%08x_0x%08x_%d_%f.ffw"
   char filename[FILENAME_LEN];
@@ -127,13 +199,17 @@ static void savePopulation( char *folder, population_t *population, int individu
       sprintf( filename, SAVE_NET_FORMAT,
 	       folder,
 	       generation, seed, i, populationGetScore( population, i ) / (double)(rounds) );
-      ffnNetworkSaveFile( populationGetIndividual( population, i ), filename );
+      if( !checkpointWriterSave( writer, populationGetIndividual( population, i ), filename ) ) {
+	fprintf( stderr, "Unable to queue network for saving to %s\n", filename );
+      }
     }
   } else {
     sprintf( filename, SAVE_NET_FORMAT,
 	     folder,
 	     generation, seed, individual, populationGetScore( population, individual ) / (double)(rounds) );
-    ffnNetworkSaveFile( populationGetIndividual( population, individual ), filename );
+    if( !checkpointWriterSave( writer, populationGetIndividual( population, individual ), filename ) ) {
+      fprintf( stderr, "Unable to queue network for saving to %s\n", filename );
+    }
   }
 }
 
@@ -160,16 +236,56 @@ static float calcScore( uint32_t first, uint32_t second, ffn_network_t *network,
   return score;
 }
 
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// FNV-1a, used to compare scores between benchmark runs
+static uint64_t hashScore( uint64_t hash, uint32_t score )
+{
+  int i;
+  for( i = 0; i < 4; i++ ) {
+    hash ^= (score >> (8 * i)) & 0xff;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Same as ffnNetworkRun() but with every layer timed when enabled
+static void runNetwork( ffn_network_t *network, float *inputs )
+{
+#ifdef ENABLE_PHASE_TIMERS
+  uint64_t lay;
+  for( lay = 0; lay < ffnNetworkGetNumLayers( network ); lay++ ) {
+    PHASE_BEGIN( start );
+    ffnNetworkRunLayer( network, lay, inputs );
+    PHASE_END( start, PHASE_LAYER( lay ) );
+  }
+#else
+  ffnNetworkRun( network, inputs );
+#endif
+}
+
 static double playNetwork( ffn_network_t *network,
 			   unsigned int generation, unsigned int seed,
 			   unsigned int numRounds, int numBits,
-			   bool *stopFlag )
+			   bool *stopFlag, uint64_t *framesPlayed )
 {
   float ffwData[64];
   double netScore = 0;
   uint32_t first, second;
   uint32_t max = (1 << maxBits);
+
+  *framesPlayed = 0;
   for( first = 0; first < max; first++ ) {
+    // A round is every addition with the same first number, a span per
+    //  addition would drown everything else
+    uint64_t roundStart = traceNow();
+    uint64_t networkTime = 0;
+
     for( second = 0; second < max; second++ ) {
       // Stop and clear score to avoid partial results
       if( *stopFlag ) {
@@ -178,6 +294,7 @@ static double playNetwork( ffn_network_t *network,
 	break;
       }
 
+      PHASE_BEGIN( copyStart );
       int i;
       for( i = 0; i < maxBits; i++ ) {
 	ffwData[i] = (first & (1 << i)) ? 1.0 : 0.0;
@@ -185,13 +302,20 @@ static double playNetwork( ffn_network_t *network,
       for( i = 0; i < maxBits; i++ ) {
 	ffwData[i+maxBits] = (second & (1 << i)) ? 1.0 : 0.0;
       }
+      PHASE_END( copyStart, phase_copy_frame );
 
       // Create output
-      ffnNetworkRun( network, ffwData );
+      uint64_t networkStart = traceNow();
+      runNetwork( network, ffwData );
+      networkTime += traceNow() - networkStart;
 
       // Score network
+      PHASE_BEGIN( scoreStart );
       netScore += calcScore( first, second, network, numBits );
+      PHASE_END( scoreStart, phase_score );
+      (*framesPlayed)++;
     }
+    traceSpan( "round", roundStart, traceNow(), "network_us", networkTime / 1000 );
   }
 
   return netScore;
@@ -202,103 +326,84 @@ static void *train_thread( void *arg )
 {
   jobHandler *jh = arg;
 
-  printf( "Thread started!\n" );
+  if( verbose ) {
+    printf( "Thread started!\n" );
+  }
+
+  // Polls that didn't get a job are merged into a single idle span
+  uint64_t idleStart = 0;
+  uint64_t numPolls = 0;
 
   while( 1 ) {
+    uint64_t pollStart = traceNow();
     neuron_job_t *job = jobHandlerGetJob( jh );
     if( job != NULL ) {
-      double score = playNetwork( job->network, job->generation, job->seed, job->numRounds, job->numBits, job->stop );
+      uint64_t jobStart = traceNow();
+      if( numPolls > 0 ) {
+	traceSpan( "idle", idleStart, pollStart, "polls", numPolls );
+	numPolls = 0;
+      }
+      traceSpan( "dequeue", pollStart, jobStart, NULL, 0 );
+
+      uint64_t frames;
+      double score = playNetwork( job->network, job->generation, job->seed, job->numRounds, job->numBits, job->stop, &frames );
       pthread_mutex_lock( &net_mutex );
       *(job->score) = score;
+      *(job->frames) = frames;
       *(job->done) = true;
       pthread_mutex_unlock( &net_mutex );
-    } else if( saveAllNetsAndQuit == true ) {
+      traceSpan( "job", jobStart, traceNow(), "network", job->individual );
+      free( job );
+    } else if( saveAllNetsAndQuit == true || stopThreads == true ) {
       // If no job left and quit flag is set, quit
       break;
+    } else if( numPolls++ == 0 ) {
+      idleStart = pollStart;
     }
   }
+  if( numPolls > 0 ) {
+    traceSpan( "idle", idleStart, traceNow(), "polls", numPolls );
+  }
 
-  printf( "Thread stopping!\n" );
+  if( verbose ) {
+    printf( "Thread stopping!\n" );
+  }
   return NULL;
 }
 
-int main( int argc, char *argv[] )
+// Train a population for the generations given in <params> on <numThreads>
+//  threads.  Fills in <stats> if it isn't NULL.  Returns 0 on success.
+static int train( const train_params_t *params, int numThreads, train_stats_t *stats )
 {
-  // Place to store network definitions
-  char *outputFolder = ".";
-  // Get some better randomness going
-  srand((unsigned)(time(NULL)));
-  unsigned long runningSeed = rand();
-  // Number of concurrent threads to run
-  int numThreads = 1;
-  // Number of networks in a population
-  unsigned int numNets = 75;
-  // Number of games played by each network in a generation
-  unsigned int numRounds = 20;
-  // Number of generations to play before stopping
-  unsigned int numGenerations = 2000;
-  // Which generation to begin with, useful when resuming training
-  unsigned int firstGeneration = 0;
+  char *outputFolder = params->outputFolder;
+  unsigned long runningSeed = params->runningSeed;
+  unsigned int numNets = params->numNets;
+  unsigned int numRounds = params->numRounds;
   // How many bits to calculate scores for, should allow networks to learn one bit at a time
-  int numBits = 1;
+  int numBits = params->numBits;
   float bitIncreaseLimit = 0.15;
+  int ret = 0;
 
-  // Register a signal handler that'll save networks when we quit
-  signal( SIGINT, sigintHandler );
-
-  int c;
-  while( (c = getopt_long (argc, argv, "s:t:g:f:n:r:b:o:h",
-			   getOptlist(), NULL)) != -1 ) {
-    switch(c) {
-    case 's': // Optional
-      runningSeed = strtoul(optarg, NULL, 16);
-      break;
-    case 't': // Optional
-      numThreads = atoi(optarg);
-      break;
-    case 'g': // Optional
-      numGenerations = strtoul(optarg, NULL, 10);
-      break;
-    case 'f': // Optional
-      firstGeneration = strtoul(optarg, NULL, 10);
-      break;
-    case 'n': // Optional
-      numNets = strtoul(optarg, NULL, 10);
-      break;
-    case 'r': // Optional
-      numRounds = strtoul(optarg, NULL, 10);
-      break;
-    case 'o': // Optional
-      outputFolder = optarg;
-      break;
-    case 'b': // Optional
-      fprintf( stderr, "This is actually not setting the number of bits to compare, sorry...\n" );
-      numBits = strtoul(optarg, NULL, 10);
-      break;
-    case START_BITS: // Optional
-      //startBit = strtoul(optarg, NULL, 10);
-      break;
-    case 'h': // Special
-      usage( argv[0] );
-      return 0;
-    }
+  double startTime = now();
+  if( stats != NULL ) {
+    bzero( stats, sizeof(*stats) );
+    stats->checksum = 0xcbf29ce484222325ULL;
   }
 
   int i = 0;
 
   // Number of total inputs in the network
-  const uint64_t numInputs = maxBits * 2;
+  const uint64_t numInputs = ADDTRAINER_INPUTS;
   // Number of layers, including output layer, used by the networks
-  const uint64_t numLayers = 3;
+  const uint64_t numLayers = ADDTRAINER_LAYERS;
   // Description of the layers
-  ffn_layer_params_t layerParams[] = {
-    (ffn_layer_params_t) {64, numInputs, activation_sigmoid},
-    (ffn_layer_params_t) {32, 64,        activation_sigmoid},
-    (ffn_layer_params_t) { 8, 32,        activation_sigmoid}
-  };
+  ffn_layer_params_t layerParams[ADDTRAINER_LAYERS];
+  addTrainerLayers( layerParams );
 
   // Create a population of neural networks
-  printf( "Creating first generation of %u networks\n", numNets );
+  if( verbose ) {
+    printf( "Creating first generation of %u networks\n", numNets );
+  }
   population_t *population = populationCreate( numNets, numInputs, numLayers, layerParams, true );
   if( population == NULL ) {
     fprintf( stderr, "Can't create population\n" );
@@ -311,12 +416,14 @@ int main( int argc, char *argv[] )
   pthread_t *threads = malloc( sizeof(*threads) * numThreads );
   if( !threads ) {
     free( jh );
+    populationDestroy( population );
     return -3;
   }
   for( i = 0; i < numThreads; i++ ) {
     if( pthread_create( &threads[i], NULL, train_thread, jh) != 0 ) {
       free( threads );
       free( jh );
+      populationDestroy( population );
       return -4;
     }
   }
@@ -325,25 +432,29 @@ int main( int argc, char *argv[] )
   if( threadJobs == NULL ) {
     free( threads );
     free( jh );
+    populationDestroy( population );
     return -5;
   }
   for( i = 0; i < numNets; i++ ) {
     threadJobs[i].score      = malloc(sizeof(float));
+    threadJobs[i].frames     = malloc(sizeof(uint64_t));
     threadJobs[i].stop       = malloc(sizeof(bool));
     threadJobs[i].done       = malloc(sizeof(bool));
   }
 
-  // Get the rest of the arguments since they might be networks
+  // Add the networks given on the command line
+  int f;
   i = 0;
-  for( ; optind < argc && i < population->size; optind++ ) {
+  for( f = 0; f < params->numFiles && i < population->size; f++ ) {
     // Regular arguments, network definition files to seed with
-    printf( "Using file %s\n", argv[optind] );
+    printf( "Using file %s\n", params->files[f] );
 
     // Add networks to population
-    ffn_network_t *tmp = ffnNetworkLoadFile( argv[optind] );
+    ffn_network_t *tmp = ffnNetworkLoadFile( params->files[f] );
     if( tmp != NULL ) {
       // Only add networks that can successfully mate with the ones we already have
-      if( (ffnNetworkGetNumInputs( tmp ) == numInputs) &&
+      if( !ffnNetworkIsPruned( tmp ) &&
+	  (ffnNetworkGetNumInputs( tmp ) == numInputs) &&
 	  (ffnNetworkGetNumLayers( tmp ) == numLayers) &&
 	  isNetworkCorrect( tmp, layerParams ) ) {
 	printf( "Adding network\n" );
@@ -355,7 +466,15 @@ int main( int argc, char *argv[] )
     }
   }
 
-  pthread_mutex_init( &net_mutex, NULL );
+  // Networks are written in the background while the next generation is
+  //  evaluated.  The queue is kept short so saving blocks once the writers fall
+  //  behind instead of holding a snapshot of every network in memory.
+  checkpoint_writer_t *checkpointWriter = checkpointWriterCreate( params->numCheckpointThreads, 2 * params->numCheckpointThreads );
+  if( checkpointWriter == NULL ) {
+    fprintf( stderr, "Can't create checkpoint writer\n" );
+    ret = -6;
+    goto cleanup;
+  }
 
   double  bestScore;
   int     bestNet;
@@ -365,11 +484,15 @@ int main( int argc, char *argv[] )
   started = true;
   unsigned long generation;
 
-  for( generation = firstGeneration; generation < numGenerations; generation++ ) {
+  for( generation = params->firstGeneration; generation < params->numGenerations; generation++ ) {
     bestScore = minimise ? DBL_MAX : -DBL_MAX;
     bestNet = -1;
 
-    printf( "Generation %lu\n", generation );
+    if( verbose ) {
+      printf( "Generation %lu\n", generation );
+    }
+    double evalStart = now();
+    uint64_t traceEvalStart = traceNow();
 
     populationClearScores( population );
     int n;
@@ -378,11 +501,13 @@ int main( int argc, char *argv[] )
       pthread_mutex_lock( &net_mutex );
       for( n = 0; n < population->size; n++ ) {
 	threadJobs[n].network    = populationGetIndividual( population, n );
+	threadJobs[n].individual = n;
 	threadJobs[n].numBits    = numBits;
 	threadJobs[n].numRounds  = numRounds;
 	threadJobs[n].generation = generation;
 	threadJobs[n].seed       = runningSeed;
 	*(threadJobs[n].score)   = 0;
+	*(threadJobs[n].frames)  = 0;
 	*(threadJobs[n].stop)    = false;
 	*(threadJobs[n].done)    = false;
 
@@ -416,8 +541,8 @@ int main( int argc, char *argv[] )
 	}
 
 	printf( "Saving all networks and quitting\n" );
-	savePopulation( outputFolder, population, -1, generation, runningSeed, numRounds );
-	return 0;
+	savePopulation( checkpointWriter, outputFolder, population, -1, generation, runningSeed, numRounds );
+	goto cleanup;
       }
 
       // See if there are any nets that aren't ready yet and wait for them to complete
@@ -431,7 +556,9 @@ int main( int argc, char *argv[] )
 
       if( readyCount > numReady ) {
 	for( ; numReady < readyCount; numReady++ ) {
-	  printf( "." ); fflush(stdout);
+	  if( verbose ) {
+	    printf( "." ); fflush(stdout);
+	  }
 	}
       }
 
@@ -442,7 +569,9 @@ int main( int argc, char *argv[] )
       usleep( 10000 );
     }
 
-    printf( "\n" );
+    if( verbose ) {
+      printf( "\n" );
+    }
 
     // All threads are done, tally up results and evolve
     for( n = 0; n < population->size; n++ ) {
@@ -459,23 +588,267 @@ int main( int argc, char *argv[] )
 
       populationSetScore( population, n, netScore );
 
-      printf( " - %f / %u (%f)\n", netScore, numRounds, netScore / (double)(numRounds) );
+      if( stats != NULL ) {
+	stats->frames += *(threadJobs[n].frames);
+	stats->checksum = hashScore( stats->checksum, *(threadJobs[n].score) );
+      }
+
+      if( verbose ) {
+	printf( " - %f / %u (%f)\n", netScore, numRounds, netScore / (double)(numRounds) );
+      }
     } // End of population loop
 
-    printf( "  Best score: %f (%f)\n", bestScore, bestScore / (double)(numRounds) );
+    if( verbose ) {
+      printf( "  Best score: %f (%f)\n", bestScore, bestScore / (double)(numRounds) );
+    }
+    double evalEnd = now();
 
     // Save the best net here
-    savePopulation( outputFolder, population, bestNet, generation, runningSeed, numRounds );
+    uint64_t traceSaveStart = traceNow();
+    traceSpan( "evaluate", traceEvalStart, traceSaveStart, "generation", generation );
+    PHASE_BEGIN( saveStart );
+    savePopulation( checkpointWriter, outputFolder, population, bestNet, generation, runningSeed, numRounds );
+    PHASE_END( saveStart, phase_save );
+    uint64_t traceRespawnStart = traceNow();
+    traceSpan( "save", traceSaveStart, traceRespawnStart, NULL, 0 );
+    double saveEnd = now();
 
     // Increase how many bits to practice on if network is good enough
     if( (bestScore / (double)(numRounds)) / numBits < bitIncreaseLimit && numBits < maxBits ) {
       numBits++;
     }
 
+    PHASE_BEGIN( respawnStart );
     populationRespawn( population, minimise );
+    PHASE_END( respawnStart, phase_respawn );
+    traceSpan( "respawn", traceRespawnStart, traceNow(), NULL, 0 );
+    double respawnEnd = now();
+
+    if( verbose ) {
+      PHASE_SUMMARY( stdout );
+    }
+
+    if( stats != NULL ) {
+      stats->networks += population->size;
+      stats->evalTime += evalEnd - evalStart;
+      stats->checkpointTime += saveEnd - evalEnd;
+      stats->respawnTime += respawnEnd - saveEnd;
+    }
+  }
+
+ cleanup:
+  // Make sure everything has reached the disk before returning
+  if( checkpointWriter != NULL ) {
+    double flushStart = now();
+    checkpointWriterFlush( checkpointWriter );
+    if( stats != NULL ) {
+      stats->checkpointTime += now() - flushStart;
+    }
+    checkpointWriterDestroy( checkpointWriter );
   }
 
+  // The queue is empty by now, so the threads quit right away
+  stopThreads = true;
+  for( i = 0; i < numThreads; i++ ) {
+    pthread_join( threads[i], NULL );
+  }
+  stopThreads = false;
+
+  for( i = 0; i < numNets; i++ ) {
+    free( threadJobs[i].score );
+    free( threadJobs[i].frames );
+    free( threadJobs[i].stop );
+    free( threadJobs[i].done );
+  }
+  free( threadJobs );
+  free( threads );
+  jobHandlerDestroy( jh );
   populationDestroy( population );
-  
+
+  if( stats != NULL ) {
+    stats->wallTime = now() - startTime;
+  }
+
+  return ret;
+}
+
+// Train with 1, 2, 4 ... <maxThreads> threads from the same seed and report
+//  the throughput of each.  Fails if the scores differ between thread counts.
+static int benchmark( train_params_t *params, int maxThreads )
+{
+  uint64_t checksum = 0;
+  bool identical = true;
+
+  verbose = false;
+
+  printf( "{\n  \"benchmark\": \"threadTrainer\",\n  \"generations\": %u,\n  \"networks\": %u,\n"
+	  "  \"rounds\": %u,\n  \"seed\": \"0x%lx\",\n  \"results\": [\n",
+	  params->numGenerations - params->firstGeneration, params->numNets,
+	  params->numRounds, params->runningSeed );
+
+  int numThreads = 1;
+  while( 1 ) {
+    train_stats_t stats;
+
+    // Every run starts from the same population
+    srand( params->runningSeed );
+    int ret = train( params, numThreads, &stats );
+    if( ret != 0 ) {
+      return ret;
+    }
+
+    if( numThreads == 1 ) {
+      checksum = stats.checksum;
+    } else if( stats.checksum != checksum ) {
+      identical = false;
+    }
+
+    printf( "%s    {\"threads\": %d, \"wall_s\": %.3f, \"eval_s\": %.3f, \"respawn_s\": %.3f, "
+	    "\"checkpoint_s\": %.3f, \"networks_per_s\": %.2f, \"frames_per_s\": %.1f, "
+	    "\"checksum\": \"0x%016llx\"}",
+	    numThreads == 1 ? "" : ",\n", numThreads, stats.wallTime, stats.evalTime,
+	    stats.respawnTime, stats.checkpointTime, stats.networks / stats.evalTime,
+	    stats.frames / stats.evalTime, (unsigned long long)stats.checksum );
+    fflush( stdout );
+
+    if( numThreads == maxThreads ) {
+      break;
+    }
+    numThreads *= 2;
+    if( numThreads > maxThreads ) {
+      numThreads = maxThreads;
+    }
+  }
+
+  printf( "\n  ],\n  \"identical\": %s\n}\n", identical ? "true" : "false" );
+  if( !identical ) {
+    fprintf( stderr, "Scores differ between thread counts\n" );
+    return -7;
+  }
+
   return 0;
 }
+
+int main( int argc, char *argv[] )
+{
+  // Get some better randomness going
+  srand((unsigned)(time(NULL)));
+
+  train_params_t params = {
+    .outputFolder         = ".",
+    .runningSeed          = rand(),
+    .numCheckpointThreads = 1,
+    // Number of networks in a population
+    .numNets              = 75,
+    // Number of games played by each network in a generation
+    .numRounds            = 20,
+    // Which generation to begin with, useful when resuming training
+    .firstGeneration      = 0,
+    // Number of generations to play before stopping
+    .numGenerations       = 2000,
+    .numBits              = 1,
+  };
+  // Number of concurrent threads to run, 0 when not given, which is one for
+  //  training and one per core for benchmarks
+  int numThreads = 0;
+  // Number of generations to benchmark, 0 means train normally
+  unsigned int benchmarkGenerations = 0;
+  bool seedGiven = false;
+  bool netsGiven = false;
+  int ret;
+
+  // Register a signal handler that'll save networks when we quit
+  signal( SIGINT, sigintHandler );
+
+  int c;
+  while( (c = getopt_long (argc, argv, "s:t:g:f:n:r:c:b:o:h",
+			   getOptlist(), NULL)) != -1 ) {
+    switch(c) {
+    case 's': // Optional
+      params.runningSeed = strtoul(optarg, NULL, 16);
+      seedGiven = true;
+      break;
+    case 't': // Optional
+      numThreads = atoi(optarg);
+      break;
+    case 'g': // Optional
+      params.numGenerations = strtoul(optarg, NULL, 10);
+      break;
+    case 'f': // Optional
+      params.firstGeneration = strtoul(optarg, NULL, 10);
+      break;
+    case 'n': // Optional
+      params.numNets = strtoul(optarg, NULL, 10);
+      netsGiven = true;
+      break;
+    case 'r': // Optional
+      params.numRounds = strtoul(optarg, NULL, 10);
+      break;
+    case 'o': // Optional
+      params.outputFolder = optarg;
+      break;
+    case 'c': // Optional
+      params.numCheckpointThreads = atoi(optarg);
+      break;
+    case 'b': // Optional
+      fprintf( stderr, "This is actually not setting the number of bits to compare, sorry...\n" );
+      params.numBits = strtoul(optarg, NULL, 10);
+      break;
+    case START_BITS: // Optional
+      //startBit = strtoul(optarg, NULL, 10);
+      break;
+    case FAST_ACTIVATIONS: // Optional
+      activationSetDefaultMode( activation_mode_fast );
+      break;
+    case BENCHMARK: // Optional
+      benchmarkGenerations = strtoul(optarg, NULL, 10);
+      break;
+    case PERF_COUNTERS: // Optional
+#ifdef ENABLE_PHASE_TIMERS
+      if( !perfCountersEnable() ) {
+	fprintf( stderr, "Performance counters unavailable (%s), continuing without them\n",
+		 strerror( errno ) );
+      }
+#else
+      fprintf( stderr, "Built without PHASE_TIMERS=1, ignoring --perf-counters\n" );
+#endif
+      break;
+    case TRACE: // Optional
+      if( !traceOpen( optarg ) ) {
+	fprintf( stderr, "Can't write trace to %s\n", optarg );
+	return -1;
+      }
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  // Get the rest of the arguments since they might be networks
+  params.numFiles = argc - optind;
+  params.files = &argv[optind];
+
+  pthread_mutex_init( &net_mutex, NULL );
+
+  if( benchmarkGenerations > 0 ) {
+    if( !seedGiven ) {
+      params.runningSeed = BENCHMARK_SEED;
+    }
+    if( !netsGiven ) {
+      params.numNets = BENCHMARK_NETS;
+    }
+    params.firstGeneration = 0;
+    params.numGenerations = benchmarkGenerations;
+
+    if( numThreads < 1 ) {
+      numThreads = sysconf( _SC_NPROCESSORS_ONLN );
+    }
+    ret = benchmark( &params, numThreads < 1 ? 1 : numThreads );
+  } else {
+    ret = train( &params, numThreads < 1 ? 1 : numThreads, NULL );
+  }
+
+  traceClose();
+  return ret;
+}
@@ -8,43 +8,22 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-#include "geometry.h"
-
-#define SQRT_2_HALF 0.70710678118
-
-#define SCREEN_WIDTH 640
-#define SCREEN_HEIGHT 480
-
-#define BLOCK_ROWS 5
-#define BLOCK_COLS 10
-// Try to make this divide exactly or it'll be weird
-#define BLOCK_WIDTH (SCREEN_WIDTH / BLOCK_COLS)
-#define BLOCK_HEIGHT 15
-// Purely cosmetic
-#define BLOCK_MARGIN 1
-#define BLOCK_HEALTH 100
-#define BLOCK_DAMAGE 20
-
-#define PADDLE_MAX_WIDTH 80
-#define PADDLE_MIN_WIDTH 10
-#define PADDLE_WIDTH_DECREASE 2
-#define PADDLE_HEIGHT 10
-#define PADDLE_Y_POS (SCREEN_HEIGHT - 2 * PADDLE_HEIGHT)
-#define PADDLE_X_POS ((SCREEN_WIDTH - PADDLE_MAX_WIDTH) / 2)
-#define PADDLE_MAX_SPEED 15
-
-#define BALL_SIZE 10
-#define BALL_SPEED 5
-#define BALL_START_X ((SCREEN_WIDTH - BALL_SIZE) / 2)
-#define BALL_START_Y (PADDLE_Y_POS - BALL_SIZE)
-#define BALL_MIN_ANGLE (M_PI/3.0)
-#define BALL_MAX_ANGLE (2.0*M_PI/3.0)
-
-// Number of points per struck block initially
-#define POINTS_BASE 10
-// How much the number of points increase with every strike before being
-//  reset by hitting the paddle
-#define POINTS_INCREASE 1
+#include "arkanoid_internal.h"
+
+// Steps per unit of a uint8 screen sensor, every level the screen uses is a
+//  multiple of 1 / U8_STEPS
+#define U8_STEPS 200
+
+// Fixed point games keep positions and directions in steps of 1 / FIXED_ONE
+//  pixels
+#define FIXED_ONE 256
+#define FIXED(__pixels__) ((__pixels__) * FIXED_ONE)
+
+// Steps across the paddle in bounceDirections, from the middle to one side
+#define BOUNCE_STEPS 256
+// Serves go up to this many bounce steps either side of straight up, which
+//  is cos(BALL_MIN_ANGLE) = 0.5 in the same units
+#define SERVE_STEPS 181
 
 #ifndef min
 #  define min(__a__, __b__) ((__a__) < (__b__) ? (__a__) : (__b__))
@@ -53,11 +32,58 @@
 #  define max(__a__, __b__) ((__a__) > (__b__) ? (__a__) : (__b__))
 #endif
 
+// Blocks always sit in the same place in the grid, see blockTopLeft()
 typedef struct block_s {
-  point_t top_left;
   int      health;
 } block_t;
 
+// Fixed point ball directions, x and -y, for every bounce step i.  They're
+//  what arkanoidStrikeBall() works out with acos() for a hit i / BOUNCE_STEPS
+//  of the way across the paddle, x = i / BOUNCE_STEPS * SQRT_2_HALF *
+//  BALL_SPEED and y = sqrt(BALL_SPEED^2 - x^2), rounded to whole steps.
+//  Negative steps go left, see bounceDirection().
+static const int16_t bounceDirections[BOUNCE_STEPS + 1][2] = {
+	{0, 1280}, {4, 1280}, {7, 1280}, {11, 1280}, {14, 1280}, {18, 1280}, {21, 1280}, {25, 1280},
+	{28, 1280}, {32, 1280}, {35, 1280}, {39, 1279}, {42, 1279}, {46, 1279}, {49, 1279}, {53, 1279},
+	{57, 1279}, {60, 1279}, {64, 1278}, {67, 1278}, {71, 1278}, {74, 1278}, {78, 1278}, {81, 1277},
+	{85, 1277}, {88, 1277}, {92, 1277}, {95, 1276}, {99, 1276}, {103, 1276}, {106, 1276}, {110, 1275},
+	{113, 1275}, {117, 1275}, {120, 1274}, {124, 1274}, {127, 1274}, {131, 1273}, {134, 1273}, {138, 1273},
+	{141, 1272}, {145, 1272}, {148, 1271}, {152, 1271}, {156, 1271}, {159, 1270}, {163, 1270}, {166, 1269},
+	{170, 1269}, {173, 1268}, {177, 1268}, {180, 1267}, {184, 1267}, {187, 1266}, {191, 1266}, {194, 1265},
+	{198, 1265}, {202, 1264}, {205, 1263}, {209, 1263}, {212, 1262}, {216, 1262}, {219, 1261}, {223, 1260},
+	{226, 1260}, {230, 1259}, {233, 1259}, {237, 1258}, {240, 1257}, {244, 1257}, {247, 1256}, {251, 1255},
+	{255, 1254}, {258, 1254}, {262, 1253}, {265, 1252}, {269, 1251}, {272, 1251}, {276, 1250}, {279, 1249},
+	{283, 1248}, {286, 1248}, {290, 1247}, {293, 1246}, {297, 1245}, {301, 1244}, {304, 1243}, {308, 1242},
+	{311, 1242}, {315, 1241}, {318, 1240}, {322, 1239}, {325, 1238}, {329, 1237}, {332, 1236}, {336, 1235},
+	{339, 1234}, {343, 1233}, {346, 1232}, {350, 1231}, {354, 1230}, {357, 1229}, {361, 1228}, {364, 1227},
+	{368, 1226}, {371, 1225}, {375, 1224}, {378, 1223}, {382, 1222}, {385, 1221}, {389, 1219}, {392, 1218},
+	{396, 1217}, {400, 1216}, {403, 1215}, {407, 1214}, {410, 1213}, {414, 1211}, {417, 1210}, {421, 1209},
+	{424, 1208}, {428, 1206}, {431, 1205}, {435, 1204}, {438, 1203}, {442, 1201}, {445, 1200}, {449, 1199},
+	{453, 1197}, {456, 1196}, {460, 1195}, {463, 1193}, {467, 1192}, {470, 1190}, {474, 1189}, {477, 1188},
+	{481, 1186}, {484, 1185}, {488, 1183}, {491, 1182}, {495, 1180}, {499, 1179}, {502, 1177}, {506, 1176},
+	{509, 1174}, {513, 1173}, {516, 1171}, {520, 1170}, {523, 1168}, {527, 1167}, {530, 1165}, {534, 1163},
+	{537, 1162}, {541, 1160}, {544, 1158}, {548, 1157}, {552, 1155}, {555, 1153}, {559, 1152}, {562, 1150},
+	{566, 1148}, {569, 1146}, {573, 1145}, {576, 1143}, {580, 1141}, {583, 1139}, {587, 1138}, {590, 1136},
+	{594, 1134}, {598, 1132}, {601, 1130}, {605, 1128}, {608, 1126}, {612, 1124}, {615, 1122}, {619, 1121},
+	{622, 1119}, {626, 1117}, {629, 1115}, {633, 1113}, {636, 1111}, {640, 1109}, {643, 1107}, {647, 1104},
+	{651, 1102}, {654, 1100}, {658, 1098}, {661, 1096}, {665, 1094}, {668, 1092}, {672, 1090}, {675, 1087},
+	{679, 1085}, {682, 1083}, {686, 1081}, {689, 1078}, {693, 1076}, {697, 1074}, {700, 1072}, {704, 1069},
+	{707, 1067}, {711, 1065}, {714, 1062}, {718, 1060}, {721, 1057}, {725, 1055}, {728, 1053}, {732, 1050},
+	{735, 1048}, {739, 1045}, {742, 1043}, {746, 1040}, {750, 1038}, {753, 1035}, {757, 1032}, {760, 1030},
+	{764, 1027}, {767, 1025}, {771, 1022}, {774, 1019}, {778, 1017}, {781, 1014}, {785, 1011}, {788, 1008},
+	{792, 1006}, {795, 1003}, {799, 1000}, {803, 997}, {806, 994}, {810, 991}, {813, 989}, {817, 986},
+	{820, 983}, {824, 980}, {827, 977}, {831, 974}, {834, 971}, {838, 968}, {841, 965}, {845, 961},
+	{849, 958}, {852, 955}, {856, 952}, {859, 949}, {863, 946}, {866, 942}, {870, 939}, {873, 936},
+	{877, 933}, {880, 929}, {884, 926}, {887, 922}, {891, 919}, {894, 916}, {898, 912}, {902, 909},
+	{905, 905}
+};
+
+typedef struct fixed_point_s {
+	int32_t x, y;
+} fixed_point_t;
+
+// Everything that changes while playing, kept flat so it can be copied as
+//  it is
 typedef struct game_state_s {
 	// Add more stuff here, obv
 	int counter;
@@ -73,16 +99,36 @@ typedef struct game_state_s {
 
 	int points_per_hit;
 
-	int num_blocks;
-	block_t *blocks;
+	block_t blocks[ARKANOID_NUM_BLOCKS];
+
+	// Only used by fixed point games, player_pos, ball_pos and ball_direction
+	//  follow them so nothing else has to know about them
+	int32_t fixed_player_x;
+	fixed_point_t fixed_ball_pos;
+	fixed_point_t fixed_ball_direction;
 } game_state_t;
 
+// What gameSnapshot() writes, the state and the public parts that change
+typedef struct snapshot_s {
+	int32_t score;
+	bool game_over;
+	game_state_t state;
+} snapshot_t;
+
+// Pixel rectangle, right and bottom are exclusive
+typedef struct rect_s {
+	int32_t left, top, right, bottom;
+} rect_t;
+
 typedef struct local_sensor_s {
 	char *name;
 	uint32_t height;
 	uint32_t width;
 	uint32_t depth;
+	sensor_type_t type;
+	float scale;
 	float *data;
+	uint8_t *data_u8;
 } local_sensor_t;
 
 
@@ -91,14 +137,35 @@ typedef struct local_game_s {
 	local_sensor_t *sensors;
 	int32_t score;
 	bool game_over;
+	uint32_t flags;
+	uint32_t snapshot_size;
 
 	// Sends a new input to the game and requests a new state to be written
 	//  into <game>.
 	void(*_update)(game_t* game, input_t input);
+	const sensor_t *(*_get_sensor)(game_t* game, uint32_t index);
+	void(*_snapshot)(game_t* game, void *snapshot);
+	void(*_restore)(game_t* game, const void *snapshot);
+	const game_interface_t *game_interface;
 
 	// Local stuff here
 	void* _internal_game_state;
 	int32_t max_rounds;
+	// The screen hasn't been painted since the state last changed
+	bool screen_dirty;
+	// Simulate with simulateFixed()
+	bool fixed_point;
+
+	// What the screen showed when it was last painted, so only the parts
+	//  that changed have to be painted again.  Everything is painted when
+	//  screen_valid is false or full_redraw is set.
+	bool screen_valid;
+	bool full_redraw;
+	// Full resolution pixels per sensor pixel in each direction
+	int32_t sensor_scale;
+	rect_t painted_ball;
+	rect_t painted_paddle;
+	int painted_health[ARKANOID_NUM_BLOCKS];
 } local_game_t;
 
 typedef enum direction_e {
@@ -109,6 +176,16 @@ typedef enum direction_e {
 	direction_right
 } direction_t;
 
+// Where <block> sits, blocks are stored row by row from the top left
+static point_t blockTopLeft(int block)
+{
+	point_t p = {
+		(float)(block % BLOCK_COLS) * BLOCK_WIDTH,
+		(float)(block / BLOCK_COLS) * BLOCK_HEIGHT
+	};
+	return p;
+}
+
 direction_t intersects(local_game_t *game, int block, point_t last_pos, point_t next_pos, point_t block_pos, uint32_t width, uint32_t height)
 {
 	// We know that the angle can't be low enough to go entirely sideways, so !up = down, but !left != right.
@@ -164,7 +241,7 @@ direction_t intersects(local_game_t *game, int block, point_t last_pos, point_t
 	return direction_none;
 }
 
-void strikeBall(local_game_t *l_game, point_t ball, point_t direction, point_t paddle, uint32_t width)
+bool arkanoidStrikeBall(point_t ball, point_t direction, point_t paddle, uint32_t width, point_t *new_direction)
 {
 	line_t ballLine = {
 		ball,
@@ -183,36 +260,116 @@ void strikeBall(local_game_t *l_game, point_t ball, point_t direction, point_t p
 	};
 
 	point_t iPoint;
-	if (intersectSegment(ballLine, paddleLine, &iPoint)) {
-		game_state_t *state = l_game->_internal_game_state;
+	if (!intersectSegment(ballLine, paddleLine, &iPoint)) {
+		return false;
+	}
+
+	float dist = (iPoint.x - paddleLine.p1.x) / (width);
+
+	if (ballLine.p1.x < ballLine.p2.x) {
+		// Going right
+		float angle = (float)acos(dist * SQRT_2_HALF);
+
+		new_direction->x = (float)cos(angle) * BALL_SPEED;
+		new_direction->y = (float)-sin(angle) * BALL_SPEED;
+	}
+	else if (ballLine.p1.x > ballLine.p2.x) {
+		// Going left
+		float angle = (float)acos((1.0 - dist) * SQRT_2_HALF);
+
+		new_direction->x = (float)-cos(angle) * BALL_SPEED;
+		new_direction->y = (float)-sin(angle) * BALL_SPEED;
+	}
+	else {
+		// Straight down
+		float angle = (float)acos(2 * (dist - 0.5) * SQRT_2_HALF);
+
+		new_direction->x = (float)cos(angle) * BALL_SPEED;
+		new_direction->y = (float)-sin(angle) * BALL_SPEED;
+	}
 
+	return true;
+}
+
+void strikeBall(local_game_t *l_game, point_t ball, point_t direction, point_t paddle, uint32_t width)
+{
+	game_state_t *state = l_game->_internal_game_state;
+
+	if (arkanoidStrikeBall(ball, direction, paddle, width, &state->ball_direction)) {
 		// Reset points per hit when the paddle strikes
 		state->points_per_hit = POINTS_BASE;
+	}
+}
 
-		float dist = (iPoint.x - paddleLine.p1.x) / (width);
+void arkanoidServeBall(unsigned int *seed, point_t *pos, point_t *direction)
+{
+	pos->x = rand_r( seed ) % (SCREEN_WIDTH - PADDLE_MAX_WIDTH);
+	pos->y = BALL_START_Y;
+	float startAngle = BALL_MIN_ANGLE + (rand_r( seed ) / (float)RAND_MAX) * (BALL_MAX_ANGLE - BALL_MIN_ANGLE);
+	direction->x = (float)cos(startAngle) * BALL_SPEED;
+	direction->y = (float)-sin(startAngle) * BALL_SPEED;
+}
 
-		if (ballLine.p1.x < ballLine.p2.x) {
-			// Going right
-			float angle = (float)acos(dist * SQRT_2_HALF);
+// The ball direction for bounce step <step>, negative steps go left
+static fixed_point_t bounceDirection(int step)
+{
+	int i = step < 0 ? -step : step;
+	fixed_point_t direction = {
+		step < 0 ? -bounceDirections[i][0] : bounceDirections[i][0],
+		-bounceDirections[i][1]
+	};
+	return direction;
+}
 
-			state->ball_direction.x = (float)cos(angle) * BALL_SPEED;
-			state->ball_direction.y = (float)-sin(angle) * BALL_SPEED;
-		}
-		else if (ballLine.p1.x > ballLine.p2.x) {
-			// Going left
-			float angle = (float)acos((1.0 - dist) * SQRT_2_HALF);
+// Same as arkanoidServeBall(), drawing as many numbers from <seed>
+static void serveBallFixed(unsigned int *seed, fixed_point_t *pos, fixed_point_t *direction)
+{
+	pos->x = FIXED(rand_r( seed ) % (SCREEN_WIDTH - PADDLE_MAX_WIDTH));
+	pos->y = FIXED(BALL_START_Y);
+	*direction = bounceDirection(rand_r( seed ) % (2 * SERVE_STEPS + 1) - SERVE_STEPS);
+}
 
-			state->ball_direction.x = (float)-cos(angle) * BALL_SPEED;
-			state->ball_direction.y = (float)-sin(angle) * BALL_SPEED;
-		}
-		else {
-			// Straight down
-			float angle = (float)acos(2 * (dist - 0.5) * SQRT_2_HALF);
+// Same as arkanoidStrikeBall() with the bounce looked up.  The ball comes
+//  down, so its line crosses the top of the paddle exactly once.
+static bool strikeBallFixed(fixed_point_t ball, fixed_point_t direction, fixed_point_t paddle, uint32_t width, fixed_point_t *new_direction)
+{
+	int32_t fall = direction.y + FIXED(BALL_SIZE);
+	int32_t drop = paddle.y - ball.y;
+	if (fall <= 0 || drop < 0 || drop > fall) {
+		return false;
+	}
 
-			state->ball_direction.x = (float)cos(angle) * BALL_SPEED;
-			state->ball_direction.y = (float)-sin(angle) * BALL_SPEED;
-		}
+	int32_t across = ball.x + (int32_t)((int64_t)direction.x * drop / fall) - paddle.x;
+	if (across < 0 || across > FIXED((int32_t)width)) {
+		return false;
+	}
+
+	int step = (int)((int64_t)across * BOUNCE_STEPS / FIXED((int32_t)width));
+	if (direction.x > 0) {
+		// Going right
+		*new_direction = bounceDirection(step);
+	}
+	else if (direction.x < 0) {
+		// Going left
+		*new_direction = bounceDirection(step - BOUNCE_STEPS);
+	}
+	else {
+		// Straight down
+		*new_direction = bounceDirection(2 * step - BOUNCE_STEPS);
 	}
+
+	return true;
+}
+
+// Keep the float positions the painter and state sensor read in step with
+//  the fixed point ones, they're exact since everything fits in a float
+static void followFixed(game_state_t *state)
+{
+	state->player_pos.x = state->fixed_player_x * (1.0f / FIXED_ONE);
+	state->ball_pos.x = state->fixed_ball_pos.x * (1.0f / FIXED_ONE);
+	state->ball_pos.y = state->fixed_ball_pos.y * (1.0f / FIXED_ONE);
+	state->ball_direction.x = state->fixed_ball_direction.x * (1.0f / FIXED_ONE);
+	state->ball_direction.y = state->fixed_ball_direction.y * (1.0f / FIXED_ONE);
 }
 
 void drawGame(local_game_t *game)
@@ -224,10 +381,10 @@ void drawGame(local_game_t *game)
 
 	int i;
 	uint32_t x, y;
-	for (i = 0; i < state->num_blocks; i++) {
+	for (i = 0; i < ARKANOID_NUM_BLOCKS; i++) {
 		if (state->blocks[i].health > 0) {
-			uint32_t block_top = (int)state->blocks[i].top_left.y;
-			uint32_t block_left = (int)state->blocks[i].top_left.x;
+			uint32_t block_top = (int)blockTopLeft(i).y;
+			uint32_t block_left = (int)blockTopLeft(i).x;
 			for (y = block_top + BLOCK_MARGIN; y < block_top + BLOCK_HEIGHT - BLOCK_MARGIN; y++) {
 				for (x = block_left + BLOCK_MARGIN; x < block_left + BLOCK_WIDTH - BLOCK_MARGIN; x++) {
 					game->sensors[0].data[y * game->sensors[0].width + x] =
@@ -254,6 +411,213 @@ void drawGame(local_game_t *game)
 	}
 }
 
+static rect_t intersectRect(rect_t a, rect_t b)
+{
+	rect_t r = {
+		max(a.left, b.left), max(a.top, b.top),
+		min(a.right, b.right), min(a.bottom, b.bottom)
+	};
+	return r;
+}
+
+static bool sameRect(rect_t a, rect_t b)
+{
+	return a.left == b.left && a.top == b.top &&
+		a.right == b.right && a.bottom == b.bottom;
+}
+
+// The pixels drawGame() paints for each object
+static rect_t blockRect(game_state_t *state, int block)
+{
+	int32_t block_top = (int)blockTopLeft(block).y;
+	int32_t block_left = (int)blockTopLeft(block).x;
+	rect_t r = {
+		block_left + BLOCK_MARGIN, block_top + BLOCK_MARGIN,
+		block_left + BLOCK_WIDTH - BLOCK_MARGIN, block_top + BLOCK_HEIGHT - BLOCK_MARGIN
+	};
+	return r;
+}
+
+static rect_t paddleRect(game_state_t *state)
+{
+	int32_t player_top = (int)state->player_pos.y;
+	int32_t player_left = (int)state->player_pos.x;
+	rect_t r = {
+		player_left, player_top,
+		player_left + (int32_t)state->paddle_width, player_top + PADDLE_HEIGHT
+	};
+	return r;
+}
+
+static rect_t ballRect(game_state_t *state)
+{
+	int32_t ball_top = (int)state->ball_pos.y;
+	int32_t ball_left = (int)state->ball_pos.x;
+	rect_t r = {
+		ball_left, ball_top,
+		min(ball_left + BALL_SIZE, SCREEN_WIDTH),
+		min(ball_top + BALL_SIZE, SCREEN_HEIGHT)
+	};
+	return r;
+}
+
+static int32_t rectArea(rect_t r)
+{
+	if (r.left >= r.right || r.top >= r.bottom) {
+		return 0;
+	}
+	return (r.right - r.left) * (r.bottom - r.top);
+}
+
+// Store <value> as sensor pixel <i> in whatever type the sensor has
+static inline void setPixel(local_game_t *game, int32_t i, float value)
+{
+	if (game->sensors[0].type == sensor_type_uint8) {
+		game->sensors[0].data_u8[i] = (uint8_t)(value * U8_STEPS + 0.5f);
+	} else {
+		game->sensors[0].data[i] = value;
+	}
+}
+
+static void fillRect(local_game_t *game, rect_t r, float value)
+{
+	int32_t x, y;
+	if (game->sensors[0].type == sensor_type_uint8) {
+		uint8_t byte = (uint8_t)(value * U8_STEPS + 0.5f);
+		for (y = r.top; y < r.bottom && r.left < r.right; y++) {
+			memset(&game->sensors[0].data_u8[y * game->sensors[0].width + r.left], byte, r.right - r.left);
+		}
+		return;
+	}
+	for (y = r.top; y < r.bottom; y++) {
+		for (x = r.left; x < r.right; x++) {
+			game->sensors[0].data[y * game->sensors[0].width + x] = value;
+		}
+	}
+}
+
+// Paint the sensor pixels in <region>, given in sensor pixels, of a
+//  downscaled screen.  Every sensor pixel is the average of the full
+//  resolution pixels it covers, worked out from how much of each object is
+//  visible inside it.  The ball covers the paddle which covers the blocks.
+static void paintScaledRegion(local_game_t *game, rect_t region)
+{
+	game_state_t *state = (game_state_t*)game->_internal_game_state;
+	int32_t scale = game->sensor_scale;
+	float pixelArea = (float)(scale * scale);
+	rect_t paddle = paddleRect(state);
+	rect_t ball = ballRect(state);
+	int32_t x, y;
+
+	for (y = region.top; y < region.bottom; y++) {
+		for (x = region.left; x < region.right; x++) {
+			rect_t pixel = {x * scale, y * scale, (x + 1) * scale, (y + 1) * scale};
+			rect_t visiblePaddle = intersectRect(paddle, pixel);
+			rect_t visibleBall = intersectRect(ball, pixel);
+			int32_t ballArea = rectArea(visibleBall);
+			int32_t paddleArea = rectArea(visiblePaddle) - rectArea(intersectRect(visiblePaddle, ball));
+			float sum = 0.5f * ballArea + 0.75f * paddleArea;
+
+			// Blocks sit in a grid, only look at the ones this pixel touches
+			int32_t row, col;
+			for (row = pixel.top / BLOCK_HEIGHT; row <= (pixel.bottom - 1) / BLOCK_HEIGHT && row < BLOCK_ROWS; row++) {
+				for (col = pixel.left / BLOCK_WIDTH; col <= (pixel.right - 1) / BLOCK_WIDTH && col < BLOCK_COLS; col++) {
+					int b = row * BLOCK_COLS + col;
+					if (state->blocks[b].health <= 0) {
+						continue;
+					}
+					rect_t block = intersectRect(blockRect(state, b), pixel);
+					int32_t blockArea = rectArea(block)
+						- rectArea(intersectRect(block, paddle))
+						- rectArea(intersectRect(block, ball))
+						+ rectArea(intersectRect(intersectRect(block, paddle), ball));
+					sum += (float)(state->blocks[b].health / (float)BLOCK_HEALTH) * blockArea;
+				}
+			}
+
+			setPixel(game, y * game->sensors[0].width + x, sum / pixelArea);
+		}
+	}
+}
+
+// Paint everything inside <region>, given in full resolution pixels, the
+//  same way drawGame() would
+static void paintRegion(local_game_t *game, rect_t region)
+{
+	game_state_t *state = (game_state_t*)game->_internal_game_state;
+	rect_t screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+	int i;
+
+	if (game->sensor_scale > 1) {
+		// Every sensor pixel the region touches
+		int32_t scale = game->sensor_scale;
+		region = intersectRect(region, screen);
+		if (region.left < region.right && region.top < region.bottom) {
+			rect_t scaled = {
+				region.left / scale, region.top / scale,
+				(region.right + scale - 1) / scale, (region.bottom + scale - 1) / scale
+			};
+			paintScaledRegion(game, scaled);
+		}
+		return;
+	}
+
+	region = intersectRect(region, screen);
+	if (region.left >= region.right || region.top >= region.bottom) {
+		return;
+	}
+
+	fillRect(game, region, 0);
+	for (i = 0; i < ARKANOID_NUM_BLOCKS; i++) {
+		if (state->blocks[i].health > 0) {
+			fillRect(game, intersectRect(blockRect(state, i), region),
+				(float)(state->blocks[i].health / (float)BLOCK_HEALTH));
+		}
+	}
+	fillRect(game, intersectRect(paddleRect(state), region), 0.75);
+	fillRect(game, intersectRect(ballRect(state), region), 0.5);
+}
+
+// Only paint what changed since the screen was last painted, the result is
+//  the same as drawGame()
+static void drawChanges(local_game_t *game)
+{
+	game_state_t *state = (game_state_t*)game->_internal_game_state;
+	rect_t ball = ballRect(state);
+	rect_t paddle = paddleRect(state);
+	int i;
+
+	if (game->full_redraw || !game->screen_valid) {
+		// drawGame() only knows full resolution floats
+		if (game->sensor_scale > 1 || game->sensors[0].type != sensor_type_float) {
+			paintRegion(game, (rect_t) {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT});
+		} else {
+			drawGame(game);
+		}
+	} else {
+		paintRegion(game, game->painted_ball);
+		if (!sameRect(ball, game->painted_ball)) {
+			paintRegion(game, ball);
+		}
+		paintRegion(game, game->painted_paddle);
+		if (!sameRect(paddle, game->painted_paddle)) {
+			paintRegion(game, paddle);
+		}
+		for (i = 0; i < ARKANOID_NUM_BLOCKS; i++) {
+			if (state->blocks[i].health != game->painted_health[i]) {
+				paintRegion(game, blockRect(state, i));
+			}
+		}
+	}
+
+	game->painted_ball = ball;
+	game->painted_paddle = paddle;
+	for (i = 0; i < ARKANOID_NUM_BLOCKS; i++) {
+		game->painted_health[i] = state->blocks[i].health;
+	}
+	game->screen_valid = true;
+}
+
 void hit(local_game_t *l_game, int block)
 {
 	game_state_t *state = l_game->_internal_game_state;
@@ -267,8 +631,6 @@ void initBlocks(game_state_t *state)
 	int row, col;
 	for (row = 0; row < BLOCK_ROWS; row++) {
 		for (col = 0; col < BLOCK_COLS; col++) {
-			state->blocks[row * BLOCK_COLS + col].top_left.y = (float)row * BLOCK_HEIGHT;
-			state->blocks[row * BLOCK_COLS + col].top_left.x = (float)col * BLOCK_WIDTH;
 			state->blocks[row * BLOCK_COLS + col].health = BLOCK_HEALTH;
 		}
 	}
@@ -295,7 +657,7 @@ void blockCollision(local_game_t *l_game, game_state_t *state, point_t last_ball
 	}
 
 	// Intersecting a block
-	direction_t bounce_direction = intersects(l_game, block, last_ball_pos, state->ball_pos, state->blocks[block].top_left, BLOCK_WIDTH, BLOCK_HEIGHT);
+	direction_t bounce_direction = intersects(l_game, block, last_ball_pos, state->ball_pos, blockTopLeft(block), BLOCK_WIDTH, BLOCK_HEIGHT);
 	// If block still alive, bounce
 	// If block died, continue in the same direction
 	switch (bounce_direction) {
@@ -318,21 +680,219 @@ void blockCollision(local_game_t *l_game, game_state_t *state, point_t last_ball
 	}
 }
 
-void updateArkanoid(game_t *game, input_t input)
+// Row or column of the grid that <pos> falls in moved by <spare> cells,
+//  clamped to the <count> cells there are
+static int gridCell(float pos, int size, int count, int spare)
 {
-	assert(game);
-	local_game_t *l_game = (local_game_t*)game;
-	game_state_t *state = l_game->_internal_game_state;
+	int cell = (int)floorf(pos / size) + spare;
+	return min(max(cell, 0), count - 1);
+}
 
-	// Update player position
+// Test the blocks in the grid cells the ball passed through on its way from
+//  <last_ball_pos>, with a cell to spare on every side for rounding.  No
+//  other block can be hit, see intersects(), so the hits and their order are
+//  the same as testing every block, which is row by row going down and in
+//  reverse going up.
+static void blockCollisions(local_game_t *l_game, game_state_t *state, point_t last_ball_pos)
+{
+	float top = min(last_ball_pos.y, state->ball_pos.y);
+	float bottom = max(last_ball_pos.y, state->ball_pos.y) + BALL_SIZE;
+	float left = state->ball_pos.x;
+	float right = state->ball_pos.x + BALL_SIZE;
+	int row, col;
+
+	// Below the blocks
+	if (top > BLOCK_ROWS * BLOCK_HEIGHT) {
+		return;
+	}
+
+	int first_row = gridCell(top, BLOCK_HEIGHT, BLOCK_ROWS, -1);
+	int last_row = gridCell(bottom, BLOCK_HEIGHT, BLOCK_ROWS, 1);
+	int first_col = gridCell(left, BLOCK_WIDTH, BLOCK_COLS, -1);
+	int last_col = gridCell(right, BLOCK_WIDTH, BLOCK_COLS, 1);
+
+	if (state->ball_direction.y < 0) {
+		// Going upwards, test blocks in reverse order
+		for (row = last_row; row >= first_row; row--) {
+			for (col = last_col; col >= first_col; col--) {
+				blockCollision(l_game, state, last_ball_pos, row * BLOCK_COLS + col);
+			}
+		}
+	}
+	else {
+		// Going downwards
+		for (row = first_row; row <= last_row; row++) {
+			for (col = first_col; col <= last_col; col++) {
+				blockCollision(l_game, state, last_ball_pos, row * BLOCK_COLS + col);
+			}
+		}
+	}
+}
+
+// Same as intersects() in fixed point, <block_pos> too
+static direction_t intersectsFixed(fixed_point_t last_pos, fixed_point_t next_pos, fixed_point_t block_pos, int32_t width, int32_t height)
+{
+	if (last_pos.y > next_pos.y) {
+		// Going up
+		if ((last_pos.y >= block_pos.y + FIXED(height)) &&
+			(next_pos.y <= block_pos.y + FIXED(height)) &&
+			(next_pos.x < block_pos.x + FIXED(width)) &&
+			(next_pos.x + FIXED(BALL_SIZE) >= block_pos.x)) {
+			return direction_up;
+		}
+	}
+	else {
+		// Going down
+		if ((last_pos.y + FIXED(BALL_SIZE) <= block_pos.y) &&
+			(next_pos.y + FIXED(BALL_SIZE) >= block_pos.y) &&
+			(next_pos.x < block_pos.x + FIXED(width)) &&
+			(next_pos.x + FIXED(BALL_SIZE) >= block_pos.x)) {
+			return direction_down;
+		}
+	}
+
+	if ((next_pos.x + FIXED(BALL_SIZE) >= block_pos.x &&
+		next_pos.x < block_pos.x + FIXED(width)) &&
+		(next_pos.y + FIXED(BALL_SIZE) >= block_pos.y &&
+		next_pos.y < block_pos.y + FIXED(height))) {
+		return direction_left;
+	}
+
+	return direction_none;
+}
+
+static void blockCollisionFixed(local_game_t *l_game, game_state_t *state, fixed_point_t last_ball_pos, int block)
+{
+	if (state->blocks[block].health <= 0) {
+		return;
+	}
+
+	fixed_point_t block_pos = {
+		FIXED((block % BLOCK_COLS) * BLOCK_WIDTH),
+		FIXED((block / BLOCK_COLS) * BLOCK_HEIGHT)
+	};
+	switch (intersectsFixed(last_ball_pos, state->fixed_ball_pos, block_pos, BLOCK_WIDTH, BLOCK_HEIGHT)) {
+	case direction_up:
+	case direction_down:
+		hit(l_game, block);
+		if (state->blocks[block].health > 0)
+			state->fixed_ball_direction.y = -state->fixed_ball_direction.y;
+		break;
+
+	case direction_left:
+	case direction_right:
+		hit(l_game, block);
+		if (state->blocks[block].health > 0)
+			state->fixed_ball_direction.x = -state->fixed_ball_direction.x;
+		break;
+
+	default: // Miss
+		break;
+	}
+}
+
+// Same as gridCell() for a fixed point <pos>
+static int gridCellFixed(int32_t pos, int size, int count, int spare)
+{
+	int32_t fixed_size = FIXED(size);
+	int cell = (pos >= 0 ? pos : pos - fixed_size + 1) / fixed_size + spare;
+	return min(max(cell, 0), count - 1);
+}
+
+// Same as blockCollisions()
+static void blockCollisionsFixed(local_game_t *l_game, game_state_t *state, fixed_point_t last_ball_pos)
+{
+	int32_t top = min(last_ball_pos.y, state->fixed_ball_pos.y);
+	int32_t bottom = max(last_ball_pos.y, state->fixed_ball_pos.y) + FIXED(BALL_SIZE);
+	int32_t left = state->fixed_ball_pos.x;
+	int32_t right = state->fixed_ball_pos.x + FIXED(BALL_SIZE);
+	int row, col;
+
+	if (top > FIXED(BLOCK_ROWS * BLOCK_HEIGHT)) {
+		return;
+	}
+
+	int first_row = gridCellFixed(top, BLOCK_HEIGHT, BLOCK_ROWS, -1);
+	int last_row = gridCellFixed(bottom, BLOCK_HEIGHT, BLOCK_ROWS, 1);
+	int first_col = gridCellFixed(left, BLOCK_WIDTH, BLOCK_COLS, -1);
+	int last_col = gridCellFixed(right, BLOCK_WIDTH, BLOCK_COLS, 1);
+
+	if (state->fixed_ball_direction.y < 0) {
+		for (row = last_row; row >= first_row; row--) {
+			for (col = last_col; col >= first_col; col--) {
+				blockCollisionFixed(l_game, state, last_ball_pos, row * BLOCK_COLS + col);
+			}
+		}
+	}
+	else {
+		for (row = first_row; row <= last_row; row++) {
+			for (col = first_col; col <= last_col; col++) {
+				blockCollisionFixed(l_game, state, last_ball_pos, row * BLOCK_COLS + col);
+			}
+		}
+	}
+}
+
+// Reset blocks and increase difficulty once every block is gone
+static void nextLevel(local_game_t *l_game, game_state_t *state)
+{
+	if (areBlocksDead(state)) {
+		initBlocks(state);
+		l_game->screen_valid = false;
+		if (state->paddle_width > PADDLE_MIN_WIDTH) {
+			state->paddle_width -= PADDLE_WIDTH_DECREASE;
+			state->player_pos.x += PADDLE_WIDTH_DECREASE / 2;
+			state->fixed_player_x += FIXED(PADDLE_WIDTH_DECREASE / 2);
+		}
+	}
+}
+
+static void movePaddleFloat(game_state_t *state, input_t input)
+{
 	state->player_pos.x += (float)min(max(input.right, 0.0), 1.0) * PADDLE_MAX_SPEED;
 	state->player_pos.x -= (float)min(max(input.left, 0.0), 1.0) * PADDLE_MAX_SPEED;
 	if (state->player_pos.x < 0) {
 		state->player_pos.x = 0;
 	}
-	if (state->player_pos.x >= game->sensors[0].width - state->paddle_width) {
-		state->player_pos.x = (float)game->sensors[0].width - state->paddle_width - 1;
+	if (state->player_pos.x >= SCREEN_WIDTH - state->paddle_width) {
+		state->player_pos.x = (float)SCREEN_WIDTH - state->paddle_width - 1;
+	}
+}
+
+// Paddle speed in fixed point for <input>.  Inputs are cut to whole steps
+//  first, multiplying by a power of two is exact however floats are
+//  evaluated.
+static int32_t paddleSpeedFixed(input_t input)
+{
+	int32_t right = (int32_t)(min(max(input.right, 0.0f), 1.0f) * FIXED_ONE);
+	int32_t left = (int32_t)(min(max(input.left, 0.0f), 1.0f) * FIXED_ONE);
+	return (right - left) * PADDLE_MAX_SPEED;
+}
+
+// Move the paddle <steps> times at <speed>, the same as one step at a time
+static void movePaddleFixed(game_state_t *state, int32_t speed, uint32_t steps)
+{
+	int32_t limit = FIXED(SCREEN_WIDTH) - FIXED((int32_t)state->paddle_width);
+	int64_t x = state->fixed_player_x + (int64_t)speed * steps;
+
+	if (x < 0) {
+		// Stays at the left side once it gets there
+		x = 0;
+	}
+	else if (x >= limit) {
+		// Put a pixel back from the right side every time it gets there, so
+		//  from the first time on it goes round every <period> steps
+		int64_t first = (limit - state->fixed_player_x + speed - 1) / speed;
+		int64_t period = (FIXED_ONE + speed - 1) / speed;
+		x = limit - FIXED_ONE + ((steps - first) % period) * speed;
 	}
+	state->fixed_player_x = (int32_t)x;
+}
+
+static void simulateFloat(local_game_t *l_game, game_state_t *state, input_t input)
+{
+	// Update player position
+	movePaddleFloat(state, input);
 
 	// Update ball position
 	point_t last_ball_pos = state->ball_pos;
@@ -340,29 +900,15 @@ void updateArkanoid(game_t *game, input_t input)
 	state->ball_pos.y += state->ball_direction.y;
 
 	// Figure out if anything's happened with the blocks this round
-	int b;
-
-	if (state->ball_direction.y < 0) {
-		// Going upwards, test blocks in reverse order
-		for (b = state->num_blocks-1; b >= 0; b--) {
-			blockCollision(l_game, state, last_ball_pos, b);
-		}
-
-	}
-	else {
-		// Going downwards
-		for (b = 0; b < state->num_blocks; b++) {
-			blockCollision(l_game, state, last_ball_pos, b);
-		}
-	}
+	blockCollisions(l_game, state, last_ball_pos);
 
 	// Bounce on walls
 	if (state->ball_pos.x <= 0) {
 		state->ball_pos.x = -state->ball_pos.x;
 		state->ball_direction.x = -state->ball_direction.x;
 	}
-	if (state->ball_pos.x + BALL_SIZE >= game->sensors[0].width - 1) {
-		state->ball_pos.x = 2 * (game->sensors[0].width - 1 - BALL_SIZE) - state->ball_pos.x;
+	if (state->ball_pos.x + BALL_SIZE >= SCREEN_WIDTH - 1) {
+		state->ball_pos.x = 2 * (SCREEN_WIDTH - 1 - BALL_SIZE) - state->ball_pos.x;
 		state->ball_direction.x = -state->ball_direction.x;
 	}
 	if (state->ball_pos.y <= 0) {
@@ -371,104 +917,411 @@ void updateArkanoid(game_t *game, input_t input)
 	}
 
 	// Die at the bottom
-	if (state->ball_pos.y + BALL_SIZE >= game->sensors[0].height - 1)
+	if (state->ball_pos.y + BALL_SIZE >= SCREEN_HEIGHT - 1)
 		l_game->game_over = true;
 
 	// Bounce on paddle
 	direction_t bounce_direction = intersects(l_game, -1, last_ball_pos, state->ball_pos, state->player_pos, state->paddle_width, PADDLE_HEIGHT);
 	if (bounce_direction == direction_down) {
 		strikeBall(l_game, last_ball_pos, state->ball_direction, state->player_pos, state->paddle_width);
+		nextLevel(l_game, state);
+	}
+}
 
-		// Reset blocks and increase difficulty
-		if (areBlocksDead(state)) {
-			initBlocks(state);
-			if (state->paddle_width > PADDLE_MIN_WIDTH) {
-				state->paddle_width -= PADDLE_WIDTH_DECREASE;
-				state->player_pos.x += PADDLE_WIDTH_DECREASE / 2;
-			}
+// The same step as simulateFloat() with nothing but integers, so it can't
+//  come out differently anywhere
+static void simulateFixed(local_game_t *l_game, game_state_t *state, input_t input)
+{
+	movePaddleFixed(state, paddleSpeedFixed(input), 1);
+
+	fixed_point_t last_ball_pos = state->fixed_ball_pos;
+	state->fixed_ball_pos.x += state->fixed_ball_direction.x;
+	state->fixed_ball_pos.y += state->fixed_ball_direction.y;
+
+	blockCollisionsFixed(l_game, state, last_ball_pos);
+
+	if (state->fixed_ball_pos.x <= 0) {
+		state->fixed_ball_pos.x = -state->fixed_ball_pos.x;
+		state->fixed_ball_direction.x = -state->fixed_ball_direction.x;
+	}
+	if (state->fixed_ball_pos.x + FIXED(BALL_SIZE) >= FIXED(SCREEN_WIDTH - 1)) {
+		state->fixed_ball_pos.x = FIXED(2 * (SCREEN_WIDTH - 1 - BALL_SIZE)) - state->fixed_ball_pos.x;
+		state->fixed_ball_direction.x = -state->fixed_ball_direction.x;
+	}
+	if (state->fixed_ball_pos.y <= 0) {
+		state->fixed_ball_pos.y = -state->fixed_ball_pos.y;
+		state->fixed_ball_direction.y = -state->fixed_ball_direction.y;
+	}
+
+	if (state->fixed_ball_pos.y + FIXED(BALL_SIZE) >= FIXED(SCREEN_HEIGHT - 1))
+		l_game->game_over = true;
+
+	fixed_point_t paddle = {state->fixed_player_x, FIXED(PADDLE_Y_POS)};
+	if (intersectsFixed(last_ball_pos, state->fixed_ball_pos, paddle, state->paddle_width, PADDLE_HEIGHT) == direction_down) {
+		if (strikeBallFixed(last_ball_pos, state->fixed_ball_direction, paddle, state->paddle_width, &state->fixed_ball_direction)) {
+			state->points_per_hit = POINTS_BASE;
 		}
+		nextLevel(l_game, state);
 	}
 
-	drawGame(l_game);
+	followFixed(state);
+}
+
+void simulateArkanoid(game_t *game, input_t input)
+{
+	assert(game);
+	local_game_t *l_game = (local_game_t*)game;
+	game_state_t *state = l_game->_internal_game_state;
+
+	if (l_game->fixed_point) {
+		simulateFixed(l_game, state, input);
+	}
+	else {
+		simulateFloat(l_game, state, input);
+	}
 
 	state->counter++;
 	if (l_game->max_rounds != -1 &&
 		state->counter > l_game->max_rounds) {
 		l_game->game_over = true;
 	}
+
+	l_game->screen_dirty = true;
+}
+
+// Steps the ball can fly from where it is without anything happening, at
+//  most <max_steps>.  That's while it's below the blocks, clear of the walls
+//  and above the paddle, where a step only moves it and the paddle.  Works
+//  on the float positions with a pixel to spare so it also holds for the
+//  float sums, which round on every step.
+static uint32_t freeSteps(local_game_t *l_game, game_state_t *state, uint32_t max_steps)
+{
+	const double margin = 1.0;
+	double x = state->ball_pos.x;
+	double y = state->ball_pos.y;
+	double dx = state->ball_direction.x;
+	double dy = state->ball_direction.y;
+	double steps = max_steps;
+
+	if (l_game->max_rounds != -1) {
+		// The step that ends the game has to be played
+		steps = min(steps, (double)l_game->max_rounds - state->counter);
+	}
+
+	double top = BLOCK_ROWS * BLOCK_HEIGHT + margin;
+	double bottom = PADDLE_Y_POS - BALL_SIZE - margin;
+	double left = margin;
+	double right = SCREEN_WIDTH - 1 - BALL_SIZE - margin;
+	if (y <= top || y >= bottom || x <= left || x >= right) {
+		return 0;
+	}
+
+	if (dy > 0) {
+		steps = min(steps, floor((bottom - y) / dy) - 1);
+	}
+	else if (dy < 0) {
+		steps = min(steps, floor((y - top) / -dy) - 1);
+	}
+	if (dx > 0) {
+		steps = min(steps, floor((right - x) / dx) - 1);
+	}
+	else if (dx < 0) {
+		steps = min(steps, floor((x - left) / -dx) - 1);
+	}
+
+	return steps > 0 ? (uint32_t)steps : 0;
+}
+
+// Play <steps> steps that freeSteps() found nothing happens in, the same as
+//  simulateArkanoid() would
+static void flyArkanoid(local_game_t *l_game, game_state_t *state, input_t input, uint32_t steps)
+{
+	uint32_t i;
+
+	if (l_game->fixed_point) {
+		movePaddleFixed(state, paddleSpeedFixed(input), steps);
+		state->fixed_ball_pos.x += state->fixed_ball_direction.x * (int32_t)steps;
+		state->fixed_ball_pos.y += state->fixed_ball_direction.y * (int32_t)steps;
+		followFixed(state);
+	}
+	else {
+		// Floats have to be added one step at a time to round the same way
+		for (i = 0; i < steps; i++) {
+			movePaddleFloat(state, input);
+			state->ball_pos.x += state->ball_direction.x;
+			state->ball_pos.y += state->ball_direction.y;
+		}
+	}
+
+	state->counter += steps;
+	l_game->screen_dirty = true;
+}
+
+uint32_t fastForwardArkanoid(game_t *game, input_t input, uint32_t max_steps, arkanoid_stop_t stop, void *data)
+{
+	assert(game);
+	local_game_t *l_game = (local_game_t*)game;
+	game_state_t *state = l_game->_internal_game_state;
+	uint32_t steps = 0;
+
+	while (steps < max_steps && !l_game->game_over) {
+		uint32_t free_steps = freeSteps(l_game, state, max_steps - steps);
+		if (free_steps > 0) {
+			flyArkanoid(l_game, state, input, free_steps);
+			steps += free_steps;
+			continue;
+		}
+
+		simulateArkanoid(game, input);
+		steps++;
+		if (stop != NULL && stop(game, data)) {
+			break;
+		}
+	}
+
+	return steps;
+}
+
+// Copy the parts of the state a player could use into the state sensor, see
+//  arkanoid_state_t for the layout
+static void fillStateSensor(local_game_t *game)
+{
+	game_state_t *state = (game_state_t*)game->_internal_game_state;
+	float *data = game->sensors[ARKANOID_SENSOR_STATE].data;
+	int i;
+
+	data[arkanoid_state_ball_x] = state->ball_pos.x / SCREEN_WIDTH;
+	data[arkanoid_state_ball_y] = state->ball_pos.y / SCREEN_HEIGHT;
+	data[arkanoid_state_ball_dx] = state->ball_direction.x / BALL_SPEED;
+	data[arkanoid_state_ball_dy] = state->ball_direction.y / BALL_SPEED;
+	data[arkanoid_state_paddle_x] = state->player_pos.x / SCREEN_WIDTH;
+	data[arkanoid_state_paddle_width] = state->paddle_width / (float)SCREEN_WIDTH;
+	for (i = 0; i < ARKANOID_NUM_BLOCKS; i++) {
+		data[arkanoid_state_blocks + i] = max(state->blocks[i].health, 0) / (float)BLOCK_HEALTH;
+	}
+}
+
+const sensor_t *getSensorArkanoid(game_t *game, uint32_t index)
+{
+	assert(game);
+	local_game_t *l_game = (local_game_t*)game;
+	assert(index < l_game->num_sensors);
+
+	// Only paint when someone actually looks
+	if (index == ARKANOID_SENSOR_SCREEN && l_game->screen_dirty) {
+		redrawArkanoid(game);
+	} else if (index == ARKANOID_SENSOR_STATE) {
+		fillStateSensor(l_game);
+	}
+
+	return &game->sensors[index];
+}
+
+// Everything a new game starts out with
+static void initState(game_state_t *state, unsigned int seed, bool fixed_point)
+{
+	state->counter = 0;
+	state->seed = seed;
+
+	// Set up player
+	state->player_pos.x = PADDLE_X_POS;
+	state->player_pos.y = PADDLE_Y_POS;
+	state->player_speed = 0;
+	state->paddle_width = PADDLE_MAX_WIDTH;
+	state->points_per_hit = POINTS_BASE;
+
+	// Set up ball
+	if (fixed_point) {
+		state->fixed_player_x = FIXED(PADDLE_X_POS);
+		serveBallFixed(&state->seed, &state->fixed_ball_pos, &state->fixed_ball_direction);
+		followFixed(state);
+	}
+	else {
+		state->fixed_player_x = 0;
+		state->fixed_ball_pos = (fixed_point_t) {0, 0};
+		state->fixed_ball_direction = (fixed_point_t) {0, 0};
+		arkanoidServeBall(&state->seed, &state->ball_pos, &state->ball_direction);
+	}
+
+	// Generate blocks
+	initBlocks(state);
+}
+
+static void snapshotArkanoid(game_t *game, void *snapshot)
+{
+	assert(game);
+	assert(snapshot);
+	local_game_t *l_game = (local_game_t*)game;
+	snapshot_t *s = snapshot;
+
+	// Clears the padding too, so equal states give byte for byte equal snapshots
+	memset(s, 0, sizeof(*s));
+	s->score = l_game->score;
+	s->game_over = l_game->game_over;
+	memcpy(&s->state, l_game->_internal_game_state, sizeof(game_state_t));
+}
+
+static void restoreArkanoid(game_t *game, const void *snapshot)
+{
+	assert(game);
+	assert(snapshot);
+	local_game_t *l_game = (local_game_t*)game;
+	const snapshot_t *s = snapshot;
+
+	l_game->score = s->score;
+	l_game->game_over = s->game_over;
+	memcpy(l_game->_internal_game_state, &s->state, sizeof(game_state_t));
+	// The painter still knows what the screen shows, so only the changes
+	//  are painted when it's next asked for
+	l_game->screen_dirty = true;
+}
+
+static game_t *cloneArkanoid(game_t *game)
+{
+	assert(game);
+	local_game_t *l_game = (local_game_t*)game;
+	arkanoid_options_t options = {
+		.flags = l_game->flags,
+		.full_redraw = l_game->full_redraw,
+		.sensor_scale = l_game->sensor_scale,
+		.sensor_type = l_game->sensors[ARKANOID_SENSOR_SCREEN].type,
+		.fixed_point = l_game->fixed_point
+	};
+	snapshot_t snapshot;
+
+	game_t *clone = createArkanoidWithOptions(l_game->max_rounds, 0, &options);
+	if (clone != NULL) {
+		snapshotArkanoid(game, &snapshot);
+		restoreArkanoid(clone, &snapshot);
+	}
+	return clone;
 }
 
 game_t *createArkanoid(int32_t max_rounds, unsigned int seed)
 {
+	return createArkanoidWithOptions(max_rounds, seed, NULL);
+}
+
+game_t *createArkanoidWithOptions(int32_t max_rounds, unsigned int seed, const arkanoid_options_t *options)
+{
+	static const arkanoid_options_t defaults = {0, };
 	local_game_t *tmp = malloc(sizeof(local_game_t));
 	game_state_t *state = NULL;
 	local_sensor_t *sensor = NULL;
+	float *state_data = NULL;
 	float *pixels = NULL;
+	uint8_t *pixels_u8 = NULL;
+	int32_t scale;
 
-	if (tmp == NULL) {
-		return NULL;
+	if (options == NULL) {
+		options = &defaults;
 	}
 
-	pixels = malloc(sizeof(float) * SCREEN_WIDTH * SCREEN_HEIGHT);
-	if (pixels == NULL) {
+	// The sensor has to cover the screen exactly
+	scale = options->sensor_scale > 1 ? options->sensor_scale : 1;
+	if (SCREEN_WIDTH % scale != 0 || SCREEN_HEIGHT % scale != 0) {
 		free(tmp);
 		return NULL;
 	}
 
+	if (tmp == NULL) {
+		return NULL;
+	}
+
+	if (!(options->flags & GAME_FLAG_NO_RENDER)) {
+		size_t num_pixels = (SCREEN_WIDTH / scale) * (SCREEN_HEIGHT / scale);
+		if (options->sensor_type == sensor_type_uint8) {
+			pixels_u8 = malloc(num_pixels);
+		} else {
+			pixels = malloc(sizeof(float) * num_pixels);
+		}
+		if (pixels == NULL && pixels_u8 == NULL) {
+			free(tmp);
+			return NULL;
+		}
+	}
+
 	state = malloc(sizeof(game_state_t));
 	if (state == NULL) {
 		free(pixels);
+		free(pixels_u8);
 		free(tmp);
 		return NULL;
 	}
 
-	sensor = malloc(sizeof(local_sensor_t));
-	if (sensor == NULL) {
+	sensor = malloc(sizeof(local_sensor_t) * ARKANOID_NUM_SENSORS);
+	state_data = malloc(sizeof(float) * ARKANOID_STATE_SIZE);
+	if (sensor == NULL || state_data == NULL) {
 		free(pixels);
+		free(pixels_u8);
 		free(tmp);
 		free(state);
+		free(sensor);
+		free(state_data);
 		return NULL;
 	}
 
+	tmp->num_sensors = ARKANOID_NUM_SENSORS;
 	tmp->sensors = sensor;
-	tmp->sensors[0].name = SENSOR_SCREEN;
-	tmp->sensors[0].width = SCREEN_WIDTH;
-	tmp->sensors[0].height = SCREEN_HEIGHT;
-	tmp->sensors[0].depth = 1;
-	tmp->sensors[0].data = pixels;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].name = SENSOR_SCREEN;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].width = SCREEN_WIDTH / scale;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].height = SCREEN_HEIGHT / scale;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].depth = 1;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].type = options->sensor_type;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].scale = options->sensor_type == sensor_type_uint8 ? 1.0f / U8_STEPS : 1.0f;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].data = pixels;
+	tmp->sensors[ARKANOID_SENSOR_SCREEN].data_u8 = pixels_u8;
+	tmp->sensors[ARKANOID_SENSOR_STATE].name = SENSOR_STATE;
+	tmp->sensors[ARKANOID_SENSOR_STATE].width = ARKANOID_STATE_SIZE;
+	tmp->sensors[ARKANOID_SENSOR_STATE].height = 1;
+	tmp->sensors[ARKANOID_SENSOR_STATE].depth = 1;
+	tmp->sensors[ARKANOID_SENSOR_STATE].type = sensor_type_float;
+	tmp->sensors[ARKANOID_SENSOR_STATE].scale = 1.0f;
+	tmp->sensors[ARKANOID_SENSOR_STATE].data = state_data;
+	tmp->sensors[ARKANOID_SENSOR_STATE].data_u8 = NULL;
 	tmp->score = 0;
 	tmp->game_over = false;
-	tmp->_update = updateArkanoid;
+	tmp->flags = options->flags;
+	tmp->_update = simulateArkanoid;
+	tmp->_get_sensor = getSensorArkanoid;
+	tmp->_snapshot = snapshotArkanoid;
+	tmp->_restore = restoreArkanoid;
+	tmp->game_interface = &arkanoidInterface;
+	tmp->snapshot_size = sizeof(snapshot_t);
 	tmp->_internal_game_state = state;
 	tmp->max_rounds = max_rounds;
+	// Nothing is painted until the screen is asked for
+	tmp->screen_dirty = true;
+	tmp->screen_valid = false;
+	tmp->full_redraw = options->full_redraw;
+	tmp->sensor_scale = scale;
+	tmp->fixed_point = options->fixed_point;
 
-	state->counter = 0;
-	state->seed = seed;
+	initState(state, seed, tmp->fixed_point);
 
-	// Set up player
-	state->player_pos.x = PADDLE_X_POS;
-	state->player_pos.y = PADDLE_Y_POS;
-	state->player_speed = 0;
-	state->paddle_width = PADDLE_MAX_WIDTH;
-	state->points_per_hit = POINTS_BASE;
-
-	// Set up ball
-	state->ball_pos.x = rand_r( &(state->seed) ) % (SCREEN_WIDTH - PADDLE_MAX_WIDTH);
-	state->ball_pos.y = BALL_START_Y;
-	float startAngle = BALL_MIN_ANGLE + (rand_r( &(state->seed) ) / (float)RAND_MAX) * (BALL_MAX_ANGLE - BALL_MIN_ANGLE);
-	state->ball_direction.x = (float)cos(startAngle) * BALL_SPEED;
-	state->ball_direction.y = (float)-sin(startAngle) * BALL_SPEED;
+	return (game_t*)tmp;
+}
 
-	// Generate blocks
-	state->num_blocks = BLOCK_ROWS * BLOCK_COLS;
-	state->blocks = malloc(sizeof(block_t) * state->num_blocks);
+void resetArkanoid(game_t *game, unsigned int seed)
+{
+	assert(game);
+	local_game_t *l_game = (local_game_t*)game;
 
-	initBlocks(state);
+	l_game->score = 0;
+	l_game->game_over = false;
+	initState(l_game->_internal_game_state, seed, l_game->fixed_point);
+	// Like a restore, the painter still knows what the screen shows
+	l_game->screen_dirty = true;
+}
 
-	// Set the first pixel state
-	drawGame(tmp);
+void redrawArkanoid(game_t *game)
+{
+	local_game_t *l_game = (local_game_t*)game;
 
-	return (game_t*)tmp;
+	if (!(l_game->flags & GAME_FLAG_NO_RENDER)) {
+		drawChanges(l_game);
+	}
+	l_game->screen_dirty = false;
 }
 
 void destroyArkanoid(game_t *game)
@@ -477,17 +1330,39 @@ void destroyArkanoid(game_t *game)
 		local_game_t *l_game = (local_game_t*)game;
 
 		if (l_game->_internal_game_state) {
-			game_state_t *state = l_game->_internal_game_state;
-			if (state->blocks)
-				free(state->blocks);
-
 			free(l_game->_internal_game_state);
 		}
 		if (l_game->sensors) {
 			if (l_game->sensors[0].data)
 				free(l_game->sensors[0].data);
+			if (l_game->sensors[0].data_u8)
+				free(l_game->sensors[0].data_u8);
+			free(l_game->sensors[ARKANOID_SENSOR_STATE].data);
 			free(l_game->sensors);
 		}
 		free(game);
 	}
 }
+
+static game_t *createArkanoidFromOptions(int32_t max_rounds, unsigned int seed, const void *options)
+{
+	return createArkanoidWithOptions(max_rounds, seed, options);
+}
+
+static uint32_t stepArkanoid(game_t *game, input_t input, uint32_t repeat)
+{
+	return fastForwardArkanoid(game, input, repeat, NULL, NULL);
+}
+
+// Batches go one game at a time through gameStepBatch(), the batched engine
+//  in arkanoidBatch.c keeps games of its own
+const game_interface_t arkanoidInterface = {
+	.name = "arkanoid",
+	.capabilities = GAME_CAP_RESET | GAME_CAP_SNAPSHOT | GAME_CAP_STEP,
+	.create = createArkanoidFromOptions,
+	.destroy = destroyArkanoid,
+	.reset = resetArkanoid,
+	.clone = cloneArkanoid,
+	.step = stepArkanoid,
+	.step_batch = NULL
+};
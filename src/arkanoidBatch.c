@@ -0,0 +1,423 @@
+#include "arkanoid_batch.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include "arkanoid_internal.h"
+
+#define ALL_BLOCKS ((UINT64_C(1) << ARKANOID_NUM_BLOCKS) - 1)
+
+// Mirrors arkanoid_batch_t, the physics follow simulateArkanoid() expression
+//  for expression so the floats come out the same
+typedef struct local_batch_s {
+	uint32_t num_games;
+	uint32_t num_running;
+	int32_t *scores;
+	bool *game_over;
+
+	// Local stuff here, one of each per game.  Flags are bytes rather than
+	//  bools, GCC won't vectorise loops mixing bools and floats.
+	int32_t max_rounds;
+	uint8_t *over;
+	int32_t *counter;
+	float *paddle_x;
+	uint32_t *paddle_width;
+	float *ball_x;
+	float *ball_y;
+	float *ball_dx;
+	float *ball_dy;
+	int32_t *points_per_hit;
+
+	// Bit b is set while block b is standing
+	uint64_t *alive;
+	// ARKANOID_NUM_BLOCKS per game, game after game
+	int8_t *health;
+
+	// Where the ball was before this step and which games were running
+	//  when it started
+	float *last_x;
+	float *last_y;
+	uint8_t *active;
+	// Games where the ball came down on the paddle this step
+	uint8_t *struck;
+} local_batch_t;
+
+static void resetBlocks(local_batch_t *batch, uint32_t game)
+{
+	memset(&batch->health[game * ARKANOID_NUM_BLOCKS], BLOCK_HEALTH, ARKANOID_NUM_BLOCKS);
+	batch->alive[game] = ALL_BLOCKS;
+}
+
+arkanoid_batch_t *createArkanoidBatch(uint32_t num_games, int32_t max_rounds, const unsigned int *seeds)
+{
+	local_batch_t *tmp = calloc(1, sizeof(local_batch_t));
+	uint32_t g;
+
+	assert(seeds);
+	if (tmp == NULL) {
+		return NULL;
+	}
+
+	tmp->num_games = num_games;
+	tmp->max_rounds = max_rounds;
+	tmp->scores = calloc(num_games, sizeof(int32_t));
+	tmp->game_over = calloc(num_games, sizeof(bool));
+	tmp->over = calloc(num_games, sizeof(uint8_t));
+	tmp->counter = calloc(num_games, sizeof(int32_t));
+	tmp->paddle_x = calloc(num_games, sizeof(float));
+	tmp->paddle_width = calloc(num_games, sizeof(uint32_t));
+	tmp->ball_x = calloc(num_games, sizeof(float));
+	tmp->ball_y = calloc(num_games, sizeof(float));
+	tmp->ball_dx = calloc(num_games, sizeof(float));
+	tmp->ball_dy = calloc(num_games, sizeof(float));
+	tmp->points_per_hit = calloc(num_games, sizeof(int32_t));
+	tmp->alive = calloc(num_games, sizeof(uint64_t));
+	tmp->health = calloc(num_games, ARKANOID_NUM_BLOCKS);
+	tmp->last_x = calloc(num_games, sizeof(float));
+	tmp->last_y = calloc(num_games, sizeof(float));
+	tmp->active = calloc(num_games, sizeof(uint8_t));
+	tmp->struck = calloc(num_games, sizeof(uint8_t));
+	if (tmp->scores == NULL || tmp->game_over == NULL || tmp->over == NULL || tmp->counter == NULL ||
+		tmp->paddle_x == NULL || tmp->paddle_width == NULL ||
+		tmp->ball_x == NULL || tmp->ball_y == NULL ||
+		tmp->ball_dx == NULL || tmp->ball_dy == NULL ||
+		tmp->points_per_hit == NULL || tmp->alive == NULL || tmp->health == NULL ||
+		tmp->last_x == NULL || tmp->last_y == NULL ||
+		tmp->active == NULL || tmp->struck == NULL) {
+		destroyArkanoidBatch((arkanoid_batch_t*)tmp);
+		return NULL;
+	}
+
+	for (g = 0; g < num_games; g++) {
+		unsigned int seed = seeds[g];
+		point_t pos, direction;
+
+		tmp->paddle_x[g] = PADDLE_X_POS;
+		tmp->paddle_width[g] = PADDLE_MAX_WIDTH;
+		tmp->points_per_hit[g] = POINTS_BASE;
+
+		arkanoidServeBall(&seed, &pos, &direction);
+		tmp->ball_x[g] = pos.x;
+		tmp->ball_y[g] = pos.y;
+		tmp->ball_dx[g] = direction.x;
+		tmp->ball_dy[g] = direction.y;
+
+		resetBlocks(tmp, g);
+	}
+	tmp->num_running = num_games;
+
+	return (arkanoid_batch_t*)tmp;
+}
+
+void destroyArkanoidBatch(arkanoid_batch_t *batch)
+{
+	if (batch) {
+		local_batch_t *l_batch = (local_batch_t*)batch;
+
+		free(l_batch->scores);
+		free(l_batch->game_over);
+		free(l_batch->over);
+		free(l_batch->counter);
+		free(l_batch->paddle_x);
+		free(l_batch->paddle_width);
+		free(l_batch->ball_x);
+		free(l_batch->ball_y);
+		free(l_batch->ball_dx);
+		free(l_batch->ball_dy);
+		free(l_batch->points_per_hit);
+		free(l_batch->alive);
+		free(l_batch->health);
+		free(l_batch->last_x);
+		free(l_batch->last_y);
+		free(l_batch->active);
+		free(l_batch->struck);
+		free(l_batch);
+	}
+}
+
+// Move the paddles and balls.  Games that are over keep their values, which
+//  is done with selects rather than branches so the loop can be vectorised.
+//  None of the arrays overlap, GCC has to be told so with ivdep as it doesn't
+//  trust restrict on locals.
+static void moveAll(local_batch_t *batch, const input_t *inputs)
+{
+	float *paddle_x = batch->paddle_x;
+	const uint32_t *paddle_width = batch->paddle_width;
+	float *ball_x = batch->ball_x;
+	float *ball_y = batch->ball_y;
+	const float *ball_dx = batch->ball_dx;
+	const float *ball_dy = batch->ball_dy;
+	float *last_x = batch->last_x;
+	float *last_y = batch->last_y;
+	const uint8_t *over = batch->over;
+	uint8_t *active = batch->active;
+	uint32_t num_games = batch->num_games;
+	uint32_t g;
+
+#pragma GCC ivdep
+	for (g = 0; g < num_games; g++) {
+		float right = min(max(inputs[g].right, 0.0f), 1.0f);
+		float left = min(max(inputs[g].left, 0.0f), 1.0f);
+		float x = paddle_x[g];
+		float limit = (float)(SCREEN_WIDTH - (int32_t)paddle_width[g]);
+		float last = (float)SCREEN_WIDTH - (int32_t)paddle_width[g] - 1;
+		float bx = ball_x[g];
+		float by = ball_y[g];
+		float next_x = bx + ball_dx[g];
+		float next_y = by + ball_dy[g];
+
+		x += right * PADDLE_MAX_SPEED;
+		x -= left * PADDLE_MAX_SPEED;
+		x = x < 0 ? 0 : x;
+		x = x >= limit ? last : x;
+
+		active[g] = over[g] ^ 1;
+		last_x[g] = bx;
+		last_y[g] = by;
+		paddle_x[g] = over[g] ? paddle_x[g] : x;
+		ball_x[g] = over[g] ? bx : next_x;
+		ball_y[g] = over[g] ? by : next_y;
+	}
+}
+
+// Find the blocks the ball of <game> runs into, bounce and damage them.  The
+//  tests are the same as intersects(), but as the blocks sit in a grid they
+//  only have to be made once per row and column.  Only the rare hits are
+//  handled one by one.  Which order they're handled in doesn't matter, the
+//  bounces flip the direction back and forth and every hit adds one more
+//  point per hit.
+static void collideBlocks(local_batch_t *batch, uint32_t game)
+{
+	float last_y = batch->last_y[game];
+	float next_x = batch->ball_x[game];
+	float next_y = batch->ball_y[game];
+	bool going_up = (int)(last_y - next_y) > 0;
+	uint64_t columns = 0, vertical = 0, sideways = 0;
+	int row, col, b;
+
+	for (col = 0; col < BLOCK_COLS; col++) {
+		float left = (float)col * BLOCK_WIDTH;
+		uint64_t within_width = (next_x < left + BLOCK_WIDTH) & (next_x + BALL_SIZE >= left);
+		columns |= within_width << col;
+	}
+
+	for (row = 0; row < BLOCK_ROWS; row++) {
+		float top = (float)row * BLOCK_HEIGHT;
+		uint64_t from_below = (last_y >= top + BLOCK_HEIGHT) & (next_y <= top + BLOCK_HEIGHT);
+		uint64_t from_above = (last_y + BALL_SIZE <= top) & (next_y + BALL_SIZE >= top);
+		uint64_t overlaps = (next_y + BALL_SIZE >= top) & (next_y < top + BLOCK_HEIGHT);
+		uint64_t through_edge = going_up ? from_below : from_above;
+
+		vertical |= (columns & -through_edge) << (row * BLOCK_COLS);
+		sideways |= (columns & -(overlaps & (through_edge ^ 1))) << (row * BLOCK_COLS);
+	}
+
+	uint64_t hits = (vertical | sideways) & batch->alive[game];
+	while (hits) {
+		b = __builtin_ctzll(hits);
+		hits &= hits - 1;
+
+		int8_t *health = &batch->health[game * ARKANOID_NUM_BLOCKS + b];
+		*health -= BLOCK_DAMAGE;
+		batch->scores[game] += batch->points_per_hit[game];
+		batch->points_per_hit[game] += POINTS_INCREASE;
+
+		if (*health > 0) {
+			if (vertical & (UINT64_C(1) << b)) {
+				batch->ball_dy[game] = -batch->ball_dy[game];
+			} else {
+				batch->ball_dx[game] = -batch->ball_dx[game];
+			}
+		} else {
+			batch->alive[game] &= ~(UINT64_C(1) << b);
+		}
+	}
+}
+
+// Bounce on the walls, die at the bottom, look for the paddle and count the
+//  step, again with selects only
+static void finishAll(local_batch_t *batch)
+{
+	float *ball_x = batch->ball_x;
+	float *ball_y = batch->ball_y;
+	float *ball_dx = batch->ball_dx;
+	float *ball_dy = batch->ball_dy;
+	const float *last_y = batch->last_y;
+	const float *paddle_x = batch->paddle_x;
+	const uint32_t *paddle_width = batch->paddle_width;
+	int32_t *counter = batch->counter;
+	const uint8_t *active = batch->active;
+	uint8_t *struck = batch->struck;
+	uint8_t *over = batch->over;
+	int32_t max_rounds = batch->max_rounds;
+	uint32_t num_games = batch->num_games;
+	uint32_t g;
+
+#pragma GCC ivdep
+	for (g = 0; g < num_games; g++) {
+		float x = ball_x[g];
+		float y = ball_y[g];
+		float dx = ball_dx[g];
+		float dy = ball_dy[g];
+		uint8_t left_wall = x <= 0;
+		x = left_wall ? -x : x;
+		dx = left_wall ? -dx : dx;
+		uint8_t right_wall = x + BALL_SIZE >= SCREEN_WIDTH - 1;
+		float bounced_x = 2 * (SCREEN_WIDTH - 1 - BALL_SIZE) - x;
+		x = right_wall ? bounced_x : x;
+		dx = right_wall ? -dx : dx;
+		uint8_t top_wall = y <= 0;
+		y = top_wall ? -y : y;
+		dy = top_wall ? -dy : dy;
+
+		uint8_t died = y + BALL_SIZE >= SCREEN_HEIGHT - 1;
+
+		// The paddle only counts when it's hit from above, see intersects()
+		float paddle_y = PADDLE_Y_POS;
+		float paddle_right = paddle_x[g] + (float)(int32_t)paddle_width[g];
+		uint8_t hit_paddle = ((int)(last_y[g] - y) <= 0) &
+			(last_y[g] + BALL_SIZE <= paddle_y) & (y + BALL_SIZE >= paddle_y) &
+			(x < paddle_right) & (x + BALL_SIZE >= paddle_x[g]);
+
+		int32_t count = counter[g] + 1;
+		uint8_t out_of_rounds = (max_rounds != -1) & (count > max_rounds);
+
+		ball_x[g] = active[g] ? x : ball_x[g];
+		ball_y[g] = active[g] ? y : ball_y[g];
+		ball_dx[g] = active[g] ? dx : ball_dx[g];
+		ball_dy[g] = active[g] ? dy : ball_dy[g];
+		struck[g] = active[g] & hit_paddle;
+		counter[g] = active[g] ? count : counter[g];
+		over[g] |= active[g] & (died | out_of_rounds);
+	}
+}
+
+// The ball came down on the paddle of <game>
+static void strikePaddle(local_batch_t *batch, uint32_t game)
+{
+	point_t ball = {batch->last_x[game], batch->last_y[game]};
+	point_t direction = {batch->ball_dx[game], batch->ball_dy[game]};
+	point_t paddle = {batch->paddle_x[game], PADDLE_Y_POS};
+
+	if (arkanoidStrikeBall(ball, direction, paddle, batch->paddle_width[game], &direction)) {
+		batch->ball_dx[game] = direction.x;
+		batch->ball_dy[game] = direction.y;
+		batch->points_per_hit[game] = POINTS_BASE;
+	}
+
+	// Reset blocks and increase difficulty
+	if (batch->alive[game] == 0) {
+		resetBlocks(batch, game);
+		if (batch->paddle_width[game] > PADDLE_MIN_WIDTH) {
+			batch->paddle_width[game] -= PADDLE_WIDTH_DECREASE;
+			batch->paddle_x[game] += PADDLE_WIDTH_DECREASE / 2;
+		}
+	}
+}
+
+void simulateArkanoidBatch(arkanoid_batch_t *batch, const input_t *inputs)
+{
+	assert(batch);
+	assert(inputs);
+	local_batch_t *l_batch = (local_batch_t*)batch;
+	uint32_t g;
+
+	moveAll(l_batch, inputs);
+
+	for (g = 0; g < l_batch->num_games; g++) {
+		if (l_batch->active[g] && l_batch->alive[g]) {
+			collideBlocks(l_batch, g);
+		}
+	}
+
+	finishAll(l_batch);
+
+	l_batch->num_running = 0;
+	for (g = 0; g < l_batch->num_games; g++) {
+		if (l_batch->struck[g]) {
+			strikePaddle(l_batch, g);
+		}
+		l_batch->game_over[g] = l_batch->over[g];
+		l_batch->num_running += !l_batch->over[g];
+	}
+}
+
+static void fillRows(float *pixels, size_t row_stride, int32_t left, int32_t top, int32_t right, int32_t bottom, float value)
+{
+	int32_t x, y;
+	for (y = top; y < bottom; y++) {
+		for (x = left; x < right; x++) {
+			pixels[y * row_stride + x] = value;
+		}
+	}
+}
+
+void drawArkanoidBatch(arkanoid_batch_t *batch, uint32_t game, float *pixels, size_t row_stride)
+{
+	assert(batch);
+	assert(game < batch->num_games);
+	local_batch_t *l_batch = (local_batch_t*)batch;
+	int32_t y;
+	int b;
+
+	for (y = 0; y < SCREEN_HEIGHT; y++) {
+		memset(&pixels[y * row_stride], 0, sizeof(float) * SCREEN_WIDTH);
+	}
+
+	for (b = 0; b < ARKANOID_NUM_BLOCKS; b++) {
+		int health = l_batch->health[game * ARKANOID_NUM_BLOCKS + b];
+		if (health > 0) {
+			int32_t top = (b / BLOCK_COLS) * BLOCK_HEIGHT;
+			int32_t left = (b % BLOCK_COLS) * BLOCK_WIDTH;
+			fillRows(pixels, row_stride,
+				left + BLOCK_MARGIN, top + BLOCK_MARGIN,
+				left + BLOCK_WIDTH - BLOCK_MARGIN, top + BLOCK_HEIGHT - BLOCK_MARGIN,
+				(float)(health / (float)BLOCK_HEALTH));
+		}
+	}
+
+	int32_t paddle_left = (int)l_batch->paddle_x[game];
+	fillRows(pixels, row_stride,
+		paddle_left, PADDLE_Y_POS,
+		paddle_left + (int32_t)l_batch->paddle_width[game], PADDLE_Y_POS + PADDLE_HEIGHT, 0.75);
+
+	int32_t ball_left = (int)l_batch->ball_x[game];
+	int32_t ball_top = (int)l_batch->ball_y[game];
+	fillRows(pixels, row_stride,
+		ball_left, ball_top,
+		min(ball_left + BALL_SIZE, SCREEN_WIDTH), min(ball_top + BALL_SIZE, SCREEN_HEIGHT), 0.5);
+}
+
+void drawArkanoidBatchAll(arkanoid_batch_t *batch, float *pixels, size_t game_stride, size_t row_stride)
+{
+	assert(batch);
+	uint32_t g;
+
+	for (g = 0; g < batch->num_games; g++) {
+		drawArkanoidBatch(batch, g, &pixels[g * game_stride], row_stride);
+	}
+}
+
+void getArkanoidBatchState(arkanoid_batch_t *batch, uint32_t game, float *state)
+{
+	assert(batch);
+	assert(game < batch->num_games);
+	local_batch_t *l_batch = (local_batch_t*)batch;
+	int b;
+
+	state[arkanoid_state_ball_x] = l_batch->ball_x[game] / SCREEN_WIDTH;
+	state[arkanoid_state_ball_y] = l_batch->ball_y[game] / SCREEN_HEIGHT;
+	state[arkanoid_state_ball_dx] = l_batch->ball_dx[game] / BALL_SPEED;
+	state[arkanoid_state_ball_dy] = l_batch->ball_dy[game] / BALL_SPEED;
+	state[arkanoid_state_paddle_x] = l_batch->paddle_x[game] / SCREEN_WIDTH;
+	state[arkanoid_state_paddle_width] = l_batch->paddle_width[game] / (float)SCREEN_WIDTH;
+	for (b = 0; b < ARKANOID_NUM_BLOCKS; b++) {
+		int health = l_batch->health[game * ARKANOID_NUM_BLOCKS + b];
+		state[arkanoid_state_blocks + b] = max(health, 0) / (float)BLOCK_HEALTH;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef ARKANOID_INTERNAL_H
+#define ARKANOID_INTERNAL_H
+
+// Shared by the game in arkanoid.c and the batched engine in arkanoidBatch.c,
+//  which have to play exactly the same games.  Not for players.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "arkanoid.h"
+#include "geometry.h"
+
+#define SQRT_2_HALF 0.70710678118
+
+#define SCREEN_WIDTH ARKANOID_SCREEN_WIDTH
+#define SCREEN_HEIGHT ARKANOID_SCREEN_HEIGHT
+
+#define BLOCK_ROWS 5
+#define BLOCK_COLS 10
+#if BLOCK_ROWS * BLOCK_COLS != ARKANOID_NUM_BLOCKS
+#  error "The state sensor layout in arkanoid.h doesn't match the block grid"
+#endif
+// Try to make this divide exactly or it'll be weird
+#define BLOCK_WIDTH (SCREEN_WIDTH / BLOCK_COLS)
+#define BLOCK_HEIGHT 15
+// Purely cosmetic
+#define BLOCK_MARGIN 1
+#define BLOCK_HEALTH 100
+#define BLOCK_DAMAGE 20
+
+#define PADDLE_MAX_WIDTH 80
+#define PADDLE_MIN_WIDTH 10
+#define PADDLE_WIDTH_DECREASE 2
+#define PADDLE_HEIGHT 10
+#define PADDLE_Y_POS (SCREEN_HEIGHT - 2 * PADDLE_HEIGHT)
+#define PADDLE_X_POS ((SCREEN_WIDTH - PADDLE_MAX_WIDTH) / 2)
+#define PADDLE_MAX_SPEED 15
+
+#define BALL_SIZE 10
+#define BALL_SPEED 5
+#define BALL_START_X ((SCREEN_WIDTH - BALL_SIZE) / 2)
+#define BALL_START_Y (PADDLE_Y_POS - BALL_SIZE)
+#define BALL_MIN_ANGLE (M_PI/3.0)
+#define BALL_MAX_ANGLE (2.0*M_PI/3.0)
+
+// Number of points per struck block initially
+#define POINTS_BASE 10
+// How much the number of points increase with every strike before being
+//  reset by hitting the paddle
+#define POINTS_INCREASE 1
+
+// Put the ball in its starting position with a random direction drawn from
+//  <seed>
+void arkanoidServeBall(unsigned int *seed, point_t *pos, point_t *direction);
+
+// Work out where the ball goes when it moved from <ball> in <direction> and
+//  came down on the paddle at <paddle>.  Returns false, leaving
+//  <new_direction> alone, if it misses the top of the paddle.
+bool arkanoidStrikeBall(point_t ball, point_t direction, point_t paddle, uint32_t width, point_t *new_direction);
+
+#endif // ARKANOID_INTERNAL_H
@@ -0,0 +1,517 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "game.h"
+#include "arkanoid.h"
+#include "arkanoid_batch.h"
+#include "perfcounters.h"
+
+// Games are capped so the tracking policy doesn't play a single game forever
+#define MAX_ROUNDS 10000
+
+// Pixel values used by the Arkanoid painter, blocks use health / 100 which
+//  never ends up on either of these
+#define BALL_VALUE 0.5
+#define PADDLE_VALUE 0.75
+
+// The ball is ten pixels wide, so sampling every eighth pixel always hits it
+#define SCAN_STRIDE 8
+
+// Games stepped together by the batch policy, a new batch is started once
+//  less than half of them are still running
+#define BATCH_GAMES 64
+
+// Steps the fast forward policy holds every random input for
+#define FAST_FORWARD_STEPS 16
+
+typedef enum policy_e {
+  policy_idle,
+  policy_random,
+  policy_tracking,
+  // Random input on a game created with GAME_FLAG_NO_RENDER
+  policy_headless,
+  // The same with fixed point physics
+  policy_fixed,
+  // Random input held for FAST_FORWARD_STEPS steps by fastForwardArkanoid()
+  //  on a headless game
+  policy_fast_forward,
+  // Random input on BATCH_GAMES games stepped by simulateArkanoidBatch()
+  policy_batch,
+  policy_create,
+  // One game started over with resetArkanoid() instead
+  policy_reset
+} policy_t;
+
+static const char *policyNames[] = {"idle", "random", "tracking", "headless", "fixed", "fastforward", "batch", "create", "reset"};
+
+typedef struct bench_thread_s {
+  pthread_t     thread;
+  policy_t      policy;
+  double        minTime;
+  unsigned int  seed;
+  bool          failed;
+
+  // Results
+  uint64_t      steps;
+  uint64_t      games;
+  uint64_t      pixels;
+  double        simTime;
+  double        drawTime;
+  double        createTime;
+  double        destroyTime;
+  perf_values_t simCounters;
+  perf_values_t drawCounters;
+} bench_thread_t;
+
+static const struct option *getOptlist()
+{
+  static struct option optlist[] = {
+    {"min-time", required_argument, NULL, 't'},
+    {"threads",  required_argument, NULL, 'j'},
+    {"filter",   required_argument, NULL, 'f'},
+    {"counters", no_argument,       NULL, 'c'},
+
+    {"help",     no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  return optlist;
+}
+
+static void usage( char *progname )
+{
+  printf( "Usage: %s [OPTION]...\n", progname );
+  printf( "Measure how many Arkanoid steps per second can be simulated and drawn\n"
+	  "with different input policies and thread counts, and print the results\n"
+	  "as JSON.\n\n" );
+  printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
+  printf( "  -t, --min-time=FLOAT       seconds to run each case for, defaults to 0.5\n" );
+  printf( "  -j, --threads=INT          highest number of threads to run, defaults to\n"
+	  "                             the number of online cores\n" );
+  printf( "  -f, --filter=STRING        only run policies whose name contains STRING,\n"
+	  "                             idle, random, tracking, headless, fixed,\n"
+	  "                             fastforward, batch, create or reset\n" );
+  printf( "  -c, --counters             add hardware performance counters per step for\n"
+	  "                             the simulation and drawing\n" );
+
+  printf( "  -h, --help                 display this message and exit\n" );
+}
+
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void addCounters( perf_values_t *total, const perf_values_t *start, const perf_values_t *end )
+{
+  int i;
+  for( i = 0; i < perf_counter_count; i++ ) {
+    total->value[i] += end->value[i] - start->value[i];
+  }
+}
+
+// Print the available counters divided by <count> as a JSON object
+static void printCounters( const char *name, const perf_values_t *values, double count )
+{
+  bool first = true;
+  int i;
+
+  printf( ", \"%s\": {", name );
+  for( i = 0; i < perf_counter_count; i++ ) {
+    if( perfCountersAvailable( i ) ) {
+      printf( "%s\"%s\": %.1f", first ? "" : ", ", perfCounterName( i ), values->value[i] / count );
+      first = false;
+    }
+  }
+  if( perfCountersAvailable( perf_cycles ) && perfCountersAvailable( perf_instructions ) &&
+      values->value[perf_cycles] > 0 ) {
+    printf( ", \"ipc\": %.3f", (double)values->value[perf_instructions] / values->value[perf_cycles] );
+  }
+  printf( "}" );
+}
+
+// Move the paddle towards the ball, both found by scanning the screen the same
+//  way a network would have to.
+static input_t trackBall( game_t *game, input_t last )
+{
+  const sensor_t *screen = gameGetSensor( game, 0 );
+  uint32_t x, y;
+  int64_t ballX = -1;
+  int64_t paddleLeft = -1, paddleRight = -1;
+
+  for( y = 0; y < screen->height && ballX < 0; y += SCAN_STRIDE ) {
+    for( x = 0; x < screen->width; x += SCAN_STRIDE ) {
+      if( screen->data[y * screen->width + x] == BALL_VALUE ) {
+	ballX = x;
+	break;
+      }
+    }
+  }
+
+  // The paddle is ten pixels high and twenty pixels above the bottom
+  y = screen->height - 15;
+  for( x = 0; x < screen->width; x++ ) {
+    if( screen->data[y * screen->width + x] == PADDLE_VALUE ) {
+      if( paddleLeft < 0 ) {
+	paddleLeft = x;
+      }
+      paddleRight = x;
+    }
+  }
+
+  if( ballX < 0 || paddleLeft < 0 ) {
+    return last;
+  }
+
+  input_t input = {0, };
+  int64_t paddleMiddle = (paddleLeft + paddleRight) / 2;
+  if( ballX < paddleMiddle - SCAN_STRIDE ) {
+    input.left = 1.0;
+  } else if( ballX > paddleMiddle + SCAN_STRIDE ) {
+    input.right = 1.0;
+  }
+
+  return input;
+}
+
+static void runCreate( bench_thread_t *bt )
+{
+  double start = now();
+  do {
+    double t0 = now();
+    game_t *game = createArkanoid( MAX_ROUNDS, rand_r( &bt->seed ) );
+    double t1 = now();
+    if( game == NULL ) {
+      bt->failed = true;
+      return;
+    }
+    destroyArkanoid( game );
+    double t2 = now();
+
+    bt->createTime += t1 - t0;
+    bt->destroyTime += t2 - t1;
+    bt->games++;
+  } while( now() - start < bt->minTime );
+}
+
+static void runReset( bench_thread_t *bt )
+{
+  game_t *game = createArkanoid( MAX_ROUNDS, rand_r( &bt->seed ) );
+  if( game == NULL ) {
+    bt->failed = true;
+    return;
+  }
+
+  double start = now();
+  do {
+    double t0 = now();
+    resetArkanoid( game, rand_r( &bt->seed ) );
+    bt->createTime += now() - t0;
+    bt->games++;
+  } while( now() - start < bt->minTime );
+
+  destroyArkanoid( game );
+}
+
+// Time simulating and painting the screen separately
+static void runSteps( bench_thread_t *bt )
+{
+  const sensor_t *screen;
+  game_t *game = NULL;
+  input_t input = {0, };
+  arkanoid_options_t options = {0, };
+  double start = now();
+
+  if( bt->policy == policy_headless || bt->policy == policy_fixed ||
+      bt->policy == policy_fast_forward ) {
+    options.flags = GAME_FLAG_NO_RENDER;
+  }
+  options.fixed_point = bt->policy == policy_fixed;
+
+  do {
+    if( game == NULL || game->game_over ) {
+      destroyArkanoid( game );
+      game = createArkanoidWithOptions( MAX_ROUNDS, rand_r( &bt->seed ), &options );
+      if( game == NULL ) {
+	bt->failed = true;
+	return;
+      }
+      screen = &game->sensors[0];
+      bt->games++;
+    }
+
+    switch( bt->policy ) {
+    case policy_random:
+    case policy_headless:
+    case policy_fixed:
+    case policy_fast_forward:
+      input.left = rand_r( &bt->seed ) / (float)RAND_MAX;
+      input.right = rand_r( &bt->seed ) / (float)RAND_MAX;
+      break;
+    case policy_tracking:
+      input = trackBall( game, input );
+      break;
+    default:
+      break;
+    }
+
+    // The counters are read outside of the timed regions, reading them
+    //  doesn't cost anything when they're disabled
+    perf_values_t c0, c1, c2;
+    uint32_t played = 1;
+    perfCountersRead( &c0 );
+    double t0 = now();
+    if( bt->policy == policy_fast_forward ) {
+      played = fastForwardArkanoid( game, input, FAST_FORWARD_STEPS, NULL, NULL );
+    } else {
+      simulateArkanoid( game, input );
+    }
+    double t1 = now();
+    perfCountersRead( &c1 );
+    double t2 = now();
+    redrawArkanoid( game );
+    double t3 = now();
+    perfCountersRead( &c2 );
+
+    bt->simTime += t1 - t0;
+    bt->drawTime += t3 - t2;
+    addCounters( &bt->simCounters, &c0, &c1 );
+    addCounters( &bt->drawCounters, &c1, &c2 );
+    if( !(game->flags & GAME_FLAG_NO_RENDER) ) {
+      bt->pixels += screen->width * screen->height * screen->depth;
+    }
+    bt->steps += played;
+  } while( now() - start < bt->minTime );
+
+  destroyArkanoid( game );
+}
+
+// Same as the headless policy but with the games stepped together, every
+//  running game counts as a step
+static void runBatch( bench_thread_t *bt )
+{
+  arkanoid_batch_t *batch = NULL;
+  unsigned int seeds[BATCH_GAMES];
+  input_t inputs[BATCH_GAMES];
+  double start = now();
+  int i;
+
+  do {
+    if( batch == NULL || batch->num_running < BATCH_GAMES / 2 ) {
+      destroyArkanoidBatch( batch );
+      for( i = 0; i < BATCH_GAMES; i++ ) {
+	seeds[i] = rand_r( &bt->seed );
+      }
+      double t0 = now();
+      batch = createArkanoidBatch( BATCH_GAMES, MAX_ROUNDS, seeds );
+      bt->createTime += now() - t0;
+      if( batch == NULL ) {
+	bt->failed = true;
+	return;
+      }
+      bt->games += BATCH_GAMES;
+    }
+
+    for( i = 0; i < BATCH_GAMES; i++ ) {
+      inputs[i].left = rand_r( &bt->seed ) / (float)RAND_MAX;
+      inputs[i].right = rand_r( &bt->seed ) / (float)RAND_MAX;
+    }
+
+    uint32_t running = batch->num_running;
+    perf_values_t c0, c1;
+    perfCountersRead( &c0 );
+    double t0 = now();
+    simulateArkanoidBatch( batch, inputs );
+    double t1 = now();
+    perfCountersRead( &c1 );
+
+    bt->simTime += t1 - t0;
+    addCounters( &bt->simCounters, &c0, &c1 );
+    bt->steps += running;
+  } while( now() - start < bt->minTime );
+
+  destroyArkanoidBatch( batch );
+}
+
+static void *benchThread( void *arg )
+{
+  bench_thread_t *bt = arg;
+
+  if( bt->policy == policy_create ) {
+    runCreate( bt );
+  } else if( bt->policy == policy_reset ) {
+    runReset( bt );
+  } else if( bt->policy == policy_batch ) {
+    runBatch( bt );
+  } else {
+    runSteps( bt );
+  }
+
+  return NULL;
+}
+
+static bool runCase( policy_t policy, int numThreads, double minTime, bool first )
+{
+  bench_thread_t *threads = calloc( numThreads, sizeof(bench_thread_t) );
+  if( threads == NULL ) {
+    return false;
+  }
+
+  int i, j;
+  int started = 0;
+  double start = now();
+  for( i = 0; i < numThreads; i++ ) {
+    threads[i].policy = policy;
+    threads[i].minTime = minTime;
+    threads[i].seed = i + 1;
+    if( pthread_create( &threads[i].thread, NULL, benchThread, &threads[i] ) != 0 ) {
+      break;
+    }
+    started++;
+  }
+  for( i = 0; i < started; i++ ) {
+    pthread_join( threads[i].thread, NULL );
+  }
+  double wallTime = now() - start;
+
+  bench_thread_t total = {0, };
+  bool failed = started != numThreads;
+  for( i = 0; i < started; i++ ) {
+    failed |= threads[i].failed;
+    total.steps += threads[i].steps;
+    total.games += threads[i].games;
+    total.pixels += threads[i].pixels;
+    total.simTime += threads[i].simTime;
+    total.drawTime += threads[i].drawTime;
+    total.createTime += threads[i].createTime;
+    total.destroyTime += threads[i].destroyTime;
+    for( j = 0; j < perf_counter_count; j++ ) {
+      total.simCounters.value[j] += threads[i].simCounters.value[j];
+      total.drawCounters.value[j] += threads[i].drawCounters.value[j];
+    }
+  }
+  free( threads );
+
+  if( failed ) {
+    fprintf( stderr, "Unable to run %s with %d threads\n", policyNames[policy], numThreads );
+    return false;
+  }
+
+  printf( "%s    {\"policy\": \"%s\", \"threads\": %d, \"games\": %llu, ",
+	  first ? "" : ",\n", policyNames[policy], numThreads,
+	  (unsigned long long)total.games );
+  if( policy == policy_create ) {
+    printf( "\"ns_per_create\": %.1f, \"ns_per_destroy\": %.1f, "
+	    "\"games_per_s\": %.1f, \"games_per_s_per_thread\": %.1f}",
+	    total.createTime * 1e9 / total.games,
+	    total.destroyTime * 1e9 / total.games,
+	    total.games / wallTime, total.games / wallTime / numThreads );
+  } else if( policy == policy_reset ) {
+    printf( "\"ns_per_reset\": %.1f, \"games_per_s\": %.1f, \"games_per_s_per_thread\": %.1f}",
+	    total.createTime * 1e9 / total.games,
+	    total.games / wallTime, total.games / wallTime / numThreads );
+  } else {
+    // Per thread rates only count the time spent inside the game, the
+    //  aggregate rate is what the whole machine manages
+    double drawPerStep = total.drawTime / total.steps;
+    double simPerStep = total.simTime / total.steps;
+    printf( "\"steps\": %llu, \"steps_per_s\": %.1f, \"steps_per_s_per_thread\": %.1f, "
+	    "\"sim_ns_per_step\": %.1f, \"draw_ns_per_step\": %.1f, "
+	    "\"draw_gb_per_s\": %.3f",
+	    (unsigned long long)total.steps, total.steps / wallTime,
+	    total.steps / (total.simTime + total.drawTime),
+	    simPerStep * 1e9, drawPerStep * 1e9,
+	    total.drawTime > 0 ? total.pixels * sizeof(float) / total.drawTime * 1e-9 * numThreads : 0 );
+    if( perfCountersEnabled() ) {
+      printCounters( "sim_counters_per_step", &total.simCounters, total.steps );
+      printCounters( "draw_counters_per_step", &total.drawCounters, total.steps );
+    }
+    printf( "}" );
+  }
+  fflush( stdout );
+
+  return true;
+}
+
+int main( int argc, char *argv[] )
+{
+  double minTime = 0.5;
+  int maxThreads = sysconf( _SC_NPROCESSORS_ONLN );
+  char *filter = NULL;
+  bool counters = false;
+
+  int c;
+  while( (c = getopt_long (argc, argv, "t:j:f:ch",
+			   getOptlist(), NULL)) != -1 ) {
+    switch(c) {
+    case 't': // Optional
+      minTime = strtod(optarg, NULL);
+      break;
+    case 'j': // Optional
+      maxThreads = atoi(optarg);
+      break;
+    case 'f': // Optional
+      filter = optarg;
+      break;
+    case 'c': // Optional
+      counters = true;
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  if( maxThreads < 1 ) {
+    maxThreads = 1;
+  }
+
+  if( counters && !perfCountersEnable() ) {
+    fprintf( stderr, "Performance counters unavailable (%s), continuing without them\n",
+	     strerror( errno ) );
+  }
+
+  printf( "{\n  \"benchmark\": \"bench_arkanoid\",\n  \"min_time\": %g,\n"
+	  "  \"max_threads\": %d,\n  \"results\": [\n", minTime, maxThreads );
+  bool first = true;
+  bool failed = false;
+  policy_t policy;
+  for( policy = policy_idle; policy <= policy_reset; policy++ ) {
+    if( filter != NULL && strstr( policyNames[policy], filter ) == NULL ) {
+      continue;
+    }
+
+    // Powers of two up to and including the highest thread count
+    int numThreads = 1;
+    while( 1 ) {
+      if( runCase( policy, numThreads, minTime, first ) ) {
+	first = false;
+      } else {
+	failed = true;
+      }
+
+      if( numThreads == maxThreads ) {
+	break;
+      }
+      numThreads *= 2;
+      if( numThreads > maxThreads ) {
+	numThreads = maxThreads;
+      }
+    }
+  }
+  printf( "\n  ]\n}\n" );
+
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,387 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "network.h"
+#include "topologies.h"
+#include "population.h"
+
+// Same mutation rate as populationRespawn()
+#define MUTATE_RATE 0.005
+
+typedef enum operation_e {
+  operation_copy,
+  operation_combine,
+  operation_mutate,
+  operation_respawn
+} operation_t;
+
+static const char *operationNames[] = {"copy", "combine", "mutate", "respawn"};
+
+typedef struct topology_s {
+  const char         *name;
+  uint64_t            numInputs;
+  uint64_t            numLayers;
+  // Large enough for any of the trained networks
+  ffn_layer_params_t  layerParams[ARKANOID_NET_LAYERS];
+} topology_t;
+
+/*******************************************
+ *           Allocation counting           *
+ *******************************************/
+// Built with COUNT_ALLOCATIONS the bench is linked with --wrap for these, so
+//  every allocation made by libffann and the population code ends up here
+//  first.  Without it nothing is counted.
+static uint64_t numAllocations = 0;
+
+#ifdef COUNT_ALLOCATIONS
+void *__real_malloc( size_t size );
+void *__real_calloc( size_t nmemb, size_t size );
+void *__real_realloc( void *ptr, size_t size );
+
+void *__wrap_malloc( size_t size )
+{
+  __atomic_add_fetch( &numAllocations, 1, __ATOMIC_RELAXED );
+  return __real_malloc( size );
+}
+
+void *__wrap_calloc( size_t nmemb, size_t size )
+{
+  __atomic_add_fetch( &numAllocations, 1, __ATOMIC_RELAXED );
+  return __real_calloc( nmemb, size );
+}
+
+void *__wrap_realloc( void *ptr, size_t size )
+{
+  __atomic_add_fetch( &numAllocations, 1, __ATOMIC_RELAXED );
+  return __real_realloc( ptr, size );
+}
+#endif
+
+/*******************************************
+ *              Memory usage               *
+ *******************************************/
+// Reset the peak resident set size of the process to the current one.
+//  Returns false on kernels that don't support it.
+static bool resetPeakRss( void )
+{
+  FILE *fp = fopen( "/proc/self/clear_refs", "w" );
+  if( fp == NULL ) {
+    return false;
+  }
+
+  bool success = fputs( "5", fp ) >= 0;
+  if( fclose( fp ) != 0 ) {
+    success = false;
+  }
+
+  return success;
+}
+
+// Read a memory value in kB from /proc/self/status, e.g. "VmHWM" for peak
+//  resident set size.  Returns 0 if unavailable.
+static uint64_t readStatus( const char *field )
+{
+  FILE *fp = fopen( "/proc/self/status", "r" );
+  if( fp == NULL ) {
+    return 0;
+  }
+
+  char line[256];
+  size_t len = strlen( field );
+  uint64_t value = 0;
+  while( fgets( line, sizeof(line), fp ) != NULL ) {
+    if( strncmp( line, field, len ) == 0 && line[len] == ':' ) {
+      value = strtoull( line + len + 1, NULL, 10 );
+      break;
+    }
+  }
+  fclose( fp );
+
+  return value;
+}
+
+/*******************************************
+ *               Benchmarks                *
+ *******************************************/
+static const struct option *getOptlist()
+{
+  static struct option optlist[] = {
+    {"min-time",   required_argument, NULL, 't'},
+    {"population", required_argument, NULL, 'p'},
+    {"filter",     required_argument, NULL, 'f'},
+
+    {"help",       no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  return optlist;
+}
+
+static void usage( char *progname )
+{
+  printf( "Usage: %s [OPTION]...\n", progname );
+  printf( "Measure time, allocations and peak memory usage of the genetic operators\n"
+	  "used between generations and print the results as JSON.\n\n" );
+  printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
+  printf( "  -t, --min-time=FLOAT       seconds to run each case for, defaults to 0.5,\n"
+	  "                             every case runs at least once\n" );
+  printf( "  -p, --population=INT       population size for respawn, defaults to 75\n" );
+  printf( "  -f, --filter=STRING        only run cases whose name contains STRING, names\n"
+	  "                             are <topology>_<operation>, e.g. arkanoid_copy\n" );
+
+  printf( "  -h, --help                 display this message and exit\n" );
+}
+
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static population_t *createPopulation( const topology_t *top, int size )
+{
+  population_t *population = populationCreate( size, top->numInputs, top->numLayers,
+					       (ffn_layer_params_t*)top->layerParams, true );
+  if( population == NULL ) {
+    return NULL;
+  }
+
+  int i;
+  bool failed = false;
+  for( i = 0; i < size; i++ ) {
+    if( populationGetIndividual( population, i ) == NULL ) {
+      failed = true;
+    }
+    populationSetScore( population, i, rand() % 1000 );
+  }
+
+  // populationDestroy() doesn't expect missing networks
+  if( failed ) {
+    for( i = 0; i < size; i++ ) {
+      if( population->elements[i].network != NULL ) {
+	ffnNetworkDestroy( population->elements[i].network );
+      }
+    }
+    free( population->elements );
+    free( population );
+    return NULL;
+  }
+
+  return population;
+}
+
+// Run one operation, only the operation itself is timed.  Returns a negative
+//  value on failure.
+static double runOnce( operation_t op, ffn_network_t *mother, ffn_network_t *father,
+		       population_t *population, uint64_t *allocations )
+{
+  ffn_network_t *result = NULL;
+  double start, elapsed;
+  uint64_t before;
+
+  switch( op ) {
+  case operation_copy:
+    before = numAllocations;
+    start = now();
+    result = ffnNetworkCopy( mother );
+    elapsed = now() - start;
+    *allocations += numAllocations - before;
+    break;
+
+  case operation_combine:
+    before = numAllocations;
+    start = now();
+    result = ffnNetworkCombineOnNeurons( mother, father );
+    elapsed = now() - start;
+    *allocations += numAllocations - before;
+    break;
+
+  case operation_mutate:
+    result = ffnNetworkCopy( mother );
+    if( result == NULL ) {
+      return -1;
+    }
+    before = numAllocations;
+    start = now();
+    ffnNetworkMutate( result, MUTATE_RATE );
+    elapsed = now() - start;
+    *allocations += numAllocations - before;
+    break;
+
+  case operation_respawn:
+    before = numAllocations;
+    start = now();
+    populationRespawn( population, false );
+    elapsed = now() - start;
+    *allocations += numAllocations - before;
+    return elapsed;
+  }
+
+  if( result == NULL ) {
+    return -1;
+  }
+  ffnNetworkDestroy( result );
+
+  return elapsed;
+}
+
+static bool runCase( const topology_t *top, operation_t op, int populationSize,
+		     double minTime, bool first )
+{
+  ffn_network_t *mother = NULL;
+  ffn_network_t *father = NULL;
+  population_t *population = NULL;
+
+  // Same seed for every case so runs are comparable between commits
+  srand( 1 );
+
+  if( op == operation_respawn ) {
+    population = createPopulation( top, populationSize );
+    if( population == NULL ) {
+      fprintf( stderr, "Unable to create population of %d for %s\n", populationSize, top->name );
+      return false;
+    }
+  } else {
+    mother = ffnNetworkCreate( top->numInputs, top->numLayers, (ffn_layer_params_t*)top->layerParams, true );
+    father = ffnNetworkCreate( top->numInputs, top->numLayers, (ffn_layer_params_t*)top->layerParams, true );
+    if( mother == NULL || father == NULL ) {
+      fprintf( stderr, "Unable to create networks for %s\n", top->name );
+      if( mother != NULL ) {
+	ffnNetworkDestroy( mother );
+      }
+      if( father != NULL ) {
+	ffnNetworkDestroy( father );
+      }
+      return false;
+    }
+  }
+
+  uint64_t baseRss = readStatus( "VmRSS" );
+  bool peakValid = resetPeakRss();
+
+  uint64_t iterations = 0;
+  uint64_t allocations = 0;
+  double total = 0;
+  double best = -1;
+  bool failed = false;
+  do {
+    double elapsed = runOnce( op, mother, father, population, &allocations );
+    if( elapsed < 0 ) {
+      failed = true;
+      break;
+    }
+    if( best < 0 || elapsed < best ) {
+      best = elapsed;
+    }
+    total += elapsed;
+    iterations++;
+  } while( total < minTime );
+
+  uint64_t peakRss = peakValid ? readStatus( "VmHWM" ) : 0;
+
+  if( population != NULL ) {
+    populationDestroy( population );
+  } else {
+    ffnNetworkDestroy( mother );
+    ffnNetworkDestroy( father );
+  }
+
+  if( failed ) {
+    fprintf( stderr, "%s_%s failed\n", top->name, operationNames[op] );
+    return false;
+  }
+
+  printf( "%s    {\"name\": \"%s_%s\", \"topology\": \"%s\", \"operation\": \"%s\", ",
+	  first ? "" : ",\n", top->name, operationNames[op], top->name, operationNames[op] );
+  if( op == operation_respawn ) {
+    printf( "\"population\": %d, ", populationSize );
+  }
+  printf( "\"iterations\": %llu, \"ms_mean\": %.3f, \"ms_min\": %.3f, ",
+	  (unsigned long long)iterations, total * 1e3 / iterations, best * 1e3 );
+#ifdef COUNT_ALLOCATIONS
+  printf( "\"allocations_per_op\": %.1f, ", allocations / (double)iterations );
+#else
+  printf( "\"allocations_per_op\": null, " );
+#endif
+  printf( "\"base_rss_kb\": %llu, ", (unsigned long long)baseRss );
+  if( peakValid ) {
+    printf( "\"peak_rss_kb\": %llu}", (unsigned long long)peakRss );
+  } else {
+    printf( "\"peak_rss_kb\": null}" );
+  }
+  fflush( stdout );
+
+  return true;
+}
+
+int main( int argc, char *argv[] )
+{
+  double minTime = 0.5;
+  int populationSize = 75;
+  char *filter = NULL;
+
+  int c;
+  while( (c = getopt_long (argc, argv, "t:p:f:h",
+			   getOptlist(), NULL)) != -1 ) {
+    switch(c) {
+    case 't': // Optional
+      minTime = strtod(optarg, NULL);
+      break;
+    case 'p': // Optional
+      populationSize = atoi(optarg);
+      break;
+    case 'f': // Optional
+      filter = optarg;
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  if( populationSize < 2 ) {
+    fprintf( stderr, "The population needs at least two members\n" );
+    return -1;
+  }
+
+  // The networks trained by threadTrainer and game, the latter on the screen
+  topology_t topologies[] = {
+    {"addtrainer", ADDTRAINER_INPUTS, ADDTRAINER_LAYERS},
+    {"arkanoid", ARKANOID_SCREEN_INPUTS, ARKANOID_NET_LAYERS},
+  };
+  addTrainerLayers( topologies[0].layerParams );
+  arkanoidLayers( topologies[1].layerParams, ARKANOID_SCREEN_INPUTS, true );
+  const int numTopologies = sizeof(topologies) / sizeof(topologies[0]);
+
+  printf( "{\n  \"benchmark\": \"bench_genetics\",\n  \"min_time\": %g,\n  \"results\": [\n", minTime );
+  bool first = true;
+  bool failed = false;
+  int i;
+  operation_t op;
+  for( i = 0; i < numTopologies; i++ ) {
+    for( op = operation_copy; op <= operation_respawn; op++ ) {
+      char name[64];
+      snprintf( name, sizeof(name), "%s_%s", topologies[i].name, operationNames[op] );
+      if( filter != NULL && strstr( name, filter ) == NULL ) {
+	continue;
+      }
+
+      if( runCase( &topologies[i], op, populationSize, minTime, first ) ) {
+	first = false;
+      } else {
+	failed = true;
+      }
+    }
+  }
+  printf( "\n  ]\n}\n" );
+
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,415 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "network.h"
+#include "topologies.h"
+
+#define FILENAME_LEN 4096
+
+typedef struct topology_s {
+  const char         *name;
+  uint64_t            numInputs;
+  uint64_t            numLayers;
+  // Large enough for any of the trained networks
+  ffn_layer_params_t  layerParams[ARKANOID_NET_LAYERS];
+} topology_t;
+
+typedef struct io_bench_s {
+  double      minTime;
+  int         populationSize;
+  const char *tmpfsDir;
+  const char *diskDir;
+  const char *filter;
+  bool        first;
+  bool        failed;
+} io_bench_t;
+
+static const struct option *getOptlist()
+{
+  static struct option optlist[] = {
+    {"min-time",   required_argument, NULL, 't'},
+    {"population", required_argument, NULL, 'p'},
+    {"tmpfs",      required_argument, NULL, 'm'},
+    {"disk",       required_argument, NULL, 'd'},
+    {"filter",     required_argument, NULL, 'f'},
+
+    {"help",       no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  return optlist;
+}
+
+static void usage( char *progname )
+{
+  printf( "Usage: %s [OPTION]...\n", progname );
+  printf( "Measure how fast networks are serialised, unserialised, saved and loaded,\n"
+	  "and how long inspectNet and render take to start on a large network.\n"
+	  "Prints the results as JSON.\n\n" );
+  printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
+  printf( "  -t, --min-time=FLOAT       seconds to run each case for, defaults to 0.5,\n"
+	  "                             every case runs at least once\n" );
+  printf( "  -p, --population=INT       number of networks in the population cases,\n"
+	  "                             defaults to 75\n" );
+  printf( "  -m, --tmpfs=DIR            memory backed directory, defaults to /dev/shm\n" );
+  printf( "  -d, --disk=DIR             disk backed directory, defaults to .\n" );
+  printf( "  -f, --filter=STRING        only run cases whose name contains STRING\n" );
+
+  printf( "  -h, --help                 display this message and exit\n" );
+}
+
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool wanted( io_bench_t *bench, const char *name )
+{
+  return bench->filter == NULL || strstr( name, bench->filter ) != NULL;
+}
+
+static void report( io_bench_t *bench, const char *name, uint64_t bytes,
+		    uint64_t iterations, double elapsed )
+{
+  printf( "%s    {\"name\": \"%s\", \"bytes\": %llu, \"iterations\": %llu, "
+	  "\"ms_mean\": %.3f, \"mb_per_s\": %.1f}",
+	  bench->first ? "" : ",\n", name, (unsigned long long)bytes,
+	  (unsigned long long)iterations, elapsed * 1e3 / iterations,
+	  bytes * iterations / elapsed / 1e6 );
+  fflush( stdout );
+  bench->first = false;
+}
+
+static void fail( io_bench_t *bench, const char *name )
+{
+  fprintf( stderr, "%s failed\n", name );
+  bench->failed = true;
+}
+
+// Write the file to disk and drop it from the page cache, so the next read
+//  has to come from the device.  Has no effect on tmpfs.
+static bool evictFile( const char *filename )
+{
+  int fd = open( filename, O_RDONLY );
+  if( fd < 0 ) {
+    return false;
+  }
+
+  bool success = fdatasync( fd ) == 0 &&
+    posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED ) == 0;
+  close( fd );
+
+  return success;
+}
+
+static void benchMemory( io_bench_t *bench, const topology_t *top, ffn_network_t *net )
+{
+  char name[128];
+  uint8_t *buf;
+  uint64_t len = 0;
+  uint64_t iterations = 0;
+  double elapsed = 0;
+
+  snprintf( name, sizeof(name), "%s_serialise", top->name );
+  if( wanted( bench, name ) ) {
+    do {
+      double start = now();
+      len = ffnNetworkSerialise( net, &buf );
+      elapsed += now() - start;
+      iterations++;
+      if( len == 0 ) {
+	fail( bench, name );
+	return;
+      }
+      free( buf );
+    } while( elapsed < bench->minTime );
+    report( bench, name, len, iterations, elapsed );
+  }
+
+  snprintf( name, sizeof(name), "%s_unserialise", top->name );
+  if( wanted( bench, name ) ) {
+    len = ffnNetworkSerialise( net, &buf );
+    if( len == 0 ) {
+      fail( bench, name );
+      return;
+    }
+
+    iterations = 0;
+    elapsed = 0;
+    do {
+      double start = now();
+      ffn_network_t *tmp = ffnNetworkUnserialise( len, buf );
+      elapsed += now() - start;
+      iterations++;
+      if( tmp == NULL ) {
+	fail( bench, name );
+	free( buf );
+	return;
+      }
+      ffnNetworkDestroy( tmp );
+    } while( elapsed < bench->minTime );
+    free( buf );
+    report( bench, name, len, iterations, elapsed );
+  }
+}
+
+// Save and load <count> networks in <dir>, the same network is saved under
+//  different names so only one of them has to fit in memory at a time.
+static void benchFiles( io_bench_t *bench, const topology_t *top, ffn_network_t *net,
+			const char *kind, const char *dir, bool disk, int count )
+{
+  char saveName[128], loadName[128];
+  char filename[FILENAME_LEN];
+  const char *scope = count == 1 ? "single" : "population";
+  int i;
+
+  snprintf( saveName, sizeof(saveName), "%s_%s_save_%s", top->name, scope, kind );
+  snprintf( loadName, sizeof(loadName), "%s_%s_load_%s", top->name, scope, kind );
+  bool doSave = wanted( bench, saveName );
+  bool doLoad = wanted( bench, loadName );
+  if( !doSave && !doLoad ) {
+    return;
+  }
+
+  uint8_t *buf;
+  uint64_t len = ffnNetworkSerialise( net, &buf );
+  if( len == 0 ) {
+    fail( bench, saveName );
+    return;
+  }
+  free( buf );
+
+  // Saving always runs since loading needs the files, on disk the time
+  //  includes getting the data onto the device
+  uint64_t iterations = 0;
+  double elapsed = 0;
+  do {
+    double start = now();
+    for( i = 0; i < count; i++ ) {
+      snprintf( filename, FILENAME_LEN, "%s/bench_io_%s_%d.ffw", dir, top->name, i );
+      if( !ffnNetworkSaveFile( net, filename ) ||
+	  (disk && !evictFile( filename )) ) {
+	fail( bench, saveName );
+	goto cleanup;
+      }
+    }
+    elapsed += now() - start;
+    iterations++;
+  } while( doSave && elapsed < bench->minTime );
+  if( doSave ) {
+    report( bench, saveName, len * count, iterations, elapsed );
+  }
+
+  if( doLoad ) {
+    iterations = 0;
+    elapsed = 0;
+    do {
+      // Start every load from the device, not the page cache
+      if( disk ) {
+	for( i = 0; i < count; i++ ) {
+	  snprintf( filename, FILENAME_LEN, "%s/bench_io_%s_%d.ffw", dir, top->name, i );
+	  evictFile( filename );
+	}
+      }
+
+      double start = now();
+      for( i = 0; i < count; i++ ) {
+	snprintf( filename, FILENAME_LEN, "%s/bench_io_%s_%d.ffw", dir, top->name, i );
+	ffn_network_t *tmp = ffnNetworkLoadFile( filename );
+	if( tmp == NULL ) {
+	  fail( bench, loadName );
+	  goto cleanup;
+	}
+	ffnNetworkDestroy( tmp );
+      }
+      elapsed += now() - start;
+      iterations++;
+    } while( elapsed < bench->minTime );
+    report( bench, loadName, len * count, iterations, elapsed );
+  }
+
+ cleanup:
+  for( i = 0; i < count; i++ ) {
+    snprintf( filename, FILENAME_LEN, "%s/bench_io_%s_%d.ffw", dir, top->name, i );
+    unlink( filename );
+  }
+}
+
+// Run a tool with its output thrown away and return the wall time, or a
+//  negative value if it couldn't be run or failed.
+static double runTool( char *const argv[] )
+{
+  double start = now();
+  pid_t pid = fork();
+  if( pid < 0 ) {
+    return -1;
+  }
+
+  if( pid == 0 ) {
+    int devNull = open( "/dev/null", O_WRONLY );
+    if( devNull >= 0 ) {
+      dup2( devNull, STDOUT_FILENO );
+      dup2( devNull, STDERR_FILENO );
+      close( devNull );
+    }
+    execv( argv[0], argv );
+    _exit( 127 );
+  }
+
+  int status;
+  if( waitpid( pid, &status, 0 ) != pid ||
+      !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+    return -1;
+  }
+
+  return now() - start;
+}
+
+// Time from starting a tool until it exits, with the network file in the page
+//  cache and evicted from it
+static void benchColdStart( io_bench_t *bench, const char *tool, char *const argv[],
+			    const char *filename, uint64_t len )
+{
+  int cold;
+  for( cold = 1; cold >= 0; cold-- ) {
+    char name[128];
+    snprintf( name, sizeof(name), "coldstart_%s_%s", tool, cold ? "cold" : "warm" );
+    if( !wanted( bench, name ) ) {
+      continue;
+    }
+
+    uint64_t iterations = 0;
+    double elapsed = 0;
+    do {
+      if( cold ) {
+	evictFile( filename );
+      } else {
+	// Make sure the page cache is populated
+	ffn_network_t *tmp = ffnNetworkLoadFile( (char*)filename );
+	if( tmp != NULL ) {
+	  ffnNetworkDestroy( tmp );
+	}
+      }
+
+      double time = runTool( argv );
+      if( time < 0 ) {
+	fail( bench, name );
+	break;
+      }
+      elapsed += time;
+      iterations++;
+    } while( elapsed < bench->minTime );
+
+    if( iterations > 0 ) {
+      report( bench, name, len, iterations, elapsed );
+    }
+  }
+}
+
+int main( int argc, char *argv[] )
+{
+  io_bench_t bench = {0.5, 75, "/dev/shm", ".", NULL, true, false};
+
+  int c;
+  while( (c = getopt_long (argc, argv, "t:p:m:d:f:h",
+			   getOptlist(), NULL)) != -1 ) {
+    switch(c) {
+    case 't': // Optional
+      bench.minTime = strtod(optarg, NULL);
+      break;
+    case 'p': // Optional
+      bench.populationSize = atoi(optarg);
+      break;
+    case 'm': // Optional
+      bench.tmpfsDir = optarg;
+      break;
+    case 'd': // Optional
+      bench.diskDir = optarg;
+      break;
+    case 'f': // Optional
+      bench.filter = optarg;
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  if( bench.populationSize < 1 ) {
+    fprintf( stderr, "The population needs at least one member\n" );
+    return -1;
+  }
+
+  // The networks trained by threadTrainer and game, the latter on the screen
+  topology_t topologies[] = {
+    {"addtrainer", ADDTRAINER_INPUTS, ADDTRAINER_LAYERS},
+    {"arkanoid", ARKANOID_SCREEN_INPUTS, ARKANOID_NET_LAYERS},
+  };
+  addTrainerLayers( topologies[0].layerParams );
+  arkanoidLayers( topologies[1].layerParams, ARKANOID_SCREEN_INPUTS, true );
+  const int numTopologies = sizeof(topologies) / sizeof(topologies[0]);
+
+  printf( "{\n  \"benchmark\": \"bench_io\",\n  \"min_time\": %g,\n  \"population\": %d,\n"
+	  "  \"tmpfs\": \"%s\",\n  \"disk\": \"%s\",\n  \"results\": [\n",
+	  bench.minTime, bench.populationSize, bench.tmpfsDir, bench.diskDir );
+
+  int i;
+  for( i = 0; i < numTopologies; i++ ) {
+    const topology_t *top = &topologies[i];
+    srand( 1 );
+    ffn_network_t *net = ffnNetworkCreate( top->numInputs, top->numLayers,
+					   (ffn_layer_params_t*)top->layerParams, true );
+    if( net == NULL ) {
+      fail( &bench, top->name );
+      continue;
+    }
+
+    benchMemory( &bench, top, net );
+    benchFiles( &bench, top, net, "tmpfs", bench.tmpfsDir, false, 1 );
+    benchFiles( &bench, top, net, "disk", bench.diskDir, true, 1 );
+    if( bench.populationSize > 1 ) {
+      benchFiles( &bench, top, net, "tmpfs", bench.tmpfsDir, false, bench.populationSize );
+      benchFiles( &bench, top, net, "disk", bench.diskDir, true, bench.populationSize );
+    }
+
+    // The tools are only interesting on the large network
+    if( i == numTopologies - 1 &&
+	(wanted( &bench, "coldstart_inspectNet" ) || wanted( &bench, "coldstart_render" )) ) {
+      char filename[FILENAME_LEN];
+      snprintf( filename, FILENAME_LEN, "%s/bench_io_coldstart.ffw", bench.diskDir );
+      uint8_t *buf;
+      uint64_t len = ffnNetworkSerialise( net, &buf );
+      if( len > 0 ) {
+	free( buf );
+      }
+
+      if( len == 0 || !ffnNetworkSaveFile( net, filename ) ) {
+	fail( &bench, "coldstart" );
+      } else {
+	char *inspectArgs[] = {"./inspectNet", "--summary", filename, NULL};
+	char *renderArgs[] = {"./render", "--max-frames=1", "--no-images", filename, "0", "0", NULL};
+	benchColdStart( &bench, "inspectNet", inspectArgs, filename, len );
+	benchColdStart( &bench, "render", renderArgs, filename, len );
+	unlink( filename );
+      }
+    }
+
+    ffnNetworkDestroy( net );
+  }
+  printf( "\n  ]\n}\n" );
+
+  return bench.failed ? -1 : 0;
+}
@@ -0,0 +1,356 @@
+#define _GNU_SOURCE
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "network.h"
+
+// Networks are written in chunks of this size at chunk aligned offsets, from a
+//  buffer aligned well enough to bypass the page cache where that's supported.
+#define CHECKPOINT_CHUNK_SIZE (4 << 20)
+#define CHECKPOINT_ALIGNMENT  4096
+
+typedef struct checkpoint_entry_s {
+  ffn_network_t *snapshot;
+  char          *filename;
+} checkpoint_entry_t;
+
+typedef struct checkpoint_writer_s {
+  int                 numThreads;
+  pthread_t          *threads;
+
+  // Bounded ring buffer of networks waiting to be written
+  int                 queueLength;
+  int                 first;
+  int                 used;
+  checkpoint_entry_t *queue;
+
+  // Networks either waiting in the queue or currently being written
+  int                 pending;
+  int                 numFailed;
+  bool                stop;
+
+  pthread_mutex_t     mutex;
+  pthread_cond_t      notEmpty;
+  pthread_cond_t      notFull;
+  pthread_cond_t      idle;
+} checkpoint_writer_t;
+
+#ifdef O_DIRECT
+// Go back to writing <fd> through the page cache
+static bool clearDirect( int fd )
+{
+  int flags = fcntl( fd, F_GETFL );
+  return flags >= 0 && fcntl( fd, F_SETFL, flags & ~O_DIRECT ) == 0;
+}
+#endif
+
+// Write <len> bytes of <buf> to <fd>, one chunk at a time copied through the
+//  aligned <chunkBuf>.  If <fd> bypasses the page cache, the unaligned end of
+//  the file and anything the filesystem refuses are written through it instead.
+static bool writeAll( int fd, bool direct, const uint8_t *buf, uint64_t len, uint8_t *chunkBuf )
+{
+  uint64_t offset = 0;
+  while( offset < len ) {
+    uint64_t chunk = len - offset;
+    if( chunk > CHECKPOINT_CHUNK_SIZE ) {
+      chunk = CHECKPOINT_CHUNK_SIZE;
+    }
+    memcpy( chunkBuf, buf + offset, chunk );
+
+    uint64_t done = 0;
+    while( done < chunk ) {
+#ifdef O_DIRECT
+      if( direct && (done % CHECKPOINT_ALIGNMENT != 0 || (chunk - done) % CHECKPOINT_ALIGNMENT != 0) ) {
+	if( !clearDirect( fd ) ) {
+	  return false;
+	}
+	direct = false;
+      }
+#endif
+
+      ssize_t written = pwrite( fd, chunkBuf + done, chunk - done, offset + done );
+      if( written < 0 ) {
+	if( errno == EINTR ) {
+	  continue;
+	}
+#ifdef O_DIRECT
+	if( errno == EINVAL && direct ) {
+	  if( !clearDirect( fd ) ) {
+	    return false;
+	  }
+	  direct = false;
+	  continue;
+	}
+#endif
+	return false;
+      }
+      if( written == 0 ) {
+	return false;
+      }
+      done += written;
+    }
+    offset += chunk;
+  }
+
+  return true;
+}
+
+// Flush the directory <filename> is in, so a rename into it survives a
+//  power loss
+static bool syncDirectory( const char *filename )
+{
+  const char *slash = strrchr( filename, '/' );
+  char *dirName;
+  if( slash == NULL ) {
+    dirName = strdup( "." );
+  } else if( slash == filename ) {
+    dirName = strdup( "/" );
+  } else {
+    dirName = strndup( filename, slash - filename );
+  }
+  if( dirName == NULL ) {
+    return false;
+  }
+
+  bool success = false;
+  int fd = open( dirName, O_RDONLY | O_DIRECTORY );
+  if( fd >= 0 ) {
+    success = fsync( fd ) == 0;
+    if( close( fd ) != 0 ) {
+      success = false;
+    }
+  }
+
+  free( dirName );
+  return success;
+}
+
+// Serialise and write a network to a temporary file which is synced to disk
+//  and renamed when complete, followed by its directory, so neither a crash
+//  nor a power loss leaves a truncated network behind.
+static bool writeNetwork( ffn_network_t *network, const char *filename )
+{
+  uint8_t *buf;
+  uint64_t len = ffnNetworkSerialise( network, &buf );
+  if( len == 0 ) {
+    return false;
+  }
+
+  size_t nameLen = strlen( filename ) + sizeof(".tmp");
+  char *tmpName = malloc( nameLen );
+  if( tmpName == NULL ) {
+    free( buf );
+    return false;
+  }
+  snprintf( tmpName, nameLen, "%s.tmp", filename );
+
+  uint8_t *chunkBuf;
+  if( posix_memalign( (void **)&chunkBuf, CHECKPOINT_ALIGNMENT, CHECKPOINT_CHUNK_SIZE ) != 0 ) {
+    free( tmpName );
+    free( buf );
+    return false;
+  }
+
+  // Checkpoints are rarely read back soon, don't let them push the trainers
+  //  out of the page cache unless the filesystem can't do without it
+  bool direct = false;
+  int fd = -1;
+#ifdef O_DIRECT
+  fd = open( tmpName, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644 );
+  direct = fd >= 0;
+#endif
+  if( fd < 0 ) {
+    fd = open( tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+  }
+
+  bool success = false;
+  if( fd >= 0 ) {
+    success = writeAll( fd, direct, buf, len, chunkBuf ) && fsync( fd ) == 0;
+    if( close( fd ) != 0 ) {
+      success = false;
+    }
+
+    if( success ) {
+      success = rename( tmpName, filename ) == 0 && syncDirectory( filename );
+    } else {
+      unlink( tmpName );
+    }
+  }
+
+  free( chunkBuf );
+  free( tmpName );
+  free( buf );
+  return success;
+}
+
+static void *writerThread( void *arg )
+{
+  checkpoint_writer_t *writer = arg;
+
+  pthread_mutex_lock( &writer->mutex );
+  while( 1 ) {
+    while( writer->used == 0 && !writer->stop ) {
+      pthread_cond_wait( &writer->notEmpty, &writer->mutex );
+    }
+    if( writer->used == 0 && writer->stop ) {
+      break;
+    }
+
+    checkpoint_entry_t entry = writer->queue[writer->first];
+    writer->first = (writer->first + 1) % writer->queueLength;
+    writer->used--;
+    pthread_cond_signal( &writer->notFull );
+    pthread_mutex_unlock( &writer->mutex );
+
+    bool success = writeNetwork( entry.snapshot, entry.filename );
+    if( !success ) {
+      fprintf( stderr, "Unable to save network to %s\n", entry.filename );
+    }
+    ffnNetworkDestroy( entry.snapshot );
+    free( entry.filename );
+
+    pthread_mutex_lock( &writer->mutex );
+    if( !success ) {
+      writer->numFailed++;
+    }
+    writer->pending--;
+    if( writer->pending == 0 ) {
+      pthread_cond_broadcast( &writer->idle );
+    }
+  }
+  pthread_mutex_unlock( &writer->mutex );
+
+  return NULL;
+}
+
+checkpoint_writer_t *checkpointWriterCreate( int numThreads, int queueLength )
+{
+  if( numThreads < 1 || queueLength < 1 ) {
+    return NULL;
+  }
+
+  checkpoint_writer_t *tmp = malloc( sizeof(checkpoint_writer_t) );
+  if( tmp == NULL ) {
+    return NULL;
+  }
+
+  tmp->queueLength = queueLength;
+  tmp->first = 0;
+  tmp->used = 0;
+  tmp->pending = 0;
+  tmp->numFailed = 0;
+  tmp->stop = false;
+
+  tmp->queue = malloc( sizeof(checkpoint_entry_t) * queueLength );
+  if( tmp->queue == NULL ) {
+    free( tmp );
+    return NULL;
+  }
+
+  tmp->threads = malloc( sizeof(pthread_t) * numThreads );
+  if( tmp->threads == NULL ) {
+    free( tmp->queue );
+    free( tmp );
+    return NULL;
+  }
+
+  pthread_mutex_init( &tmp->mutex, NULL );
+  pthread_cond_init( &tmp->notEmpty, NULL );
+  pthread_cond_init( &tmp->notFull, NULL );
+  pthread_cond_init( &tmp->idle, NULL );
+
+  for( tmp->numThreads = 0; tmp->numThreads < numThreads; tmp->numThreads++ ) {
+    if( pthread_create( &tmp->threads[tmp->numThreads], NULL, writerThread, tmp ) != 0 ) {
+      checkpointWriterDestroy( tmp );
+      return NULL;
+    }
+  }
+
+  return tmp;
+}
+
+bool checkpointWriterSave( checkpoint_writer_t *writer, ffn_network_t *network, const char *filename )
+{
+  // The snapshot is taken before queueing so the caller is free to respawn
+  //  the population while the copy is being written.
+  ffn_network_t *snapshot = ffnNetworkCopy( network );
+  if( snapshot == NULL ) {
+    return false;
+  }
+
+  char *name = strdup( filename );
+  if( name == NULL ) {
+    ffnNetworkDestroy( snapshot );
+    return false;
+  }
+
+  pthread_mutex_lock( &writer->mutex );
+  while( writer->used == writer->queueLength ) {
+    pthread_cond_wait( &writer->notFull, &writer->mutex );
+  }
+
+  int last = (writer->first + writer->used) % writer->queueLength;
+  writer->queue[last].snapshot = snapshot;
+  writer->queue[last].filename = name;
+  writer->used++;
+  writer->pending++;
+
+  pthread_cond_signal( &writer->notEmpty );
+  pthread_mutex_unlock( &writer->mutex );
+
+  return true;
+}
+
+void checkpointWriterFlush( checkpoint_writer_t *writer )
+{
+  pthread_mutex_lock( &writer->mutex );
+  while( writer->pending > 0 ) {
+    pthread_cond_wait( &writer->idle, &writer->mutex );
+  }
+  pthread_mutex_unlock( &writer->mutex );
+}
+
+int checkpointWriterGetNumFailed( checkpoint_writer_t *writer )
+{
+  pthread_mutex_lock( &writer->mutex );
+  int numFailed = writer->numFailed;
+  pthread_mutex_unlock( &writer->mutex );
+
+  return numFailed;
+}
+
+void checkpointWriterDestroy( checkpoint_writer_t *writer )
+{
+  if( writer == NULL ) {
+    return;
+  }
+
+  // Threads only quit once the queue has been emptied
+  pthread_mutex_lock( &writer->mutex );
+  writer->stop = true;
+  pthread_cond_broadcast( &writer->notEmpty );
+  pthread_mutex_unlock( &writer->mutex );
+
+  int i;
+  for( i = 0; i < writer->numThreads; i++ ) {
+    pthread_join( writer->threads[i], NULL );
+  }
+
+  pthread_cond_destroy( &writer->idle );
+  pthread_cond_destroy( &writer->notFull );
+  pthread_cond_destroy( &writer->notEmpty );
+  pthread_mutex_destroy( &writer->mutex );
+
+  free( writer->threads );
+  free( writer->queue );
+  free( writer );
+}
@@ -0,0 +1,30 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+
+#include "network.h"
+
+// Writes networks to disk on background threads so the trainers don't have to
+//  stall between generations while tens of megabytes are being serialised.
+typedef struct checkpoint_writer_s checkpoint_writer_t;
+
+// Start <numThreads> writer threads with room for <queueLength> pending
+//  networks.  Returns NULL on failure.
+checkpoint_writer_t *checkpointWriterCreate( int numThreads, int queueLength );
+
+// Take a snapshot of <network> and queue it for writing to <filename>.  The
+//  network can be changed or destroyed as soon as the call returns.  Blocks
+//  while the queue is full.
+bool checkpointWriterSave( checkpoint_writer_t *writer, ffn_network_t *network, const char *filename );
+
+// Wait until every network queued so far has been written to disk.
+void checkpointWriterFlush( checkpoint_writer_t *writer );
+
+// Returns the number of networks that couldn't be written since creation.
+int checkpointWriterGetNumFailed( checkpoint_writer_t *writer );
+
+// Flush all pending networks, stop the writer threads and free memory.
+void checkpointWriterDestroy( checkpoint_writer_t *writer );
+
+#endif
@@ -1,22 +1,170 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <getopt.h>
 
 #include "network.h"
 
+static const struct option *getOptlist()
+{
+  static struct option optlist[] = {
+    {"prune",    required_argument, NULL, 'p'},
+    {"sparsity", required_argument, NULL, 'S'},
+    {"samples",  required_argument, NULL, 'n'},
+    {"output",   required_argument, NULL, 'o'},
+    {"summary",  no_argument,       NULL, 's'},
+
+    {"help",     no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  return optlist;
+}
+
+static void usage( char *progname )
+{
+  printf( "Usage: %s [OPTION]... FILE\n", progname );
+  printf( "Print a neural network definition file.\n\n" );
+  printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
+  printf( "  -p, --prune=FLOAT          remove connections with weights smaller than FLOAT\n"
+	  "                             and print the pruned network instead\n" );
+  printf( "  -S, --sparsity=FLOAT       remove the FLOAT (0.0 - 1.0) smallest fraction of the\n"
+	  "                             weights in every layer and print the pruned network\n" );
+  printf( "  -n, --samples=INT          number of random inputs used to measure how much\n"
+	  "                             the pruned network deviates from the original\n" );
+  printf( "  -o, --output=FILE          save the pruned network to FILE\n" );
+  printf( "  -s, --summary              only print the shape of the network, not every\n"
+	  "                             connection and weight\n" );
+
+  printf( "  -h, --help                 display this message and exit\n" );
+}
+
+// Compare a pruned network to the original on random inputs and print the result
+static void printPruneReport( ffn_network_t *net, ffn_network_t *pruned, uint64_t numSamples )
+{
+  uint64_t i;
+  uint64_t numInputs = ffnNetworkGetNumInputs( net );
+  float *samples = malloc( sizeof(float) * numInputs * numSamples );
+  if( samples == NULL ) {
+    fprintf( stderr, "Unable to allocate sample inputs\n" );
+    return;
+  }
+
+  for( i = 0; i < numInputs * numSamples; i++ ) {
+    samples[i] = rand() / (float)RAND_MAX;
+  }
+
+  ffn_deviation_t deviation;
+  ffnNetworkCompareOutputs( net, pruned, numSamples, samples, &deviation );
+  free( samples );
+
+  uint64_t before = ffnNetworkGetNumWeights( net );
+  uint64_t after = ffnNetworkGetNumWeights( pruned );
+  fprintf( stderr, "Weights:        %llu -> %llu (%.2f%% removed)\n",
+	   (unsigned long long)before, (unsigned long long)after,
+	   before ? 100.0 * (before - after) / (double)before : 0.0 );
+  fprintf( stderr, "Samples:        %llu\n", (unsigned long long)deviation.numSamples );
+  fprintf( stderr, "Max deviation:  %g\n", deviation.maxAbsError );
+  fprintf( stderr, "Mean deviation: %g\n", deviation.meanAbsError );
+}
+
+static void printSummary( ffn_network_t *net )
+{
+  uint64_t lay;
+  printf( "Inputs:  %llu\n", (unsigned long long)ffnNetworkGetNumInputs( net ) );
+  printf( "Layers:  %llu\n", (unsigned long long)ffnNetworkGetNumLayers( net ) );
+  for( lay = 0; lay < ffnNetworkGetNumLayers( net ); lay++ ) {
+    printf( "  %llu: %llu neurons, %llu connections\n", (unsigned long long)lay,
+	    (unsigned long long)ffnNetworkGetLayerNumNeurons( net, lay ),
+	    (unsigned long long)ffnNetworkGetLayerNumConnections( net, lay ) );
+  }
+  printf( "Weights: %llu\n", (unsigned long long)ffnNetworkGetNumWeights( net ) );
+  printf( "Pruned:  %s\n", ffnNetworkIsPruned( net ) ? "yes" : "no" );
+}
+
 int main( int argc, char *argv[] )
 {
-  printf( "%d\n", argc );
-  if( argc < 2 ) {
+  bool prune = false;
+  float threshold = -1.0;
+  double sparsity = -1.0;
+  uint64_t numSamples = 16;
+  char *outputFilename = NULL;
+  bool summary = false;
+
+  int c;
+  while( (c = getopt_long (argc, argv, "p:S:n:o:sh",
+			   getOptlist(), NULL)) != -1 ) {
+    switch(c) {
+    case 'p': // Optional
+      prune = true;
+      threshold = strtof(optarg, NULL);
+      break;
+    case 'S': // Optional
+      prune = true;
+      sparsity = strtod(optarg, NULL);
+      if( sparsity < 0.0 || sparsity > 1.0 ) {
+	fprintf( stderr, "Sparsity has to be between 0.0 and 1.0\n" );
+	return -3;
+      }
+      break;
+    case 'n': // Optional
+      numSamples = strtoull(optarg, NULL, 10);
+      break;
+    case 'o': // Optional
+      outputFilename = optarg;
+      break;
+    case 's': // Optional
+      summary = true;
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  if( optind >= argc ) {
     fprintf( stderr, "Please provide a neural network definition file.\n" );
     return -1;
   }
 
-  ffn_network_t *net = ffnNetworkLoadFile( argv[1] );
+  ffn_network_t *net = ffnNetworkLoadFile( argv[optind] );
   if( net == NULL ) {
-    fprintf( stderr, "File is not a neural network definition file: \"%s\".\n", argv[1] );
+    fprintf( stderr, "File is not a neural network definition file: \"%s\".\n", argv[optind] );
     return -2;
   }
 
-  ffnNetworkPrint( net );
+  if( prune ) {
+    ffn_network_t *pruned;
+    if( sparsity >= 0.0 ) {
+      pruned = ffnNetworkPruneToSparsity( net, sparsity );
+    } else {
+      pruned = ffnNetworkPrune( net, threshold );
+    }
+    if( pruned == NULL ) {
+      fprintf( stderr, "Unable to prune network\n" );
+      ffnNetworkDestroy( net );
+      return -4;
+    }
+
+    printPruneReport( net, pruned, numSamples );
+
+    if( outputFilename != NULL && !ffnNetworkSaveFile( pruned, outputFilename ) ) {
+      fprintf( stderr, "Unable to save pruned network to \"%s\".\n", outputFilename );
+      ffnNetworkDestroy( pruned );
+      ffnNetworkDestroy( net );
+      return -5;
+    }
+
+    ffnNetworkDestroy( net );
+    net = pruned;
+  }
+
+  if( summary ) {
+    printSummary( net );
+  } else {
+    ffnNetworkPrint( net );
+  }
+  ffnNetworkDestroy( net );
 
   return 0;
 }
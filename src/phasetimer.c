@@ -0,0 +1,174 @@
+#include "phasetimer.h"
+
+#ifdef ENABLE_PHASE_TIMERS
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+typedef struct phase_buffer_s {
+  uint64_t ns[phase_count];
+  uint64_t count[phase_count];
+  uint64_t counters[phase_count][perf_counter_count];
+
+  // Buffers outlive their threads so nothing is lost when a thread quits
+  //  before the summary is printed
+  struct phase_buffer_s *next;
+} phase_buffer_t;
+
+static __thread phase_buffer_t *localBuffer = NULL;
+
+static phase_buffer_t *buffers = NULL;
+static pthread_mutex_t buffersMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *phaseNames[phase_count] = {
+  [phase_create_game] = "create",
+  [phase_simulate]    = "simulate",
+  [phase_draw]        = "draw",
+  [phase_copy_frame]  = "copy",
+  [phase_layer + 0]   = "layer0",
+  [phase_layer + 1]   = "layer1",
+  [phase_layer + 2]   = "layer2",
+  [phase_layer + 3]   = "layer3",
+  [phase_layer + 4]   = "layer4",
+  [phase_layer + 5]   = "layer5",
+  [phase_layer + 6]   = "layer6",
+  [phase_layer_last]  = "layer7+",
+  [phase_score]       = "score",
+  [phase_respawn]     = "respawn",
+  [phase_save]        = "save",
+};
+
+static uint64_t nowNs( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void phaseTimerBegin( phase_mark_t *mark )
+{
+  perfCountersRead( &mark->counters );
+  mark->ns = nowNs();
+}
+
+void phaseTimerEnd( phase_mark_t *mark, phase_t phase )
+{
+  uint64_t ns = nowNs() - mark->ns;
+  perf_values_t counters;
+  bool counted = perfCountersRead( &counters );
+  int i;
+
+  if( localBuffer == NULL ) {
+    localBuffer = calloc( 1, sizeof(phase_buffer_t) );
+    if( localBuffer == NULL ) {
+      return;
+    }
+
+    pthread_mutex_lock( &buffersMutex );
+    localBuffer->next = buffers;
+    buffers = localBuffer;
+    pthread_mutex_unlock( &buffersMutex );
+  }
+
+  localBuffer->ns[phase] += ns;
+  localBuffer->count[phase]++;
+  if( counted ) {
+    for( i = 0; i < perf_counter_count; i++ ) {
+      localBuffer->counters[phase][i] += counters.value[i] - mark->counters.value[i];
+    }
+  }
+}
+
+// Print <value> with a metric suffix so the columns stay readable
+static void printCount( FILE *file, double value )
+{
+  if( value >= 1e9 ) {
+    fprintf( file, " %7.2fG", value * 1e-9 );
+  } else if( value >= 1e6 ) {
+    fprintf( file, " %7.2fM", value * 1e-6 );
+  } else if( value >= 1e3 ) {
+    fprintf( file, " %7.2fk", value * 1e-3 );
+  } else {
+    fprintf( file, " %7.0f ", value );
+  }
+}
+
+static void printCounters( FILE *file, const uint64_t *count,
+			   uint64_t counters[phase_count][perf_counter_count] )
+{
+  int i, j;
+
+  fprintf( file, "  Counters:     " );
+  for( j = 0; j < perf_counter_count; j++ ) {
+    if( perfCountersAvailable( j ) ) {
+      fprintf( file, " %13s", perfCounterName( j ) );
+    }
+  }
+  bool ipc = perfCountersAvailable( perf_cycles ) && perfCountersAvailable( perf_instructions );
+  if( ipc ) {
+    fprintf( file, "  ipc" );
+  }
+  fprintf( file, "\n" );
+
+  for( i = 0; i < phase_count; i++ ) {
+    if( count[i] == 0 ) {
+      continue;
+    }
+    fprintf( file, "    %-12s", phaseNames[i] );
+    for( j = 0; j < perf_counter_count; j++ ) {
+      if( perfCountersAvailable( j ) ) {
+	fprintf( file, "     " );
+	printCount( file, counters[i][j] );
+      }
+    }
+    if( ipc ) {
+      uint64_t cycles = counters[i][perf_cycles];
+      fprintf( file, "  %.2f", cycles ? (double)counters[i][perf_instructions] / cycles : 0.0 );
+    }
+    fprintf( file, "\n" );
+  }
+}
+
+void phaseTimerPrintSummary( FILE *file )
+{
+  uint64_t ns[phase_count] = {0, };
+  uint64_t count[phase_count] = {0, };
+  uint64_t counters[phase_count][perf_counter_count] = {{0, }, };
+  phase_buffer_t *buf;
+  int i, j;
+
+  pthread_mutex_lock( &buffersMutex );
+  for( buf = buffers; buf != NULL; buf = buf->next ) {
+    for( i = 0; i < phase_count; i++ ) {
+      ns[i] += buf->ns[i];
+      count[i] += buf->count[i];
+      buf->ns[i] = 0;
+      buf->count[i] = 0;
+      for( j = 0; j < perf_counter_count; j++ ) {
+	counters[i][j] += buf->counters[i][j];
+	buf->counters[i][j] = 0;
+      }
+    }
+  }
+  pthread_mutex_unlock( &buffersMutex );
+
+  // Only phases that actually happened, in ms summed over all threads
+  bool first = true;
+  fprintf( file, "  Phases [ms]:" );
+  for( i = 0; i < phase_count; i++ ) {
+    if( count[i] == 0 ) {
+      continue;
+    }
+    fprintf( file, "%s %s %.1f", first ? "" : ",", phaseNames[i], ns[i] * 1e-6 );
+    first = false;
+  }
+  fprintf( file, "\n" );
+
+  if( perfCountersEnabled() ) {
+    printCounters( file, count, counters );
+  }
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef PHASETIMER_H
+#define PHASETIMER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "perfcounters.h"
+
+// Accumulates the time the trainers spend in each phase of a generation.
+//  Every thread adds to its own buffer, the buffers are summed when the
+//  summary is printed.  When perfCountersEnable() succeeded the hardware
+//  counters are read at the same boundaries and summed per phase too.  Built
+//  with ENABLE_PHASE_TIMERS (make PHASE_TIMERS=1), without it every macro below
+//  expands to nothing.
+typedef enum phase_e {
+  phase_create_game,
+  phase_simulate,
+  phase_draw,
+  phase_copy_frame,
+  // One phase per network layer, use PHASE_LAYER() to get the right one
+  phase_layer,
+  phase_layer_last = phase_layer + 7,
+  phase_score,
+  phase_respawn,
+  phase_save,
+
+  phase_count
+} phase_t;
+
+// Phase of network layer <layer>, deeper layers share the last one
+#define PHASE_LAYER( __layer__ ) \
+  ((__layer__) < phase_layer_last - phase_layer ? (phase_t)(phase_layer + (__layer__)) : phase_layer_last)
+
+#ifdef ENABLE_PHASE_TIMERS
+
+typedef struct phase_mark_s {
+  uint64_t      ns;
+  perf_values_t counters;
+} phase_mark_t;
+
+// Remember the time and counters at the start of a phase in <mark>.
+void phaseTimerBegin( phase_mark_t *mark );
+
+// Add everything since phaseTimerBegin( <mark> ) to <phase> in the calling
+//  thread's buffer.
+void phaseTimerEnd( phase_mark_t *mark, phase_t phase );
+
+// Print the time spent in each phase since the last summary, summed over all
+//  threads, as a single line to <file> and start over.  With counters enabled
+//  a line per phase with the counter values follows.  Only call this while
+//  the other threads aren't timing anything, e.g. between generations.
+void phaseTimerPrintSummary( FILE *file );
+
+#  define PHASE_BEGIN( __mark__ ) phase_mark_t __mark__; phaseTimerBegin( &(__mark__) )
+#  define PHASE_END( __mark__, __phase__ ) phaseTimerEnd( &(__mark__), (__phase__) )
+#  define PHASE_SUMMARY( __file__ ) phaseTimerPrintSummary( __file__ )
+
+#else
+
+#  define PHASE_BEGIN( __start__ )
+#  define PHASE_END( __start__, __phase__ )
+#  define PHASE_SUMMARY( __file__ )
+
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <string.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <float.h>
@@ -14,12 +15,36 @@
 
 #include "arkanoid.h"
 #include "network.h"
+#include "topologies.h"
 #include "population.h"
+#include "checkpoint.h"
+#include "phasetimer.h"
+#include "perfcounters.h"
+#include "trace.h"
+#include "replay.h"
 #include "jobhandler.h"
 #include "progress.h"
 
 #define FILENAME_LEN 100
 
+#define FAST_ACTIVATIONS 256
+#define BENCHMARK 257
+#define PERF_COUNTERS 258
+#define TRACE 259
+#define SENSOR_SCALE 260
+#define U8_SENSOR 261
+#define STATE_SENSOR 262
+#define RECORD 263
+#define ACTION_REPEAT 264
+#define FIXED_POINT 265
+
+// The game every network plays, its options are an arkanoid_options_t
+static const game_interface_t *gameInterface = &arkanoidInterface;
+
+// Defaults used by --benchmark unless given explicitly
+#define BENCHMARK_SEED 0x5eed
+#define BENCHMARK_NETS 10
+
 typedef struct neuron_job_s {
   // Network to run
   ffn_network_t    *network;
@@ -27,6 +52,8 @@ typedef struct neuron_job_s {
   unsigned int  numRounds;
   // Number of game frames to send to network
   unsigned int numFrames;
+  // Number of game steps every output of the network is used for
+  unsigned int actionRepeat;
   // Number of inputs the networks take
   unsigned int numInputs;
   // Which generation this is
@@ -36,8 +63,19 @@ typedef struct neuron_job_s {
   // Number of random bits to add to input array
   unsigned int  numRandom;
 
+  // Index of the network in the population
+  unsigned int  individual;
+  // Options for every game played
+  arkanoid_options_t gameOptions;
+  // Index of the game sensor the network sees
+  uint32_t      sensor;
+  // One per round to record the games in, NULL when they aren't recorded
+  replay_episode_t *episodes;
+
   // Place to save the score of the network
   unsigned int *score;
+  // Place to save the number of game frames played
+  uint64_t     *frames;
 
   // Signal indicating if the task should stop running a network and pick a new job
   bool         *stop;
@@ -46,8 +84,61 @@ typedef struct neuron_job_s {
   bool         *done;
 } neuron_job_t;
 
+// What a training thread keeps from one job to the next, so that playing
+//  games doesn't allocate anything once the first job is done.  A single game
+//  is enough as a thread only plays one at a time.
+typedef struct worker_s {
+  // Reset for every round, created with gameOptions
+  game_t       *game;
+  arkanoid_options_t gameOptions;
+  // Network inputs, room for numInputs of whichever the sensor needs
+  float        *ffwData;
+  uint8_t      *ffwBytes;
+  uint64_t      numInputs;
+} worker_t;
+
+// Everything a training run needs except for the number of threads
+typedef struct train_params_s {
+  // Place to store network definitions
+  char          *outputFolder;
+  unsigned long  runningSeed;
+  int            numCheckpointThreads;
+  unsigned int   numNets;
+  unsigned int   numRounds;
+  // Game steps every output of a network is used for
+  unsigned int   actionRepeat;
+  unsigned int   firstGeneration;
+  unsigned int   numGenerations;
+  // Options for every game played, e.g. the size of the screen sensor
+  arkanoid_options_t gameOptions;
+  // Name of the game sensor the networks see
+  const char    *sensorName;
+  // Replay log to record the games of the best network in every generation
+  //  to, NULL when nothing is recorded
+  char          *recordFile;
+  // Network definition files used to initialise the first generation
+  int            numFiles;
+  char         **files;
+} train_params_t;
+
+// What a training run spent its time on, used by the benchmark mode
+typedef struct train_stats_s {
+  uint64_t networks;
+  uint64_t frames;
+  double   wallTime;
+  double   evalTime;
+  double   respawnTime;
+  double   checkpointTime;
+  // Hash of every score in every generation
+  uint64_t checksum;
+} train_stats_t;
+
 static bool saveAllNetsAndQuit = false;
 static bool started = false;
+// Tells the training threads to quit once the job queue is empty
+static bool stopThreads = false;
+// Progress is only printed outside of the benchmark mode
+static bool verbose = true;
 
 static pthread_mutex_t net_mutex;
 
@@ -61,6 +152,17 @@ static const struct option *getOptlist()
     {"networks",      required_argument, NULL, 'n'},
     {"rounds",        required_argument, NULL, 'r'},
     {"output-folder", required_argument, NULL, 'o'},
+    {"checkpoint-threads", required_argument, NULL, 'c'},
+    {"fast-activations", no_argument,     NULL, FAST_ACTIVATIONS},
+    {"benchmark",     required_argument, NULL, BENCHMARK},
+    {"perf-counters", no_argument,       NULL, PERF_COUNTERS},
+    {"trace",         required_argument, NULL, TRACE},
+    {"sensor-scale",  required_argument, NULL, SENSOR_SCALE},
+    {"u8-sensor",     no_argument,       NULL, U8_SENSOR},
+    {"state-sensor",  no_argument,       NULL, STATE_SENSOR},
+    {"record",        required_argument, NULL, RECORD},
+    {"action-repeat", required_argument, NULL, ACTION_REPEAT},
+    {"fixed-point",   no_argument,       NULL, FIXED_POINT},
 
     {"help",          no_argument,       NULL, 'h'},
     {0, 0, 0, 0}
@@ -79,8 +181,53 @@ static void sigintHandler( int signal )
   }
 }
 
-static void update(game_t* game, input_t input) {
-  game->_update(game, input);
+// Play <repeat> steps with <input>, returns the number of steps played.
+//  Arkanoid skips over stretches where the ball flies freely.
+static uint32_t update(game_t* game, input_t input, uint32_t repeat) {
+  PHASE_BEGIN( simStart );
+  uint32_t steps = gameStep(game, input, repeat);
+  PHASE_END( simStart, phase_simulate );
+  return steps;
+}
+
+// The screen is only painted when it's asked for, so that's where drawing is
+//  timed
+static const sensor_t *getSensor( game_t *game, uint32_t index )
+{
+  PHASE_BEGIN( drawStart );
+  const sensor_t *sensor = gameGetSensor( game, index );
+  PHASE_END( drawStart, phase_draw );
+  return sensor;
+}
+
+// Same as ffnNetworkRun() but with every layer timed when enabled
+static void runNetwork( ffn_network_t *network, float *inputs )
+{
+#ifdef ENABLE_PHASE_TIMERS
+  uint64_t lay;
+  for( lay = 0; lay < ffnNetworkGetNumLayers( network ); lay++ ) {
+    PHASE_BEGIN( start );
+    ffnNetworkRunLayer( network, lay, inputs );
+    PHASE_END( start, PHASE_LAYER( lay ) );
+  }
+#else
+  ffnNetworkRun( network, inputs );
+#endif
+}
+
+// Same as runNetwork() for byte inputs from a uint8 sensor
+static void runNetworkU8( ffn_network_t *network, const uint8_t *inputs, float scale )
+{
+#ifdef ENABLE_PHASE_TIMERS
+  uint64_t lay;
+  for( lay = 0; lay < ffnNetworkGetNumLayers( network ); lay++ ) {
+    PHASE_BEGIN( start );
+    ffnNetworkRunLayerU8( network, lay, inputs, scale );
+    PHASE_END( start, PHASE_LAYER( lay ) );
+  }
+#else
+  ffnNetworkRunU8( network, inputs, scale );
+#endif
 }
 
 static void usage( char *progname )
@@ -91,13 +238,42 @@ static void usage( char *progname )
   printf( "File arguments will be loaded as neural networks and used to initialise\n"
 	  "the first generation of the population.\n\n" );
   printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
-  printf( "  -t, --threads=INT          number of parallel threads to run\n" );
+  printf( "  -t, --threads=INT          number of parallel threads to run, 1 unless given\n"
+	  "                             except for --benchmark\n" );
   printf( "  -s, --seed=HEX             seed value for random generator. \n"
 	  "                             useful to replicate previous results\n" );
   printf( "  -g, --generations=INT      number of generations to train for\n" );
   printf( "  -f, --first-gen=INT        generation to begin at, useful for resuming\n" );
   printf( "  -n, --networks=INT         networks per population\n" );
   printf( "  -r, --rounds=INT           game rounds each network should play per generation.\n" );
+  printf( "  -o, --output-folder=DIR    folder to save networks in\n" );
+  printf( "  -c, --checkpoint-threads=INT\n"
+	  "                             number of background threads writing networks to disk\n" );
+  printf( "      --fast-activations     use lookup tables instead of libm for activation\n"
+	  "                             functions, see activation.h for the errors\n" );
+  printf( "      --benchmark=INT        train for INT generations with 1, 2, 4 ... up to\n"
+	  "                             --threads threads (defaults to the number of cores)\n"
+	  "                             and report the throughput as JSON.  Uses seed %x\n"
+	  "                             and %d networks unless given\n", BENCHMARK_SEED, BENCHMARK_NETS );
+  printf( "      --perf-counters        add cycles, instructions, cache and dTLB misses to\n"
+	  "                             the phase timings, needs a PHASE_TIMERS=1 build\n" );
+  printf( "      --trace=FILE           write what every thread is doing to FILE as Chrome\n"
+	  "                             trace-event JSON\n" );
+  printf( "      --sensor-scale=INT     shrink the screen the networks see INT times in each\n"
+	  "                             direction by averaging pixels, has to divide 640 and\n"
+	  "                             480.  Networks trained at one scale can't be used at\n"
+	  "                             another\n" );
+  printf( "      --u8-sensor            give the networks the screen as bytes instead of\n"
+	  "                             floats, a quarter of the memory traffic\n" );
+  printf( "      --state-sensor         give the networks positions, speeds and block health\n"
+	  "                             instead of the screen, a lot smaller and faster\n" );
+  printf( "      --record=FILE          record the games of the best network in every\n"
+	  "                             generation to FILE, see render --replay\n" );
+  printf( "      --action-repeat=INT    play INT game steps with every output of a network,\n"
+	  "                             which runs the networks INT times less often at the\n"
+	  "                             cost of coarser control.  Defaults to 1\n" );
+  printf( "      --fixed-point          play with integer physics, which come out the same\n"
+	  "                             with any build of the trainer\n" );
 
   printf( "  -h, --help                 display this message and exit\n" );
 }
@@ -117,7 +293,7 @@ static bool isNetworkCorrect( ffn_network_t *net, ffn_layer_params_t *lp )
 }
 
 // individual == -1 means save all, otherwise save only specified individual
-static void savePopulation( char *folder, population_t *population, int individual, unsigned int generation, unsigned int seed, unsigned int rounds )
+static void savePopulation( checkpoint_writer_t *writer, char *folder, population_t *population, int individual, unsigned int generation, unsigned int seed, unsigned int rounds )
 {
 #define SAVE_NET_FORMAT "%s/0x%08x_0x%08x_%d_%f.ffw"
   char filename[FILENAME_LEN];
@@ -127,28 +303,125 @@ static void savePopulation( char *folder, population_t *population, int individu
       sprintf( filename, SAVE_NET_FORMAT,
 	       folder,
 	       generation, seed, i, populationGetScore( population, i ) / rounds );
-      ffnNetworkSaveFile( populationGetIndividual( population, i ), filename );
+      if( !checkpointWriterSave( writer, populationGetIndividual( population, i ), filename ) ) {
+	fprintf( stderr, "Unable to queue network for saving to %s\n", filename );
+      }
     }
   } else {
     sprintf( filename, SAVE_NET_FORMAT,
 	     folder,
 	     generation, seed, individual, populationGetScore( population, individual ) / rounds );
-    ffnNetworkSaveFile( populationGetIndividual( population, individual ), filename );
+    if( !checkpointWriterSave( writer, populationGetIndividual( population, individual ), filename ) ) {
+      fprintf( stderr, "Unable to queue network for saving to %s\n", filename );
+    }
+  }
+}
+
+
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// FNV-1a, used to compare scores between benchmark runs
+static uint64_t hashScore( uint64_t hash, uint32_t score )
+{
+  int i;
+  for( i = 0; i < 4; i++ ) {
+    hash ^= (score >> (8 * i)) & 0xff;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static void freeWorker( worker_t *worker )
+{
+  if( worker->game != NULL ) {
+    gameDestroy( worker->game );
+  }
+  free( worker->ffwData );
+  free( worker->ffwBytes );
+  bzero( worker, sizeof(*worker) );
+}
+
+// Field by field since padding isn't necessarily copied with the struct
+static bool optionsEqual( const arkanoid_options_t *a, const arkanoid_options_t *b )
+{
+  return a->flags == b->flags &&
+    a->full_redraw == b->full_redraw &&
+    a->sensor_scale == b->sensor_scale &&
+    a->sensor_type == b->sensor_type &&
+    a->fixed_point == b->fixed_point;
+}
+
+// Make sure <worker> has a game with <gameOptions> and room for <numInputs>
+//  network inputs, the old ones are kept when they'll do.  The inputs are
+//  cleared.  Returns false if anything can't be allocated.
+static bool prepareWorker( worker_t *worker, const arkanoid_options_t *gameOptions, uint64_t numInputs )
+{
+  if( worker->game == NULL || worker->numInputs != numInputs ||
+      !optionsEqual( &worker->gameOptions, gameOptions ) ) {
+    freeWorker( worker );
+
+    worker->game = gameCreate( gameInterface, -1, 0, gameOptions );
+    // A uint8 screen is fed to the network as it is, random values included
+    if( gameOptions->sensor_type == sensor_type_uint8 ) {
+      worker->ffwBytes = calloc( numInputs, sizeof(uint8_t) );
+    } else {
+      worker->ffwData = calloc( numInputs, sizeof(float) );
+    }
+    if( worker->game == NULL || (worker->ffwData == NULL && worker->ffwBytes == NULL) ) {
+      freeWorker( worker );
+      return false;
+    }
+    worker->gameOptions = *gameOptions;
+    worker->numInputs = numInputs;
+  } else if( worker->ffwBytes != NULL ) {
+    bzero( worker->ffwBytes, numInputs );
+  } else {
+    bzero( worker->ffwData, sizeof(float) * numInputs );
   }
+
+  return true;
 }
 
-static double playNetwork( ffn_network_t *network,
-			   uint64_t numFrames,  uint64_t numInputs,
+// Start the game of <worker> over with <seed>.  Games without GAME_CAP_RESET
+//  are replaced with a new one with the same options.
+static bool resetWorkerGame( worker_t *worker, unsigned int seed )
+{
+  if( gameInterface->capabilities & GAME_CAP_RESET ) {
+    gameReset( worker->game, seed );
+    return true;
+  }
+
+  gameDestroy( worker->game );
+  worker->game = gameCreate( gameInterface, -1, seed, &worker->gameOptions );
+  return worker->game != NULL;
+}
+
+static double playNetwork( worker_t *worker, ffn_network_t *network,
+			   uint64_t numFrames,  uint64_t numInputs, unsigned int actionRepeat,
 			   unsigned int generation, unsigned int seed,
 			   unsigned int numRounds, uint64_t numRandom,
-			   bool *stopFlag )
+			   const arkanoid_options_t *gameOptions, uint32_t sensor,
+			   replay_episode_t *episodes,
+			   bool *stopFlag, uint64_t *framesPlayed )
 {
-  game_t *game;
   input_t inputs = {0, };
-  float *ffwData = malloc(numInputs * sizeof(float));
-  bzero( ffwData, numInputs * sizeof(float) );
   double netScore = 0;
 
+  *framesPlayed = 0;
+
+  if( !prepareWorker( worker, gameOptions, numInputs ) ) {
+    fprintf( stderr, "Can't create game\n" );
+    return -1;
+  }
+  game_t *game = worker->game;
+  float *ffwData = worker->ffwData;
+  uint8_t *ffwBytes = worker->ffwBytes;
+
   unsigned int localSeed = seed + generation;
 
   int round;
@@ -160,33 +433,72 @@ static double playNetwork( ffn_network_t *network,
       break;
     }
 
-    // Create a new game for this player
-    game = createArkanoid( -1, rand_r( &localSeed ) );
-    if (game == NULL) {
+    // Time spent in the network is only traced per round, a span per frame
+    //  would drown everything else
+    uint64_t roundStart = traceNow();
+    uint64_t networkTime = 0;
+
+    // Start a new game for this player
+    PHASE_BEGIN( createStart );
+    unsigned int gameSeed = rand_r( &localSeed );
+    if( !resetWorkerGame( worker, gameSeed ) ) {
       fprintf( stderr, "Can't create game\n" );
-      free( ffwData );
       return -1;
     }
+    game = worker->game;
+    PHASE_END( createStart, phase_create_game );
+
+    replay_episode_t *episode = episodes != NULL ? &episodes[round] : NULL;
+    if( episode != NULL ) {
+      replayEpisodeBegin( episode, gameSeed, -1, gameOptions->fixed_point );
+    }
 
     while (game->game_over == false) {
       uint64_t i;
+      float scale = game->sensors[sensor].scale;
 
+      PHASE_BEGIN( copyStart );
       // Give network some random values to play with
       for( i = 0; i < numRandom; i++ ) {
-	ffwData[i] = rand_r( &localSeed ) / (float)RAND_MAX;
+	float value = rand_r( &localSeed ) / (float)RAND_MAX;
+	if( ffwBytes != NULL ) {
+	  ffwBytes[i] = value / scale + 0.5f;
+	} else {
+	  ffwData[i] = value;
+	}
       }
 
       // Copy last frame in order to track movement
-      unsigned int size = game->sensors[0].height * game->sensors[0].width;
+      unsigned int size = game->sensors[sensor].height * game->sensors[sensor].width;
       for( i = 0; i+1 < numFrames; i++ ) {
-	memcpy( &ffwData[numRandom + i * size], &ffwData[numRandom + (i+1) * size], size );
+	if( ffwBytes != NULL ) {
+	  memcpy( &ffwBytes[numRandom + i * size], &ffwBytes[numRandom + (i+1) * size], size );
+	} else {
+	  memcpy( &ffwData[numRandom + i * size], &ffwData[numRandom + (i+1) * size], size * sizeof(float) );
+	}
       }
+      PHASE_END( copyStart, phase_copy_frame );
+
       // Fetch new frame
-      memcpy( &ffwData[numRandom + i * size], game->sensors[0].data, size );
+      const sensor_t *frame = getSensor( game, sensor );
+      PHASE_BEGIN( fetchStart );
+      if( ffwBytes != NULL ) {
+	memcpy( &ffwBytes[numRandom + i * size], frame->data_u8, size );
+      } else {
+	memcpy( &ffwData[numRandom + i * size], frame->data, size * sizeof(float) );
+      }
+      PHASE_END( fetchStart, phase_copy_frame );
 
       // Add AI here
-      ffnNetworkRun( network, ffwData );
+      uint64_t networkStart = traceNow();
+      if( ffwBytes != NULL ) {
+	runNetworkU8( network, ffwBytes, scale );
+      } else {
+	runNetwork( network, ffwData );
+      }
+      networkTime += traceNow() - networkStart;
 
+      PHASE_BEGIN( scoreStart );
       float tmpOutput = ffnNetworkGetOutputValue( network, 0 );
       if( tmpOutput > 0 ) {
 	inputs.left  = tmpOutput;
@@ -198,129 +510,158 @@ static double playNetwork( ffn_network_t *network,
 	inputs.left  = 0;
 	inputs.right = 0;
       }
+      PHASE_END( scoreStart, phase_score );
+
+      // Send input to game, the screen is only painted for the last step
+      uint32_t steps = update( game, inputs, actionRepeat );
+      (*framesPlayed) += steps;
 
-      // Send input to game
-      update( game, inputs );
+      if( episode != NULL && !replayEpisodeAddInput( episode, inputs, steps ) ) {
+	fprintf( stderr, "Can't record game, out of memory\n" );
+	replayEpisodeFree( episode );
+	episode = NULL;
+      }
     } // End of game loop
 
+    if( episode != NULL ) {
+      episode->score = game->score;
+    }
     netScore += game->score;
-    // Destroy game so we can begin anew with next round
-    destroyArkanoid( game );
+    traceSpan( "round", roundStart, traceNow(), "network_us", networkTime / 1000 );
   }
 
-  free(ffwData);
   return netScore;
 }
 
+// Write the games <job> recorded in <generation> to <file>
+static bool recordGames( replay_file_t *file, const neuron_job_t *job, unsigned long seed, unsigned long generation )
+{
+  unsigned int round;
+  for( round = 0; round < job->numRounds; round++ ) {
+    replay_episode_t *episode = &job->episodes[round];
+
+    // Games that ran out of memory while recording are left out
+    if( episode->numFrames == 0 ) {
+      continue;
+    }
+
+    episode->seed = seed;
+    episode->generation = generation;
+    episode->individual = job->individual;
+    episode->round = round;
+    if( !replayWrite( file, episode ) ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 static void *train_thread( void *arg )
 {
   jobHandler *jh = arg;
+  worker_t worker = {0, };
+
+  if( verbose ) {
+    printf( "Thread started!\n" );
+  }
 
-  printf( "Thread started!\n" );
+  // Polls that didn't get a job are merged into a single idle span
+  uint64_t idleStart = 0;
+  uint64_t numPolls = 0;
 
   while( 1 ) {
+    uint64_t pollStart = traceNow();
     neuron_job_t *job = jobHandlerGetJob( jh );
     if( job != NULL ) {
-      double score = playNetwork( job->network,
-				  job->numFrames, job->numInputs,
+      uint64_t jobStart = traceNow();
+      if( numPolls > 0 ) {
+	traceSpan( "idle", idleStart, pollStart, "polls", numPolls );
+	numPolls = 0;
+      }
+      traceSpan( "dequeue", pollStart, jobStart, NULL, 0 );
+
+      uint64_t frames;
+      double score = playNetwork( &worker, job->network,
+				  job->numFrames, job->numInputs, job->actionRepeat,
 				  job->generation, job->seed,
 				  job->numRounds, job->numRandom,
-				  job->stop );
+				  &job->gameOptions, job->sensor, job->episodes,
+				  job->stop, &frames );
 
       pthread_mutex_lock( &net_mutex );
       *(job->score) = score;
+      *(job->frames) = frames;
       *(job->done) = true;
       pthread_mutex_unlock( &net_mutex );
+      traceSpan( "job", jobStart, traceNow(), "network", job->individual );
       free( job );
-    } else if( saveAllNetsAndQuit == true ) {
+    } else if( saveAllNetsAndQuit == true || stopThreads == true ) {
       // If no job left and quit flag is set, quit
       break;
+    } else if( numPolls++ == 0 ) {
+      idleStart = pollStart;
     }
   }
+  if( numPolls > 0 ) {
+    traceSpan( "idle", idleStart, traceNow(), "polls", numPolls );
+  }
+  freeWorker( &worker );
 
-  printf( "Thread stopping!\n" );
+  if( verbose ) {
+    printf( "Thread stopping!\n" );
+  }
   return NULL;
 }
 
-int main( int argc, char *argv[] )
+// Train a population for the generations given in <params> on <numThreads>
+//  threads.  Fills in <stats> if it isn't NULL.  Returns 0 on success.
+static int train( const train_params_t *params, int numThreads, train_stats_t *stats )
 {
-  // Place to store network definitions
-  char *outputFolder = ".";
-  // Get some better randomness going
-  srand((unsigned)(time(NULL)));
-  unsigned long runningSeed = rand();
-  // Number of concurrent threads to run
-  int numThreads = 1;
-  // Number of networks in a population
-  unsigned int numNets = 75;
-  // Number of games played by each network in a generation
-  unsigned int numRounds = 20;
-  // Number of generations to play before stopping
-  unsigned int numGenerations = 2000;
-  // Which generation to begin with, useful when resuming training
-  unsigned int firstGeneration = 0;
-
-  // Register a signal handler that'll save networks when we quit
-  signal( SIGINT, sigintHandler );
-
-  int c;
-  while( (c = getopt_long (argc, argv, "s:t:g:f:n:r:o:h",
-			   getOptlist(), NULL)) != -1 ) {
-    switch(c) {
-    case 's': // Optional
-      runningSeed = strtoul(optarg, NULL, 16);
-      break;
-    case 't': // Optional
-      numThreads = atoi(optarg);
-      break;
-    case 'g': // Optional
-      numGenerations = strtoul(optarg, NULL, 10);
-      break;
-    case 'f': // Optional
-      firstGeneration = strtoul(optarg, NULL, 10);
-      break;
-    case 'n': // Optional
-      numNets = strtoul(optarg, NULL, 10);
-      break;
-    case 'r': // Optional
-      numRounds = strtoul(optarg, NULL, 10);
-      break;
-    case 'o': // Optional
-      outputFolder = optarg;
-      break;
-    case 'h': // Special
-      usage( argv[0] );
-      return 0;
-    }
+  char *outputFolder = params->outputFolder;
+  unsigned long runningSeed = params->runningSeed;
+  unsigned int numNets = params->numNets;
+  unsigned int numRounds = params->numRounds;
+  int ret = 0;
+
+  double startTime = now();
+  if( stats != NULL ) {
+    bzero( stats, sizeof(*stats) );
+    stats->checksum = 0xcbf29ce484222325ULL;
   }
 
   // Temporary game used to get meta data
-  game_t *game = createArkanoid( -1, 0 );
+  game_t *game = gameCreate( gameInterface, -1, 0, &params->gameOptions );
   if (game == NULL) {
     fprintf( stderr, "Can't create game\n" );
     return -1;
   }
 
+  int32_t sensor = gameFindSensor( game, params->sensorName );
+  if( sensor < 0 ) {
+    fprintf( stderr, "The game has no %s sensor\n", params->sensorName );
+    gameDestroy( game );
+    return -1;
+  }
+
   // Number of game frames to send as input to the networks
-  const uint64_t numFrames = 2;
+  const uint64_t numFrames = ARKANOID_NET_FRAMES;
   // Number of random values given to the networks as input
-  const uint64_t numRandom = 5;
+  const uint64_t numRandom = ARKANOID_NET_RANDOM;
   // Number of total inputs in the network
-  const uint64_t numInputs = numFrames*(game->sensors[0].width * game->sensors[0].height) + numRandom;
+  const uint64_t numInputs = ARKANOID_NET_INPUTS( game->sensors[sensor].width * game->sensors[sensor].height );
   // Number of layers, including output layer, used by the networks
-  const uint64_t numLayers = 4;
+  const uint64_t numLayers = ARKANOID_NET_LAYERS;
   // Description of the layers
-  ffn_layer_params_t layerParams[] = {
-    (ffn_layer_params_t) {400, numInputs * 0.05, activation_any},
-    (ffn_layer_params_t) {200,               50, activation_any},
-    (ffn_layer_params_t) { 25,              100, activation_any},
-    (ffn_layer_params_t) {  1,               25, activation_tanh },
-  };
+  ffn_layer_params_t layerParams[ARKANOID_NET_LAYERS];
+  arkanoidLayers( layerParams, numInputs, strcmp( params->sensorName, SENSOR_SCREEN ) == 0 );
   // Destroy the temporary game
-  destroyArkanoid( game );
+  gameDestroy( game );
 
   // Create a population of neural networks
-  printf( "Creating first generation of %u networks\n", numNets );
+  if( verbose ) {
+    printf( "Creating first generation of %u networks\n", numNets );
+  }
   population_t *population = populationCreate( numNets, numInputs, numLayers, layerParams, true );
   if( population == NULL ) {
     fprintf( stderr, "Can't create population\n" );
@@ -334,12 +675,14 @@ int main( int argc, char *argv[] )
   pthread_t *threads = malloc( sizeof(*threads) * numThreads );
   if( !threads ) {
     jobHandlerDestroy( jh );
+    populationDestroy( population );
     return -3;
   }
   for( i = 0; i < numThreads; i++ ) {
     if( pthread_create( &threads[i], NULL, train_thread, jh) != 0 ) {
       free( threads );
       jobHandlerDestroy( jh );
+      populationDestroy( population );
       return -4;
     }
   }
@@ -348,25 +691,30 @@ int main( int argc, char *argv[] )
   if( threadJobs == NULL ) {
     free( threads );
     jobHandlerDestroy( jh );
+    populationDestroy( population );
     return -5;
   }
   for( i = 0; i < numNets; i++ ) {
     threadJobs[i].score      = malloc(sizeof(float));
+    threadJobs[i].frames     = malloc(sizeof(uint64_t));
     threadJobs[i].stop       = malloc(sizeof(bool));
     threadJobs[i].done       = malloc(sizeof(bool));
+    threadJobs[i].episodes   = NULL;
   }
 
-  // Get the rest of the arguments since they might be networks
+  // Add the networks given on the command line
+  int f;
   i = 0;
-  for( ; optind < argc && i < population->size; optind++ ) {
+  for( f = 0; f < params->numFiles && i < population->size; f++ ) {
     // Regular arguments, network definition files to seed with
-    printf( "Using file %s\n", argv[optind] );
+    printf( "Using file %s\n", params->files[f] );
 
     // Add networks to population
-    ffn_network_t *tmp = ffnNetworkLoadFile( argv[optind] );
+    ffn_network_t *tmp = ffnNetworkLoadFile( params->files[f] );
     if( tmp != NULL ) {
       // Only add networks that can successfully mate with the ones we already have
-      if( (ffnNetworkGetNumInputs( tmp ) == numInputs) &&
+      if( !ffnNetworkIsPruned( tmp ) &&
+	  (ffnNetworkGetNumInputs( tmp ) == numInputs) &&
 	  (ffnNetworkGetNumLayers( tmp ) == numLayers) &&
 	  isNetworkCorrect( tmp, layerParams ) ) {
 	printf( "Adding network\n" );
@@ -378,7 +726,35 @@ int main( int argc, char *argv[] )
     }
   }
 
-  pthread_mutex_init( &net_mutex, NULL );
+  replay_file_t *replayFile = NULL;
+
+  // Networks are written in the background while the next generation is
+  //  evaluated.  The queue is kept short so saving blocks once the writers fall
+  //  behind instead of holding a snapshot of every network in memory.
+  checkpoint_writer_t *checkpointWriter = checkpointWriterCreate( params->numCheckpointThreads, 2 * params->numCheckpointThreads );
+  if( checkpointWriter == NULL ) {
+    fprintf( stderr, "Can't create checkpoint writer\n" );
+    ret = -6;
+    goto cleanup;
+  }
+
+  // Every network records its games, only the best ones are kept
+  if( params->recordFile != NULL ) {
+    replayFile = replayCreate( params->recordFile );
+    if( replayFile == NULL ) {
+      fprintf( stderr, "Can't create replay log %s\n", params->recordFile );
+      ret = -8;
+      goto cleanup;
+    }
+    for( i = 0; i < numNets; i++ ) {
+      threadJobs[i].episodes = calloc( numRounds, sizeof(replay_episode_t) );
+      if( threadJobs[i].episodes == NULL ) {
+	fprintf( stderr, "Can't allocate recordings\n" );
+	ret = -8;
+	goto cleanup;
+      }
+    }
+  }
 
   double bestScore;
   int    bestNet;
@@ -388,11 +764,15 @@ int main( int argc, char *argv[] )
 
   started = true;
   unsigned long generation;
-  for( generation = firstGeneration; generation < numGenerations; generation++ ) {
+  for( generation = params->firstGeneration; generation < params->numGenerations; generation++ ) {
     bestScore = minimise ? DBL_MAX : -DBL_MAX;
     bestNet = -1;
 
-    printf( "Generation %lu\n", generation );
+    if( verbose ) {
+      printf( "Generation %lu\n", generation );
+    }
+    double evalStart = now();
+    uint64_t traceEvalStart = traceNow();
 
     populationClearScores( population );
     int n;
@@ -401,13 +781,18 @@ int main( int argc, char *argv[] )
       pthread_mutex_lock( &net_mutex );
       for( n = 0; n < population->size; n++ ) {
 	threadJobs[n].network    = populationGetIndividual( population, n );
+	threadJobs[n].individual = n;
+	threadJobs[n].gameOptions = params->gameOptions;
+	threadJobs[n].sensor     = sensor;
 	threadJobs[n].numRounds  = numRounds;
 	threadJobs[n].numFrames  = numFrames;
+	threadJobs[n].actionRepeat = params->actionRepeat;
 	threadJobs[n].numInputs  = numInputs;
 	threadJobs[n].generation = generation;
 	threadJobs[n].seed       = runningSeed;
 	threadJobs[n].numRandom  = numRandom;
 	*(threadJobs[n].score)   = 0;
+	*(threadJobs[n].frames)  = 0;
 	*(threadJobs[n].stop)    = false;
 	*(threadJobs[n].done)    = false;
 
@@ -441,12 +826,8 @@ int main( int argc, char *argv[] )
 	}
 
 	printf( "Saving all networks and quitting\n" );
-	savePopulation( outputFolder, population, -1, generation, runningSeed, numRounds );
-
-	free( threadJobs );
-	free( threads );
-	jobHandlerDestroy( jh );
-	return 0;
+	savePopulation( checkpointWriter, outputFolder, population, -1, generation, runningSeed, numRounds );
+	goto cleanup;
       }
 
       // See if there are any nets that aren't ready yet and wait for them to complete
@@ -460,7 +841,9 @@ int main( int argc, char *argv[] )
 
       if( readyCount > numReady ) {
 	for( ; numReady < readyCount; numReady++ ) {
-	  printf( "." ); fflush(stdout);
+	  if( verbose ) {
+	    printf( "." ); fflush(stdout);
+	  }
 	}
       }
 
@@ -471,7 +854,9 @@ int main( int argc, char *argv[] )
       usleep( 10000 );
     }
 
-    printf( "\n" );
+    if( verbose ) {
+      printf( "\n" );
+    }
 
     // All threads are done, tally up results and evolve
     for( n = 0; n < population->size; n++ ) {
@@ -488,21 +873,316 @@ int main( int argc, char *argv[] )
 
       populationSetScore( population, n, netScore );
 
-      printf( " - %f / %u (%f)\n", netScore, numRounds, netScore / (double)(numRounds) );
+      if( stats != NULL ) {
+	stats->frames += *(threadJobs[n].frames);
+	stats->checksum = hashScore( stats->checksum, *(threadJobs[n].score) );
+      }
+
+      if( verbose ) {
+	printf( " - %f / %u (%f)\n", netScore, numRounds, netScore / (double)(numRounds) );
+      }
     } // End of population loop
 
-    printf( "  Best score: %f (%f)\n", bestScore, bestScore / (double)(numRounds) );
+    if( verbose ) {
+      printf( "  Best score: %f (%f)\n", bestScore, bestScore / (double)(numRounds) );
+    }
 
-    // Save the best net here
-    savePopulation( outputFolder, population, bestNet, generation, runningSeed, numRounds );
+    if( replayFile != NULL && !recordGames( replayFile, &threadJobs[bestNet], runningSeed, generation ) ) {
+      fprintf( stderr, "Can't write to replay log %s\n", params->recordFile );
+      ret = -8;
+      goto cleanup;
+    }
+    double evalEnd = now();
 
+    // Save the best net here
+    uint64_t traceSaveStart = traceNow();
+    traceSpan( "evaluate", traceEvalStart, traceSaveStart, "generation", generation );
+    PHASE_BEGIN( saveStart );
+    savePopulation( checkpointWriter, outputFolder, population, bestNet, generation, runningSeed, numRounds );
+    PHASE_END( saveStart, phase_save );
+    uint64_t traceRespawnStart = traceNow();
+    traceSpan( "save", traceSaveStart, traceRespawnStart, NULL, 0 );
+    double saveEnd = now();
+
+    PHASE_BEGIN( respawnStart );
     populationRespawn( population, minimise );
+    PHASE_END( respawnStart, phase_respawn );
+    traceSpan( "respawn", traceRespawnStart, traceNow(), NULL, 0 );
+    double respawnEnd = now();
+
+    if( verbose ) {
+      PHASE_SUMMARY( stdout );
+    }
+
+    if( stats != NULL ) {
+      stats->networks += population->size;
+      stats->evalTime += evalEnd - evalStart;
+      stats->checkpointTime += saveEnd - evalEnd;
+      stats->respawnTime += respawnEnd - saveEnd;
+    }
   }
 
-  populationDestroy( population );
-  
+ cleanup:
+  if( replayFile != NULL && !replayClose( replayFile ) ) {
+    fprintf( stderr, "Can't write to replay log %s\n", params->recordFile );
+    ret = -8;
+  }
+
+  // Make sure everything has reached the disk before returning
+  if( checkpointWriter != NULL ) {
+    double flushStart = now();
+    checkpointWriterFlush( checkpointWriter );
+    if( stats != NULL ) {
+      stats->checkpointTime += now() - flushStart;
+    }
+    checkpointWriterDestroy( checkpointWriter );
+  }
+
+  // The queue is empty by now, so the threads quit right away
+  stopThreads = true;
+  for( i = 0; i < numThreads; i++ ) {
+    pthread_join( threads[i], NULL );
+  }
+  stopThreads = false;
+
+  for( i = 0; i < numNets; i++ ) {
+    free( threadJobs[i].score );
+    free( threadJobs[i].frames );
+    free( threadJobs[i].stop );
+    free( threadJobs[i].done );
+    if( threadJobs[i].episodes != NULL ) {
+      unsigned int round;
+      for( round = 0; round < numRounds; round++ ) {
+	replayEpisodeFree( &threadJobs[i].episodes[round] );
+      }
+      free( threadJobs[i].episodes );
+    }
+  }
   free( threadJobs );
   free( threads );
   jobHandlerDestroy( jh );
+  populationDestroy( population );
+
+  if( stats != NULL ) {
+    stats->wallTime = now() - startTime;
+  }
+
+  return ret;
+}
+
+// Train with 1, 2, 4 ... <maxThreads> threads from the same seed and report
+//  the throughput of each.  Fails if the scores differ between thread counts.
+static int benchmark( train_params_t *params, int maxThreads )
+{
+  uint64_t checksum = 0;
+  bool identical = true;
+
+  verbose = false;
+
+  printf( "{\n  \"benchmark\": \"game\",\n  \"generations\": %u,\n  \"networks\": %u,\n"
+	  "  \"rounds\": %u,\n  \"action_repeat\": %u,\n  \"fixed_point\": %s,\n"
+	  "  \"seed\": \"0x%lx\",\n  \"results\": [\n",
+	  params->numGenerations - params->firstGeneration, params->numNets,
+	  params->numRounds, params->actionRepeat,
+	  params->gameOptions.fixed_point ? "true" : "false", params->runningSeed );
+
+  int numThreads = 1;
+  while( 1 ) {
+    train_stats_t stats;
+
+    // Every run starts from the same population
+    srand( params->runningSeed );
+    int ret = train( params, numThreads, &stats );
+    if( ret != 0 ) {
+      return ret;
+    }
+
+    if( numThreads == 1 ) {
+      checksum = stats.checksum;
+    } else if( stats.checksum != checksum ) {
+      identical = false;
+    }
+
+    printf( "%s    {\"threads\": %d, \"wall_s\": %.3f, \"eval_s\": %.3f, \"respawn_s\": %.3f, "
+	    "\"checkpoint_s\": %.3f, \"networks_per_s\": %.2f, \"frames_per_s\": %.1f, "
+	    "\"checksum\": \"0x%016llx\"}",
+	    numThreads == 1 ? "" : ",\n", numThreads, stats.wallTime, stats.evalTime,
+	    stats.respawnTime, stats.checkpointTime, stats.networks / stats.evalTime,
+	    stats.frames / stats.evalTime, (unsigned long long)stats.checksum );
+    fflush( stdout );
+
+    if( numThreads == maxThreads ) {
+      break;
+    }
+    numThreads *= 2;
+    if( numThreads > maxThreads ) {
+      numThreads = maxThreads;
+    }
+  }
+
+  printf( "\n  ],\n  \"identical\": %s\n}\n", identical ? "true" : "false" );
+  if( !identical ) {
+    fprintf( stderr, "Scores differ between thread counts\n" );
+    return -7;
+  }
+
   return 0;
 }
+
+int main( int argc, char *argv[] )
+{
+  // Get some better randomness going
+  srand((unsigned)(time(NULL)));
+
+  train_params_t params = {
+    .outputFolder         = ".",
+    .runningSeed          = rand(),
+    .numCheckpointThreads = 1,
+    // Number of networks in a population
+    .numNets              = 75,
+    // Number of games played by each network in a generation
+    .numRounds            = 20,
+    // Networks pick a new input for every step
+    .actionRepeat         = 1,
+    // Which generation to begin with, useful when resuming training
+    .firstGeneration      = 0,
+    // Number of generations to play before stopping
+    .numGenerations       = 2000,
+    // The networks look at the screen unless told otherwise
+    .sensorName           = SENSOR_SCREEN,
+  };
+  // Number of concurrent threads to run, 0 when not given, which is one for
+  //  training and one per core for benchmarks
+  int numThreads = 0;
+  // Number of generations to benchmark, 0 means train normally
+  unsigned int benchmarkGenerations = 0;
+  bool seedGiven = false;
+  bool netsGiven = false;
+  int ret;
+
+  // Register a signal handler that'll save networks when we quit
+  signal( SIGINT, sigintHandler );
+
+  int c;
+  while( (c = getopt_long (argc, argv, "s:t:g:f:n:r:c:o:h",
+			   getOptlist(), NULL)) != -1 ) {
+    switch(c) {
+    case 's': // Optional
+      params.runningSeed = strtoul(optarg, NULL, 16);
+      seedGiven = true;
+      break;
+    case 't': // Optional
+      numThreads = atoi(optarg);
+      break;
+    case 'g': // Optional
+      params.numGenerations = strtoul(optarg, NULL, 10);
+      break;
+    case 'f': // Optional
+      params.firstGeneration = strtoul(optarg, NULL, 10);
+      break;
+    case 'n': // Optional
+      params.numNets = strtoul(optarg, NULL, 10);
+      netsGiven = true;
+      break;
+    case 'r': // Optional
+      params.numRounds = strtoul(optarg, NULL, 10);
+      break;
+    case 'o': // Optional
+      params.outputFolder = optarg;
+      break;
+    case 'c': // Optional
+      params.numCheckpointThreads = atoi(optarg);
+      break;
+    case FAST_ACTIVATIONS: // Optional
+      activationSetDefaultMode( activation_mode_fast );
+      break;
+    case BENCHMARK: // Optional
+      benchmarkGenerations = strtoul(optarg, NULL, 10);
+      break;
+    case PERF_COUNTERS: // Optional
+#ifdef ENABLE_PHASE_TIMERS
+      if( !perfCountersEnable() ) {
+	fprintf( stderr, "Performance counters unavailable (%s), continuing without them\n",
+		 strerror( errno ) );
+      }
+#else
+      fprintf( stderr, "Built without PHASE_TIMERS=1, ignoring --perf-counters\n" );
+#endif
+      break;
+    case SENSOR_SCALE: // Optional
+      params.gameOptions.sensor_scale = strtoul(optarg, NULL, 10);
+      if( params.gameOptions.sensor_scale < 1 ||
+	  ARKANOID_SCREEN_WIDTH % params.gameOptions.sensor_scale != 0 ||
+	  ARKANOID_SCREEN_HEIGHT % params.gameOptions.sensor_scale != 0 ) {
+	fprintf( stderr, "Invalid sensor scale %s, it has to divide %d and %d\n",
+		 optarg, ARKANOID_SCREEN_WIDTH, ARKANOID_SCREEN_HEIGHT );
+	return -1;
+      }
+      break;
+    case U8_SENSOR: // Optional
+      params.gameOptions.sensor_type = sensor_type_uint8;
+      break;
+    case STATE_SENSOR: // Optional
+      params.sensorName = SENSOR_STATE;
+      break;
+    case RECORD: // Optional
+      params.recordFile = optarg;
+      break;
+    case ACTION_REPEAT: // Optional
+      params.actionRepeat = strtoul(optarg, NULL, 10);
+      if( params.actionRepeat < 1 ) {
+	params.actionRepeat = 1;
+      }
+      break;
+    case FIXED_POINT: // Optional
+      params.gameOptions.fixed_point = true;
+      break;
+    case TRACE: // Optional
+      if( !traceOpen( optarg ) ) {
+	fprintf( stderr, "Can't write trace to %s\n", optarg );
+	return -1;
+      }
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  // Nothing has to be painted when the networks only look at the state
+  if( strcmp( params.sensorName, SENSOR_STATE ) == 0 ) {
+    if( params.gameOptions.sensor_type != sensor_type_float || params.gameOptions.sensor_scale > 1 ) {
+      fprintf( stderr, "--u8-sensor and --sensor-scale only apply to the screen, ignoring them\n" );
+    }
+    params.gameOptions.sensor_type = sensor_type_float;
+    params.gameOptions.sensor_scale = 0;
+    params.gameOptions.flags |= GAME_FLAG_NO_RENDER;
+  }
+
+  // Get the rest of the arguments since they might be networks
+  params.numFiles = argc - optind;
+  params.files = &argv[optind];
+
+  pthread_mutex_init( &net_mutex, NULL );
+
+  if( benchmarkGenerations > 0 ) {
+    if( !seedGiven ) {
+      params.runningSeed = BENCHMARK_SEED;
+    }
+    if( !netsGiven ) {
+      params.numNets = BENCHMARK_NETS;
+    }
+    params.firstGeneration = 0;
+    params.numGenerations = benchmarkGenerations;
+
+    if( numThreads < 1 ) {
+      numThreads = sysconf( _SC_NPROCESSORS_ONLN );
+    }
+    ret = benchmark( &params, numThreads < 1 ? 1 : numThreads );
+  } else {
+    ret = train( &params, numThreads < 1 ? 1 : numThreads, NULL );
+  }
+
+  traceClose();
+  return ret;
+}
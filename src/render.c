@@ -5,6 +5,7 @@
 #include <math.h>
 #include <time.h>
 #include <strings.h>
+#include <getopt.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -13,13 +14,99 @@
 #include "arkanoid.h"
 #include "canvas.h"
 #include "network.h"
+#include "replay.h"
 
 #define FILENAME_LEN 100
 
+// Same as the trainer, see playNetwork() in player.c
+#define NUM_RANDOM 5
+
 void update(game_t* game, input_t input) {
   game->_update(game, input);
 }
 
+// Put the screen of <game> on <c>
+static void paintCanvas( Canvas *c, game_t *game )
+{
+  const sensor_t *screen = gameGetSensor( game, 0 );
+  int x, y;
+  for (y = 0; y < screen->height; y++) {
+    for (x = 0; x < screen->width; x++) {
+      uint8_t col = (uint8_t)round( screen->data[y * screen->width + x] * 0xff );
+      canvasSetRGB( c, x, y, col, col, col );
+    }
+  }
+}
+
+// Play every game in the replay log <filename> again, or only the ones from
+//  <generation> unless it's negative.  Returns -1 if a game can't be played
+//  or ends with another score than it was recorded with.
+static int replayGames( const char *filename, long generation, long maxFrames, bool saveImages,
+			const arkanoid_options_t *gameOptions )
+{
+  replay_episode_t episode = {0, };
+  char imageFilename[FILENAME_LEN];
+  Canvas *c = NULL;
+  int ret = 0;
+
+  replay_file_t *file = replayOpen( filename );
+  if( file == NULL ) {
+    fprintf( stderr, "Can't open replay log %s\n", filename );
+    return -1;
+  }
+
+  while( replayRead( file, &episode ) ) {
+    if( generation >= 0 && episode.generation != generation ) {
+      continue;
+    }
+
+    arkanoid_options_t episodeOptions = *gameOptions;
+    episodeOptions.fixed_point = episode.fixedPoint;
+    game_t *game = createArkanoidWithOptions( episode.maxRounds, episode.gameSeed, &episodeOptions );
+    if( game == NULL ) {
+      fprintf( stderr, "Can't create game\n" );
+      ret = -1;
+      break;
+    }
+    if( c == NULL ) {
+      c = canvasCreate( game->sensors[0].width, game->sensors[0].height, RGB_888 );
+    }
+
+    long count = 0;
+    uint32_t run;
+    for( run = 0; run < episode.numRuns; run++ ) {
+      input_t input = replayRunInput( &episode.runs[run] );
+      uint32_t i;
+      for( i = 0; i < episode.runs[run].count && !game->game_over &&
+	     (maxFrames < 0 || count < maxFrames); i++ ) {
+	if( saveImages ) {
+	  paintCanvas( c, game );
+	  snprintf( imageFilename, FILENAME_LEN, "brains/replay_%08x_%u_%010ld.jpg",
+		    episode.generation, episode.round, count );
+	  canvasSaveJpeg( c, imageFilename, 255 );
+	}
+	update( game, input );
+	count++;
+      }
+    }
+
+    printf( "Generation %x network %u round %u: %ld frames, score %d\n",
+	    episode.generation, episode.individual, episode.round, count, game->score );
+    if( count == episode.numFrames && game->score != episode.score ) {
+      fprintf( stderr, "The game was recorded with score %d\n", episode.score );
+      ret = -1;
+    }
+    destroyArkanoid( game );
+  }
+
+  if( c != NULL ) {
+    canvasDestroy( c );
+  }
+  replayEpisodeFree( &episode );
+  replayClose( file );
+  return ret;
+}
+
 void createFolderFromFilename( char *filename )
 {
   struct stat st = {0};
@@ -29,15 +116,112 @@ void createFolderFromFilename( char *filename )
   }
 }
 
+static const struct option *getOptlist()
+{
+  static struct option optlist[] = {
+    {"max-frames", required_argument, NULL, 'm'},
+    {"no-images",  no_argument,       NULL, 'n'},
+    {"sensor-scale", required_argument, NULL, 's'},
+    {"replay",     required_argument, NULL, 'r'},
+    {"action-repeat", required_argument, NULL, 'a'},
+    {"fixed-point", no_argument,       NULL, 'x'},
+
+    {"help",       no_argument,       NULL, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  return optlist;
+}
+
+static void usage( char *progname )
+{
+  printf( "Usage: %s [OPTION]... FILE GENERATION SEED\n", progname );
+  printf( "  or:  %s [OPTION]... --replay=LOG [GENERATION]\n", progname );
+  printf( "Let a network play Arkanoid and save every frame to brains/ as a JPEG.\n"
+	  "GENERATION and SEED are hexadecimal and give the game the trainer played\n"
+	  "first with the network.  A replay log recorded by the trainer plays its\n"
+	  "games again without the networks, all of them or only those of GENERATION.\n\n" );
+  printf( "Mandatory arguments to long options are mandatory for short options too.\n" );
+  printf( "  -m, --max-frames=INT       stop after INT frames even if the game isn't over\n" );
+  printf( "  -n, --no-images            play the game without saving any frames\n" );
+  printf( "  -s, --sensor-scale=INT     screen scale the network was trained with\n" );
+  printf( "  -r, --replay=LOG           play the games recorded in LOG with game --record\n" );
+  printf( "  -a, --action-repeat=INT    game steps per network output the network was\n"
+	  "                             trained with\n" );
+  printf( "  -x, --fixed-point          the network was trained with --fixed-point,\n"
+	  "                             replays know this by themselves\n" );
+
+  printf( "  -h, --help                 display this message and exit\n" );
+}
+
 int main( int argc, char *argv[] )
 {
-  char *networkFilename = argv[1];
-  char *strGeneration   = argv[2];
-  char *strRunningSeed  = argv[3];
+  long maxFrames = -1;
+  bool saveImages = true;
+  arkanoid_options_t gameOptions = {0, };
+  char *replayFilename = NULL;
+  uint32_t actionRepeat = 1;
+
+  int opt;
+  while( (opt = getopt_long (argc, argv, "m:ns:r:a:xh",
+			     getOptlist(), NULL)) != -1 ) {
+    switch(opt) {
+    case 'm': // Optional
+      maxFrames = strtol(optarg, NULL, 10);
+      break;
+    case 'n': // Optional
+      saveImages = false;
+      break;
+    case 's': // Optional
+      gameOptions.sensor_scale = strtoul(optarg, NULL, 10);
+      if( gameOptions.sensor_scale < 1 ||
+	  ARKANOID_SCREEN_WIDTH % gameOptions.sensor_scale != 0 ||
+	  ARKANOID_SCREEN_HEIGHT % gameOptions.sensor_scale != 0 ) {
+	fprintf( stderr, "Invalid sensor scale %s, it has to divide %d and %d\n",
+		 optarg, ARKANOID_SCREEN_WIDTH, ARKANOID_SCREEN_HEIGHT );
+	return -1;
+      }
+      break;
+    case 'r': // Optional
+      replayFilename = optarg;
+      break;
+    case 'a': // Optional
+      actionRepeat = strtoul(optarg, NULL, 10);
+      if( actionRepeat < 1 ) {
+	actionRepeat = 1;
+      }
+      break;
+    case 'x': // Optional
+      gameOptions.fixed_point = true;
+      break;
+    case 'h': // Special
+      usage( argv[0] );
+      return 0;
+    }
+  }
+
+  if( replayFilename != NULL ) {
+    if( !saveImages ) {
+      gameOptions.flags |= GAME_FLAG_NO_RENDER;
+    }
+    canvasInit();
+    return replayGames( replayFilename,
+			optind < argc ? (long)strtoul( argv[optind], NULL, 16 ) : -1,
+			maxFrames, saveImages, &gameOptions );
+  }
+
+  if( argc - optind < 3 ) {
+    usage( argv[0] );
+    return -1;
+  }
+
+  char *networkFilename = argv[optind];
+  char *strGeneration   = argv[optind + 1];
+  char *strRunningSeed  = argv[optind + 2];
   unsigned long runningSeed = strtoul( strRunningSeed, NULL, 16 );
   unsigned long generation   = strtoul( strGeneration, NULL, 16 );
 
-  game_t *game = createArkanoid( -1, 0 );
+  game_t *game = createArkanoidWithOptions( -1, 0, &gameOptions );
   input_t inputs = {0, };
 
   if (game == NULL) {
@@ -45,9 +229,6 @@ int main( int argc, char *argv[] )
     return -1;
   }
 
-  // Get some better randomness going
-  srand((unsigned)(time(NULL)));
-
   Canvas *c;
   canvasInit();
   c = canvasCreate( game->sensors[0].width, game->sensors[0].height, RGB_888 );
@@ -61,26 +242,32 @@ int main( int argc, char *argv[] )
   }
 
   uint64_t numInputs = ffnNetworkGetNumInputs( net );
-  uint64_t numRandom = numInputs - 2 * game->sensors[0].width * game->sensors[0].height;
+  uint64_t numRandom = NUM_RANDOM;
 
   float *ffwData = malloc( sizeof(float) * numInputs );
   bzero( ffwData, sizeof(float) * numInputs );
 
   printf( "Inputs: %llu\n", (unsigned long long)numInputs );
 
-  // Create new game with correct seeds
+  if( numInputs != 2 * game->sensors[0].width * game->sensors[0].height + numRandom ) {
+    fprintf( stderr, "The network doesn't look at the screen at this scale\n" );
+    return -1;
+  }
+
+  // Create new game with correct seeds, the random numbers are drawn in the
+  //  same order as the trainer does for the first game of a network
   destroyArkanoid( game );
 
-  srand( runningSeed + generation );
+  unsigned int localSeed = runningSeed + generation;
   int count = 0;
-  game = createArkanoid( -1, rand() );
-  while( game->game_over == false ) {
+  game = createArkanoidWithOptions( -1, rand_r( &localSeed ), &gameOptions );
+  while( game->game_over == false && (maxFrames < 0 || count < maxFrames) ) {
     printf( "Frame %d\n", count );
     uint64_t i;
 
     // Give network some random values to play with
     for( i = 0; i < numRandom; i++ ) {
-      ffwData[i] = rand() / (float)RAND_MAX;
+      ffwData[i] = rand_r( &localSeed ) / (float)RAND_MAX;
     }
 
     // Copy last frame in order to track movement
@@ -88,10 +275,11 @@ int main( int argc, char *argv[] )
       ffwData[i] = ffwData[i + game->sensors[0].height * game->sensors[0].width];
     }
 
+    const sensor_t *screen = gameGetSensor( game, 0 );
     int x, y;
-    for (y = 0; y < game->sensors[0].height; y++) {
-      for (x = 0; x < game->sensors[0].width; x++) {
-	float value = game->sensors[0].data[y * game->sensors[0].width + x];
+    for (y = 0; y < screen->height; y++) {
+      for (x = 0; x < screen->width; x++) {
+	float value = screen->data[y * screen->width + x];
 
 	ffwData[i++] = value;
 	uint8_t col = (uint8_t)round( value * 0xff );
@@ -102,25 +290,29 @@ int main( int argc, char *argv[] )
     // Add AI here
     ffnNetworkRun( net, ffwData );
 
-    inputs.up         = ffnNetworkGetOutputValue( net, 0 );
-    inputs.down       = ffnNetworkGetOutputValue( net, 1 );
-    inputs.left       = ffnNetworkGetOutputValue( net, 2 );
-    inputs.right      = ffnNetworkGetOutputValue( net, 3 );
-    inputs.actions[0] = ffnNetworkGetOutputValue( net, 4 );
-    inputs.actions[1] = ffnNetworkGetOutputValue( net, 5 );
-    inputs.actions[2] = ffnNetworkGetOutputValue( net, 6 );
-    inputs.actions[3] = ffnNetworkGetOutputValue( net, 7 );
-
-
-    // Send input to game
-    update( game, inputs );
+    // The trainer moves the paddle by the size of the only output
+    float output = ffnNetworkGetOutputValue( net, 0 );
+    inputs.left  = output > 0 ? output : output < 0 ? -output : 0;
+    inputs.right = 0;
 
-    snprintf( imageFilename, FILENAME_LEN, "brains/%s_%010d.jpg", strGeneration, count );
-    canvasSaveJpeg( c, imageFilename, 255 );
-
-    count++;
+    // Send input to game for as many steps as the trainer does, every step
+    //  is saved
+    uint32_t step;
+    for( step = 0; step < actionRepeat && !game->game_over &&
+	   (maxFrames < 0 || count < maxFrames); step++ ) {
+      if( saveImages ) {
+	if( step > 0 ) {
+	  paintCanvas( c, game );
+	}
+	snprintf( imageFilename, FILENAME_LEN, "brains/%s_%010d.jpg", strGeneration, count );
+	canvasSaveJpeg( c, imageFilename, 255 );
+      }
+      update( game, inputs );
+      count++;
+    }
   }
 
+  printf( "Score %d after %d frames\n", game->score, count );
   destroyArkanoid(game);
   
   return 0;
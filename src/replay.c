@@ -0,0 +1,195 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every log starts with this, the last byte is the format version
+static const char replayMagic[8] = {'A', 'R', 'K', 'R', 'E', 'P', 'L', 2};
+
+// Runs are added this many at a time
+#define RUNS_CHUNK 256
+
+typedef struct replay_file_s {
+  FILE *file;
+  bool  failed;
+} replay_file_t;
+
+// Episode header as it's stored, followed by numRuns runs
+typedef struct replay_header_s {
+  uint32_t seed;
+  uint32_t generation;
+  uint32_t individual;
+  uint32_t round;
+  uint32_t gameSeed;
+  int32_t  maxRounds;
+  int32_t  score;
+  uint32_t numRuns;
+  uint32_t fixedPoint;
+  // Always 0, keeps numFrames where it would be anyway
+  uint32_t reserved;
+  uint64_t numFrames;
+} replay_header_t;
+
+void replayEpisodeBegin( replay_episode_t *episode, uint32_t gameSeed, int32_t maxRounds, bool fixedPoint )
+{
+  episode->gameSeed = gameSeed;
+  episode->maxRounds = maxRounds;
+  episode->fixedPoint = fixedPoint;
+  episode->score = 0;
+  episode->numFrames = 0;
+  episode->numRuns = 0;
+}
+
+bool replayEpisodeAddInput( replay_episode_t *episode, input_t input, uint32_t count )
+{
+  if( count == 0 ) {
+    return true;
+  }
+
+  if( episode->numRuns > 0 ) {
+    replay_run_t *last = &episode->runs[episode->numRuns - 1];
+    if( last->left == input.left && last->right == input.right && last->count <= UINT32_MAX - count ) {
+      last->count += count;
+      episode->numFrames += count;
+      return true;
+    }
+  }
+
+  if( episode->numRuns == episode->maxRuns ) {
+    replay_run_t *runs = realloc( episode->runs, sizeof(replay_run_t) * (episode->maxRuns + RUNS_CHUNK) );
+    if( runs == NULL ) {
+      return false;
+    }
+    episode->runs = runs;
+    episode->maxRuns += RUNS_CHUNK;
+  }
+
+  episode->runs[episode->numRuns++] = (replay_run_t) {count, input.left, input.right};
+  episode->numFrames += count;
+  return true;
+}
+
+input_t replayRunInput( const replay_run_t *run )
+{
+  input_t input = {0, };
+  input.left = run->left;
+  input.right = run->right;
+  return input;
+}
+
+void replayEpisodeFree( replay_episode_t *episode )
+{
+  free( episode->runs );
+  memset( episode, 0, sizeof(*episode) );
+}
+
+static replay_file_t *openFile( const char *filename, const char *mode )
+{
+  replay_file_t *file = calloc( 1, sizeof(replay_file_t) );
+  if( file == NULL ) {
+    return NULL;
+  }
+
+  file->file = fopen( filename, mode );
+  if( file->file == NULL ) {
+    free( file );
+    return NULL;
+  }
+
+  return file;
+}
+
+replay_file_t *replayCreate( const char *filename )
+{
+  replay_file_t *file = openFile( filename, "wb" );
+  if( file == NULL ) {
+    return NULL;
+  }
+
+  if( fwrite( replayMagic, sizeof(replayMagic), 1, file->file ) != 1 ) {
+    replayClose( file );
+    return NULL;
+  }
+
+  return file;
+}
+
+replay_file_t *replayOpen( const char *filename )
+{
+  char magic[sizeof(replayMagic)];
+  replay_file_t *file = openFile( filename, "rb" );
+  if( file == NULL ) {
+    return NULL;
+  }
+
+  if( fread( magic, sizeof(magic), 1, file->file ) != 1 ||
+      memcmp( magic, replayMagic, sizeof(magic) ) != 0 ) {
+    replayClose( file );
+    return NULL;
+  }
+
+  return file;
+}
+
+bool replayWrite( replay_file_t *file, const replay_episode_t *episode )
+{
+  replay_header_t header = {
+    episode->seed, episode->generation, episode->individual, episode->round,
+    episode->gameSeed, episode->maxRounds, episode->score, episode->numRuns,
+    episode->fixedPoint, 0, episode->numFrames
+  };
+
+  if( fwrite( &header, sizeof(header), 1, file->file ) != 1 ||
+      fwrite( episode->runs, sizeof(replay_run_t), episode->numRuns, file->file ) != episode->numRuns ) {
+    file->failed = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool replayRead( replay_file_t *file, replay_episode_t *episode )
+{
+  replay_header_t header;
+
+  if( fread( &header, sizeof(header), 1, file->file ) != 1 ) {
+    return false;
+  }
+
+  if( header.numRuns > episode->maxRuns ) {
+    replay_run_t *runs = realloc( episode->runs, sizeof(replay_run_t) * header.numRuns );
+    if( runs == NULL ) {
+      return false;
+    }
+    episode->runs = runs;
+    episode->maxRuns = header.numRuns;
+  }
+
+  if( fread( episode->runs, sizeof(replay_run_t), header.numRuns, file->file ) != header.numRuns ) {
+    return false;
+  }
+
+  episode->seed = header.seed;
+  episode->generation = header.generation;
+  episode->individual = header.individual;
+  episode->round = header.round;
+  episode->gameSeed = header.gameSeed;
+  episode->maxRounds = header.maxRounds;
+  episode->fixedPoint = header.fixedPoint != 0;
+  episode->score = header.score;
+  episode->numFrames = header.numFrames;
+  episode->numRuns = header.numRuns;
+  return true;
+}
+
+bool replayClose( replay_file_t *file )
+{
+  bool ok = !file->failed;
+
+  if( fclose( file->file ) != 0 ) {
+    ok = false;
+  }
+  free( file );
+  return ok;
+}
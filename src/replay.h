@@ -0,0 +1,79 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+
+// Records games as the seed they were created with and the inputs they got
+//  every frame, which is all it takes to play them again exactly, without
+//  the networks that played them.  Arkanoid only looks at left and right, so
+//  those are the only inputs kept.  Inputs are stored as runs of frames with
+//  the same input since the networks tend to hold the same output for a
+//  while.
+
+typedef struct replay_run_s {
+  // Number of frames in a row that got this input
+  uint32_t count;
+  float    left;
+  float    right;
+} replay_run_t;
+
+typedef struct replay_episode_s {
+  // Where the game came from, the trainer seed, generation, network and
+  //  which of its rounds it was
+  uint32_t      seed;
+  uint32_t      generation;
+  uint32_t      individual;
+  uint32_t      round;
+
+  // What the game was created with
+  uint32_t      gameSeed;
+  int32_t       maxRounds;
+  bool          fixedPoint;
+
+  // Score at the end of the game, to check the replay against
+  int32_t       score;
+  uint64_t      numFrames;
+
+  uint32_t      numRuns;
+  uint32_t      maxRuns;
+  replay_run_t *runs;
+} replay_episode_t;
+
+// Start recording a game created with <gameSeed>, <maxRounds> and fixed
+//  point physics if <fixedPoint> is set, anything recorded in <episode>
+//  before is forgotten.
+void replayEpisodeBegin( replay_episode_t *episode, uint32_t gameSeed, int32_t maxRounds, bool fixedPoint );
+
+// Add <input> for the next <count> frames.  Returns false if there's no
+//  memory left for it.
+bool replayEpisodeAddInput( replay_episode_t *episode, input_t input, uint32_t count );
+
+// The input to give a game for every frame of <run>
+input_t replayRunInput( const replay_run_t *run );
+
+// Free the inputs of <episode> and clear it.
+void replayEpisodeFree( replay_episode_t *episode );
+
+typedef struct replay_file_s replay_file_t;
+
+// Create a replay log at <filename>, or open an existing one for reading.
+//  Return NULL if the file can't be opened or isn't a replay log.
+replay_file_t *replayCreate( const char *filename );
+replay_file_t *replayOpen( const char *filename );
+
+// Append <episode> to a log made by replayCreate().  Returns false if it
+//  couldn't be written.
+bool replayWrite( replay_file_t *file, const replay_episode_t *episode );
+
+// Read the next episode from a log opened by replayOpen() into <episode>,
+//  which has to be cleared or hold an earlier episode.  Returns false at the
+//  end of the log or if it's broken.
+bool replayRead( replay_file_t *file, replay_episode_t *episode );
+
+// Returns false if anything couldn't be written.
+bool replayClose( replay_file_t *file );
+
+#endif
@@ -1,11 +1,787 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 #include "game.h"
 #include "arkanoid.h"
+#include "arkanoid_batch.h"
+
+// Games played by the painter test and how long each may last.  Painting a
+//  full redraw takes longer than playing, so screens are only compared this
+//  often and on the frames where blocks change and the one after.
+#define PAINTER_GAMES 10
+#define PAINTER_MAX_ROUNDS 20000
+#define PAINTER_CHECK_INTERVAL 61
+
+// Games stepped together by the batch test, how long they may last and how
+//  often their screens are compared, drawing them all every step takes a
+//  while.  Most games only clear a level after a hundred thousand rounds.
+#define BATCH_GAMES 16
+#define BATCH_MAX_ROUNDS 300000
+#define BATCH_DRAW_INTERVAL 997
+
+// Steps the action repeat test plays with every input
+#define REPEAT_STEPS 3
+
+// Games played through an interface without step() and step_batch() by the
+//  fallback test, and for how many inputs
+#define FALLBACK_GAMES 4
+#define FALLBACK_INPUTS 2000
+
+// The snapshot test plays this far before taking a snapshot and then plays
+//  on from it for at most this many frames
+#define SNAPSHOT_FRAME 1000
+#define SNAPSHOT_BRANCH 5000
+
+// Games played by the fast forward test, which holds every input for up to
+//  this many steps
+#define FAST_FORWARD_GAMES 50
+#define FAST_FORWARD_STEPS 64
+
+// Fixed point games played by the fixed point test and the checksum of every
+//  snapshot they go through, which is the same with any compiler or flags.
+//  Snapshots are hashed as bytes, so this only holds on little endian CPUs.
+#define FIXED_GAMES 5
+#define FIXED_CHECKSUM 0x326a688a9b7a7a03ULL
+
+// Downscaled screens are checked against averages of the full screen, which
+//  add up in a different order
+#define SCALED_TOLERANCE 1e-5
+
+// Every test goes through the generic game interface where it can, the rest
+//  are Arkanoid's own parts such as the state sensor layout, fast forward
+//  stops and the batched engine
+static const game_interface_t *gameInterface = &arkanoidInterface;
+
+// Pixel <i> of <screen> whatever its type
+static float pixel( const sensor_t *screen, uint32_t i )
+{
+  if( screen->type == sensor_type_uint8 ) {
+    return screen->data_u8[i] * screen->scale;
+  }
+  return screen->data[i];
+}
+
+#define BALL_VALUE 0.5
+
+// Move the paddle at random now and then
+static input_t addNoise( input_t input, unsigned int *seed )
+{
+  if( rand_r( seed ) % 4 == 0 ) {
+    input.left = rand_r( seed ) / (float)RAND_MAX;
+    input.right = rand_r( seed ) / (float)RAND_MAX;
+  }
+
+  return input;
+}
+
+// Mostly follow the ball so games last long enough to clear levels, with
+//  enough noise to make the paddle move around
+static input_t followBall( const sensor_t *screen, float paddleMiddle, unsigned int *seed )
+{
+  input_t input = {0, };
+  uint32_t i;
+
+  for( i = 0; i < screen->width * screen->height; i++ ) {
+    if( screen->data[i] == BALL_VALUE ) {
+      float ballX = i % screen->width;
+      if( ballX < paddleMiddle ) {
+	input.left = 1.0;
+      } else {
+	input.right = 1.0;
+      }
+      break;
+    }
+  }
+
+  return addNoise( input, seed );
+}
+
+// followBall() by the state sensor, which doesn't need a screen to be painted
+static input_t followBallState( const sensor_t *state, unsigned int *seed )
+{
+  input_t input = {0, };
+  float paddleMiddle = state->data[arkanoid_state_paddle_x] + state->data[arkanoid_state_paddle_width] / 2;
+
+  if( state->data[arkanoid_state_ball_x] < paddleMiddle ) {
+    input.left = 1.0;
+  } else {
+    input.right = 1.0;
+  }
+
+  return addNoise( input, seed );
+}
+
+// The paddle row is the only one with 0.75 pixels near the bottom
+static float findPaddle( const sensor_t *screen )
+{
+  uint32_t y = screen->height - 15;
+  uint32_t x, left = 0, right = 0;
+  for( x = 0; x < screen->width; x++ ) {
+    if( screen->data[y * screen->width + x] == 0.75 ) {
+      if( left == 0 ) {
+	left = x;
+      }
+      right = x;
+    }
+  }
+  return (left + right) / 2.0;
+}
+
+// True if <screen> is <expected> averaged over blocks of <scale> x <scale>
+//  pixels, or exactly the same when <scale> is 1.  A uint8 screen only has
+//  to be within rounding of it.
+static bool sameScreen( const sensor_t *screen, const sensor_t *expected, uint32_t scale )
+{
+  uint32_t x, y, i, j;
+  double tolerance = SCALED_TOLERANCE;
+
+  if( screen->type == sensor_type_uint8 ) {
+    tolerance += screen->scale / 2;
+  } else if( scale <= 1 ) {
+    return memcmp( screen->data, expected->data,
+		   sizeof(float) * screen->width * screen->height ) == 0;
+  }
+  scale = scale > 1 ? scale : 1;
+
+  for( y = 0; y < screen->height; y++ ) {
+    for( x = 0; x < screen->width; x++ ) {
+      double sum = 0;
+      for( j = 0; j < scale; j++ ) {
+	for( i = 0; i < scale; i++ ) {
+	  sum += expected->data[(y * scale + j) * expected->width + x * scale + i];
+	}
+      }
+      if( fabs( sum / (scale * scale) - pixel( screen, y * screen->width + x ) ) > tolerance ) {
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// True if the painter should be checked against a full redraw at <frame>,
+//  which is every PAINTER_CHECK_INTERVAL frames and whenever the blocks in
+//  <state> differ from <blocks> or did in the frame before.  <blocks> and
+//  <changed> are kept up to date for the next frame.
+static bool checkFrame( uint64_t frame, const sensor_t *state, float *blocks, bool *changed )
+{
+  const float *current = state->data + arkanoid_state_blocks;
+  bool changedNow = memcmp( blocks, current, sizeof(float) * ARKANOID_NUM_BLOCKS ) != 0;
+  bool check = changedNow || *changed || frame % PAINTER_CHECK_INTERVAL == 0;
+
+  memcpy( blocks, current, sizeof(float) * ARKANOID_NUM_BLOCKS );
+  *changed = changedNow;
+  return check;
+}
+
+// Play games with the incremental painter at <scale> and the full redraw at
+//  full resolution in lockstep and make sure the screens never differ
+static int testPainter( uint32_t scale, sensor_type_t type, int numGames )
+{
+  arkanoid_options_t options = {0, };
+  arkanoid_options_t fullOptions = {0, };
+  options.sensor_scale = scale;
+  options.sensor_type = type;
+  fullOptions.full_redraw = true;
+  uint64_t totalFrames = 0;
+  int g;
+
+  for( g = 0; g < numGames; g++ ) {
+    unsigned int seed = g + 1;
+    game_t *game = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, g, &options );
+    game_t *reference = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, g, &fullOptions );
+    if( game == NULL || reference == NULL ) {
+      fprintf( stderr, "Unable to initialise game\n" );
+      return -1;
+    }
+
+    float blocks[ARKANOID_NUM_BLOCKS] = {0, };
+    bool changed = false;
+    uint64_t frame = 0;
+    while( game->game_over == false ) {
+      // The painter works on every frame, mistakes stay on the screen until
+      //  it's compared
+      const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+      const sensor_t *state = gameGetSensor( game, ARKANOID_SENSOR_STATE );
+      if( checkFrame( frame, state, blocks, &changed ) &&
+	  !sameScreen( screen, gameGetSensor( reference, ARKANOID_SENSOR_SCREEN ), scale ) ) {
+	fprintf( stderr, "Game %d frame %llu at scale %u%s differs from a full redraw\n",
+		 g, (unsigned long long)frame, scale, type == sensor_type_uint8 ? " in bytes" : "" );
+	return -1;
+      }
+
+      // Steer by the state so every scale plays the same games
+      input_t input = followBallState( state, &seed );
+      game->_update( game, input );
+      reference->_update( reference, input );
+      frame++;
+    }
+
+    if( reference->game_over == false || game->score != reference->score ) {
+      fprintf( stderr, "Game %d played differently\n", g );
+      return -1;
+    }
+
+    totalFrames += frame;
+    gameDestroy( reference );
+    gameDestroy( game );
+  }
+
+  printf( "Painter at scale %u%s matches full redraws over %llu frames\n",
+	  scale, type == sensor_type_uint8 ? " in bytes" : "", (unsigned long long)totalFrames );
+  return 0;
+}
+
+// Make sure the game has every entry point its capabilities promise and that
+//  games know what kind they are
+static int testInterface( void )
+{
+  uint32_t caps = gameInterface->capabilities;
+  if( gameInterface->create == NULL || gameInterface->destroy == NULL ||
+      ((caps & GAME_CAP_RESET) && gameInterface->reset == NULL) ||
+      ((caps & GAME_CAP_SNAPSHOT) && gameInterface->clone == NULL) ||
+      ((caps & GAME_CAP_STEP) && gameInterface->step == NULL) ||
+      ((caps & GAME_CAP_BATCH) && gameInterface->step_batch == NULL) ) {
+    fprintf( stderr, "%s is missing entry points for its capabilities\n", gameInterface->name );
+    return -1;
+  }
+
+  game_t *game = gameCreate( gameInterface, -1, 1, NULL );
+  if( game == NULL ) {
+    fprintf( stderr, "Unable to initialise game\n" );
+    return -1;
+  }
+  game_t *clone = (caps & GAME_CAP_SNAPSHOT) ? gameClone( game ) : NULL;
+  if( game->game_interface != gameInterface ||
+      ((caps & GAME_CAP_SNAPSHOT) && (clone == NULL || clone->game_interface != gameInterface)) ) {
+    fprintf( stderr, "%s games don't point back at their interface\n", gameInterface->name );
+    return -1;
+  }
+  // Snapshots are part of the game itself
+  bool snapshots = game->_snapshot != NULL && game->_restore != NULL && game->snapshot_size > 0;
+  if( (caps & GAME_CAP_SNAPSHOT) ? !snapshots :
+      (game->_snapshot != NULL || game->_restore != NULL) ) {
+    fprintf( stderr, "%s games don't match their snapshot capability\n", gameInterface->name );
+    return -1;
+  }
+  gameDestroy( clone );
+  gameDestroy( game );
+
+  printf( "Interface of %s has capabilities 0x%x\n", gameInterface->name, caps );
+  return 0;
+}
+
+// Play games through a copy of the interface without step() and step_batch()
+//  next to games using the real one.  gameStep() and gameStepBatch() have to
+//  fall back to single updates that play exactly the same.
+static int testFallbacks( void )
+{
+  game_interface_t plain = *gameInterface;
+  plain.capabilities &= ~(GAME_CAP_STEP | GAME_CAP_BATCH);
+  plain.step = NULL;
+  plain.step_batch = NULL;
+
+  game_t *games[FALLBACK_GAMES];
+  game_t *references[FALLBACK_GAMES];
+  input_t inputs[FALLBACK_GAMES];
+  unsigned int seed = 1;
+  int g, i;
+
+  for( g = 0; g < FALLBACK_GAMES; g++ ) {
+    games[g] = gameCreate( &plain, -1, g, NULL );
+    references[g] = gameCreate( gameInterface, -1, g, NULL );
+    if( games[g] == NULL || references[g] == NULL ) {
+      fprintf( stderr, "Unable to initialise game\n" );
+      return -1;
+    }
+    // Games point at the interface that made them, which has step()
+    games[g]->game_interface = &plain;
+  }
+
+  for( i = 0; i < FALLBACK_INPUTS; i++ ) {
+    for( g = 0; g < FALLBACK_GAMES; g++ ) {
+      const sensor_t *screen = gameGetSensor( references[g], ARKANOID_SENSOR_SCREEN );
+      inputs[g] = followBall( screen, findPaddle( screen ), &seed );
+    }
+
+    // Every other input is a batch step, the rest are held for a while
+    if( i & 1 ) {
+      gameStepBatch( &plain, games, inputs, FALLBACK_GAMES );
+      for( g = 0; g < FALLBACK_GAMES; g++ ) {
+	if( !references[g]->game_over ) {
+	  references[g]->_update( references[g], inputs[g] );
+	}
+      }
+    } else {
+      uint32_t repeat = 1 + rand_r( &seed ) % REPEAT_STEPS;
+      for( g = 0; g < FALLBACK_GAMES; g++ ) {
+	if( gameStep( games[g], inputs[g], repeat ) !=
+	    gameStep( references[g], inputs[g], repeat ) ) {
+	  fprintf( stderr, "Fallback of gameStep() played a different number of steps\n" );
+	  return -1;
+	}
+      }
+    }
+
+    for( g = 0; g < FALLBACK_GAMES; g++ ) {
+      if( games[g]->score != references[g]->score ||
+	  games[g]->game_over != references[g]->game_over ) {
+	fprintf( stderr, "Fallbacks played game %d differently after %d inputs\n", g, i );
+	return -1;
+      }
+    }
+  }
+
+  for( g = 0; g < FALLBACK_GAMES; g++ ) {
+    gameDestroy( games[g] );
+    gameDestroy( references[g] );
+  }
+
+  printf( "Fallbacks of gameStep() and gameStepBatch() play the same over %d inputs\n", i );
+  return 0;
+}
+
+// Play a game and make sure the state sensor describes what's on the screen
+static int testStateSensor( void )
+{
+  unsigned int seed = 1;
+  uint64_t frame = 0;
+  game_t *game = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 0, NULL );
+  if( game == NULL || gameFindSensor( game, SENSOR_STATE ) != ARKANOID_SENSOR_STATE ) {
+    fprintf( stderr, "Unable to initialise game with a state sensor\n" );
+    return -1;
+  }
+
+  while( game->game_over == false ) {
+    const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+    const sensor_t *state = gameGetSensor( game, ARKANOID_SENSOR_STATE );
+    uint32_t ballX = state->data[arkanoid_state_ball_x] * screen->width;
+    uint32_t ballY = state->data[arkanoid_state_ball_y] * screen->height;
+    uint32_t paddleX = state->data[arkanoid_state_paddle_x] * screen->width;
+    uint32_t paddleWidth = state->data[arkanoid_state_paddle_width] * screen->width + 0.5;
+    float paddleMiddle = findPaddle( screen );
+
+    // Positions are fractions of the screen that may not round back exactly,
+    //  so look inside the ball and allow a pixel either way for the paddle
+    if( pixel( screen, (ballY + 1) * screen->width + ballX + 1 ) != BALL_VALUE ||
+	fabs( paddleMiddle - (paddleX + (paddleWidth - 1) / 2.0) ) > 1 ) {
+      fprintf( stderr, "State sensor doesn't match the screen at frame %llu\n",
+	       (unsigned long long)frame );
+      return -1;
+    }
+
+    game->_update( game, followBall( screen, paddleMiddle, &seed ) );
+    frame++;
+  }
+
+  gameDestroy( game );
+  printf( "State sensor matches the screen over %llu frames\n", (unsigned long long)frame );
+  return 0;
+}
+
+// Take a snapshot and a clone halfway through a game, play on, go back to
+//  the snapshot and replay the same inputs in the game and the clone.  Both
+//  have to play exactly as before and show the same screens, the game
+//  painting the changes from a screen it showed later on and the clone
+//  painting from scratch.
+static int testSnapshot( void )
+{
+  input_t inputs[SNAPSHOT_BRANCH];
+  int32_t scores[SNAPSHOT_BRANCH];
+  unsigned int seed = 1;
+  int frames = 0;
+  int i;
+
+  game_t *game = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 3, NULL );
+  if( game == NULL ) {
+    fprintf( stderr, "Unable to initialise game\n" );
+    return -1;
+  }
+  for( i = 0; i < SNAPSHOT_FRAME && !game->game_over; i++ ) {
+    const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+    game->_update( game, followBall( screen, findPaddle( screen ), &seed ) );
+  }
+
+  void *snapshot = malloc( game->snapshot_size );
+  game_t *clone = gameClone( game );
+  if( snapshot == NULL || clone == NULL ) {
+    fprintf( stderr, "Unable to clone game\n" );
+    return -1;
+  }
+  gameSnapshot( game, snapshot );
+
+  while( frames < SNAPSHOT_BRANCH && !game->game_over ) {
+    const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+    inputs[frames] = followBall( screen, findPaddle( screen ), &seed );
+    game->_update( game, inputs[frames] );
+    scores[frames++] = game->score;
+  }
+
+  gameRestore( game, snapshot );
+  for( i = 0; i < frames; i++ ) {
+    const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+    const sensor_t *cloneScreen = gameGetSensor( clone, ARKANOID_SENSOR_SCREEN );
+    if( memcmp( screen->data, cloneScreen->data, sizeof(float) * screen->width * screen->height ) != 0 ) {
+      fprintf( stderr, "Restored and cloned screens differ %d frames after the snapshot\n", i );
+      return -1;
+    }
+
+    game->_update( game, inputs[i] );
+    clone->_update( clone, inputs[i] );
+    if( game->score != scores[i] || clone->score != scores[i] ||
+	game->game_over != clone->game_over ) {
+      fprintf( stderr, "Restored or cloned game played differently %d frames after the snapshot\n", i );
+      return -1;
+    }
+  }
+
+  // Whatever is in the buffers, the same state gives the same bytes
+  void *cloneSnapshot = malloc( game->snapshot_size );
+  if( cloneSnapshot == NULL ) {
+    fprintf( stderr, "Unable to allocate snapshot\n" );
+    return -1;
+  }
+  memset( snapshot, 0x00, game->snapshot_size );
+  memset( cloneSnapshot, 0xff, game->snapshot_size );
+  gameSnapshot( game, snapshot );
+  gameSnapshot( clone, cloneSnapshot );
+  if( memcmp( snapshot, cloneSnapshot, game->snapshot_size ) != 0 ) {
+    fprintf( stderr, "Snapshots of the same state differ\n" );
+    return -1;
+  }
+
+  printf( "Snapshot of %u bytes replays the same %d frames\n", game->snapshot_size, frames );
+  gameDestroy( clone );
+  gameDestroy( game );
+  free( cloneSnapshot );
+  free( snapshot );
+  return 0;
+}
+
+// Play a game for a while, reset it and make sure it plays and looks the
+//  same as a new game with the same seed
+static int testReset( void )
+{
+  unsigned int seed = 1;
+  int i;
+
+  game_t *game = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 1, NULL );
+  game_t *fresh = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 5, NULL );
+  if( game == NULL || fresh == NULL ) {
+    fprintf( stderr, "Unable to initialise game\n" );
+    return -1;
+  }
+  for( i = 0; i < SNAPSHOT_FRAME && !game->game_over; i++ ) {
+    const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+    game->_update( game, followBall( screen, findPaddle( screen ), &seed ) );
+  }
+
+  gameReset( game, 5 );
+  uint64_t frame = 0;
+  while( !fresh->game_over ) {
+    const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+    const sensor_t *expected = gameGetSensor( fresh, ARKANOID_SENSOR_SCREEN );
+    if( game->game_over || game->score != fresh->score ||
+	memcmp( screen->data, expected->data, sizeof(float) * screen->width * screen->height ) != 0 ) {
+      fprintf( stderr, "Reset game differs from a new one at frame %llu\n", (unsigned long long)frame );
+      return -1;
+    }
+
+    input_t input = followBall( expected, findPaddle( expected ), &seed );
+    game->_update( game, input );
+    fresh->_update( fresh, input );
+    frame++;
+  }
+
+  if( !game->game_over || game->score != fresh->score ) {
+    fprintf( stderr, "Reset game ended differently\n" );
+    return -1;
+  }
+
+  gameDestroy( fresh );
+  gameDestroy( game );
+  printf( "Reset game matches a new one over %llu frames\n", (unsigned long long)frame );
+  return 0;
+}
+
+// Repeating an input has to be the same as sending it for every step, and
+//  stop when the game is over
+static int testActionRepeat( void )
+{
+  unsigned int seed = 1;
+  uint64_t steps = 0;
+
+  game_t *game = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 2, NULL );
+  game_t *reference = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 2, NULL );
+  if( game == NULL || reference == NULL ) {
+    fprintf( stderr, "Unable to initialise game\n" );
+    return -1;
+  }
+
+  while( !game->game_over ) {
+    const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+    input_t input = followBall( screen, findPaddle( screen ), &seed );
+    uint32_t played = gameStep( game, input, REPEAT_STEPS );
+    uint32_t i;
+    for( i = 0; i < REPEAT_STEPS && !reference->game_over; i++ ) {
+      reference->_update( reference, input );
+    }
+
+    const sensor_t *state = gameGetSensor( game, ARKANOID_SENSOR_STATE );
+    const sensor_t *expected = gameGetSensor( reference, ARKANOID_SENSOR_STATE );
+    if( played != i || game->score != reference->score || game->game_over != reference->game_over ||
+	memcmp( state->data, expected->data, sizeof(float) * state->width ) != 0 ) {
+      fprintf( stderr, "Repeated input plays differently after %llu steps\n", (unsigned long long)steps );
+      return -1;
+    }
+    steps += played;
+  }
+
+  gameDestroy( reference );
+  gameDestroy( game );
+  printf( "Action repeat of %d matches single steps over %llu steps\n",
+	  REPEAT_STEPS, (unsigned long long)steps );
+  return 0;
+}
+
+// Stop a fast forward once the score isn't <data> any more
+static bool scoreChanged( game_t *game, void *data )
+{
+  return game->score != *(int32_t *)data;
+}
+
+// Play a game with fastForwardArkanoid() and another one step by step with
+//  the same inputs and make sure they're always in exactly the same state,
+//  and that fast forwards stop on the step that scores
+static int testFastForward( bool fixedPoint )
+{
+  arkanoid_options_t options = {0, };
+  options.fixed_point = fixedPoint;
+  unsigned int seed = 1;
+  uint64_t steps = 0;
+  uint64_t stops = 0;
+  int g;
+
+  game_t *game = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 0, &options );
+  game_t *reference = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, 0, &options );
+  void *snapshot = game ? malloc( 2 * game->snapshot_size ) : NULL;
+  if( game == NULL || reference == NULL || snapshot == NULL ) {
+    fprintf( stderr, "Unable to initialise game\n" );
+    return -1;
+  }
+  void *expected = (char *)snapshot + game->snapshot_size;
+
+  for( g = 0; g < FAST_FORWARD_GAMES; g++ ) {
+    gameReset( game, g );
+    gameReset( reference, g );
+    while( !game->game_over ) {
+      const sensor_t *screen = gameGetSensor( reference, ARKANOID_SENSOR_SCREEN );
+      input_t input = followBall( screen, findPaddle( screen ), &seed );
+      uint32_t hold = 1 + rand_r( &seed ) % FAST_FORWARD_STEPS;
+      int32_t score = game->score;
+      uint32_t played = fastForwardArkanoid( game, input, hold, scoreChanged, &score );
+
+      int32_t lastScore = reference->score;
+      uint32_t i;
+      for( i = 0; i < played; i++ ) {
+	lastScore = reference->score;
+	reference->_update( reference, input );
+      }
+
+      gameSnapshot( game, snapshot );
+      gameSnapshot( reference, expected );
+      if( memcmp( snapshot, expected, game->snapshot_size ) != 0 ) {
+	fprintf( stderr, "Fast forward%s plays differently after %llu steps\n",
+		 fixedPoint ? " with fixed point" : "", (unsigned long long)steps );
+	return -1;
+      }
+      if( played < hold && !game->game_over ) {
+	if( lastScore != score || reference->score == score ) {
+	  fprintf( stderr, "Fast forward stopped after %llu steps without scoring\n",
+		   (unsigned long long)steps );
+	  return -1;
+	}
+	stops++;
+      }
+      steps += played;
+    }
+  }
+
+  free( snapshot );
+  gameDestroy( reference );
+  gameDestroy( game );
+  printf( "Fast forward%s matches single steps over %llu steps and %llu stops\n",
+	  fixedPoint ? " with fixed point" : "", (unsigned long long)steps, (unsigned long long)stops );
+  return 0;
+}
+
+// FNV-1a of <size> bytes at <data> added to <hash>
+static uint64_t hashBytes( uint64_t hash, const void *data, size_t size )
+{
+  const uint8_t *bytes = data;
+  size_t i;
+  for( i = 0; i < size; i++ ) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Play fixed point games and make sure every snapshot they go through is the
+//  one they went through when FIXED_CHECKSUM was taken, and that the painter
+//  still matches full redraws
+static int testFixedPoint( void )
+{
+  arkanoid_options_t options = {0, };
+  arkanoid_options_t fullOptions = {0, };
+  options.fixed_point = true;
+  fullOptions.fixed_point = true;
+  fullOptions.full_redraw = true;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  uint64_t totalFrames = 0;
+  int32_t totalScore = 0;
+  int g;
+
+  for( g = 0; g < FIXED_GAMES; g++ ) {
+    unsigned int seed = g + 1;
+    game_t *game = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, g, &options );
+    game_t *reference = gameCreate( gameInterface, PAINTER_MAX_ROUNDS, g, &fullOptions );
+    void *snapshot = game ? malloc( game->snapshot_size ) : NULL;
+    if( game == NULL || reference == NULL || snapshot == NULL ) {
+      fprintf( stderr, "Unable to initialise game\n" );
+      return -1;
+    }
+
+    float blocks[ARKANOID_NUM_BLOCKS] = {0, };
+    bool changed = false;
+    uint64_t frame = 0;
+    while( !game->game_over ) {
+      const sensor_t *screen = gameGetSensor( game, ARKANOID_SENSOR_SCREEN );
+      const sensor_t *state = gameGetSensor( game, ARKANOID_SENSOR_STATE );
+      if( checkFrame( frame, state, blocks, &changed ) &&
+	  !sameScreen( screen, gameGetSensor( reference, ARKANOID_SENSOR_SCREEN ), 1 ) ) {
+	fprintf( stderr, "Fixed point game %d frame %llu differs from a full redraw\n",
+		 g, (unsigned long long)frame );
+	return -1;
+      }
+
+      gameSnapshot( game, snapshot );
+      hash = hashBytes( hash, snapshot, game->snapshot_size );
+
+      input_t input = followBall( screen, findPaddle( screen ), &seed );
+      game->_update( game, input );
+      reference->_update( reference, input );
+      frame++;
+    }
+
+    if( !reference->game_over || game->score != reference->score ) {
+      fprintf( stderr, "Fixed point game %d played differently\n", g );
+      return -1;
+    }
+
+    totalScore += game->score;
+    totalFrames += frame;
+    free( snapshot );
+    gameDestroy( reference );
+    gameDestroy( game );
+  }
+
+  if( hash != FIXED_CHECKSUM ) {
+    fprintf( stderr, "Fixed point games went differently, checksum 0x%016llx\n", (unsigned long long)hash );
+    return -1;
+  }
+
+  printf( "Fixed point games scored %d over %llu frames as expected\n",
+	  totalScore, (unsigned long long)totalFrames );
+  return 0;
+}
+
+// Step a batch and separate games, through gameStepBatch(), with the same
+//  seeds and inputs in lockstep and make sure they never differ
+static int testBatch( void )
+{
+  unsigned int seeds[BATCH_GAMES];
+  game_t *games[BATCH_GAMES];
+  input_t inputs[BATCH_GAMES];
+  float state[ARKANOID_STATE_SIZE];
+  float *pixels = malloc( sizeof(float) * ARKANOID_SCREEN_WIDTH * ARKANOID_SCREEN_HEIGHT );
+  unsigned int inputSeed = 1;
+  uint64_t frame = 0;
+  uint32_t g;
+
+  for( g = 0; g < BATCH_GAMES; g++ ) {
+    seeds[g] = g * 7919;
+    games[g] = gameCreate( gameInterface, BATCH_MAX_ROUNDS, seeds[g], NULL );
+    if( games[g] == NULL ) {
+      fprintf( stderr, "Unable to initialise game\n" );
+      return -1;
+    }
+  }
+  arkanoid_batch_t *batch = createArkanoidBatch( BATCH_GAMES, BATCH_MAX_ROUNDS, seeds );
+  if( batch == NULL || pixels == NULL ) {
+    fprintf( stderr, "Unable to initialise batch\n" );
+    return -1;
+  }
+
+  while( batch->num_running > 0 ) {
+    for( g = 0; g < BATCH_GAMES; g++ ) {
+      const sensor_t *expected = gameGetSensor( games[g], ARKANOID_SENSOR_STATE );
+      getArkanoidBatchState( batch, g, state );
+      if( batch->game_over[g] != games[g]->game_over ||
+	  batch->scores[g] != games[g]->score ||
+	  memcmp( state, expected->data, sizeof(state) ) != 0 ) {
+	fprintf( stderr, "Batched game %u differs at frame %llu\n", g, (unsigned long long)frame );
+	return -1;
+      }
+
+      if( frame % BATCH_DRAW_INTERVAL == 0 && !batch->game_over[g] ) {
+	const sensor_t *screen = gameGetSensor( games[g], ARKANOID_SENSOR_SCREEN );
+	drawArkanoidBatch( batch, g, pixels, ARKANOID_SCREEN_WIDTH );
+	if( memcmp( pixels, screen->data, sizeof(float) * screen->width * screen->height ) != 0 ) {
+	  fprintf( stderr, "Batched game %u is drawn differently at frame %llu\n",
+		   g, (unsigned long long)frame );
+	  return -1;
+	}
+      }
+
+      // Follow the ball most of the time so games go on for a while
+      inputs[g] = (input_t) {0, };
+      if( rand_r( &inputSeed ) % 4 == 0 ) {
+	inputs[g].left = rand_r( &inputSeed ) / (float)RAND_MAX;
+	inputs[g].right = rand_r( &inputSeed ) / (float)RAND_MAX;
+      } else if( expected->data[arkanoid_state_ball_x] <
+		 expected->data[arkanoid_state_paddle_x] + expected->data[arkanoid_state_paddle_width] / 2 ) {
+	inputs[g].left = 1.0;
+      } else {
+	inputs[g].right = 1.0;
+      }
+    }
+
+    gameStepBatch( gameInterface, games, inputs, BATCH_GAMES );
+    simulateArkanoidBatch( batch, inputs );
+    frame++;
+  }
+
+  for( g = 0; g < BATCH_GAMES; g++ ) {
+    if( !games[g]->game_over ) {
+      fprintf( stderr, "Batched game %u ended early\n", g );
+      return -1;
+    }
+    gameDestroy( games[g] );
+  }
+  destroyArkanoidBatch( batch );
+  free( pixels );
+
+  printf( "Batch of %d games matches separate games over %llu frames\n",
+	  BATCH_GAMES, (unsigned long long)frame );
+  return 0;
+}
 
 int main( void )
 {
-  game_t *game = createArkanoid( -1, 1 );
+  game_t *game = gameCreate( gameInterface, -1, 1, NULL );
   if( game == NULL ) {
     fprintf( stderr, "Unable to initialise game\n" );
     return -1;
@@ -14,13 +790,32 @@ int main( void )
   printf( "Game created\n" );
   while( game->game_over == false ) {
     input_t input = {0, };
-    
+
     game->_update( game, input );
+    // Paint the screen too, it's only done when asked for
+    gameGetSensor( game, 0 );
   }
 
   printf( "Destroying game\n" );
 
-  destroyArkanoid( game );
+  gameDestroy( game );
+
+  if( testInterface() != 0 ||
+      testFallbacks() != 0 ||
+      testStateSensor() != 0 ||
+      testSnapshot() != 0 ||
+      testReset() != 0 ||
+      testActionRepeat() != 0 ||
+      testFixedPoint() != 0 ||
+      testFastForward( false ) != 0 ||
+      testFastForward( true ) != 0 ||
+      testBatch() != 0 ||
+      testPainter( 1, sensor_type_float, PAINTER_GAMES ) != 0 ||
+      testPainter( 8, sensor_type_float, PAINTER_GAMES / 5 ) != 0 ||
+      testPainter( 1, sensor_type_uint8, PAINTER_GAMES / 5 ) != 0 ||
+      testPainter( 4, sensor_type_uint8, PAINTER_GAMES / 5 ) != 0 ) {
+    return -1;
+  }
 
   return 0;
 }
@@ -0,0 +1,209 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+// Events per thread, a power of two
+#define RING_SIZE 16384
+
+// How often the writer thread empties the rings
+#define DRAIN_INTERVAL_NS 10000000
+
+typedef struct trace_event_s {
+  const char *name;
+  const char *argName;
+  uint64_t    start;
+  uint64_t    end;
+  int64_t     arg;
+} trace_event_t;
+
+// Single producer, single consumer.  Only the owning thread moves head and only
+//  the writer moves tail.
+typedef struct trace_ring_s {
+  trace_event_t  events[RING_SIZE];
+  uint64_t       head;
+  uint64_t       tail;
+  uint64_t       dropped;
+  int            tid;
+
+  // Rings outlive their threads so nothing is lost when a thread quits
+  struct trace_ring_s *next;
+} trace_ring_t;
+
+static __thread trace_ring_t *localRing = NULL;
+
+static trace_ring_t *rings = NULL;
+static int numRings = 0;
+static pthread_mutex_t ringsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool enabled = false;
+static bool stopWriter = false;
+static pthread_t writerThread;
+static FILE *traceFile = NULL;
+static bool firstEvent = true;
+static uint64_t startTime;
+
+static uint64_t nowNs( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static trace_ring_t *createRing( void )
+{
+  trace_ring_t *ring = calloc( 1, sizeof(trace_ring_t) );
+  if( ring == NULL ) {
+    return NULL;
+  }
+
+  pthread_mutex_lock( &ringsMutex );
+  ring->tid = ++numRings;
+  ring->next = rings;
+  rings = ring;
+  pthread_mutex_unlock( &ringsMutex );
+
+  return ring;
+}
+
+static void writeEvent( const trace_ring_t *ring, const trace_event_t *event )
+{
+  // Timestamps are in microseconds since traceOpen()
+  fprintf( traceFile, "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+	   "\"ts\": %.3f, \"dur\": %.3f",
+	   firstEvent ? "" : ",", event->name, ring->tid,
+	   (event->start - startTime) * 1e-3, (event->end - event->start) * 1e-3 );
+  if( event->argName != NULL ) {
+    fprintf( traceFile, ", \"args\": {\"%s\": %lld}", event->argName, (long long)event->arg );
+  }
+  fprintf( traceFile, "}" );
+  firstEvent = false;
+}
+
+// Write every event that's been published so far.  Only the writer thread,
+//  or traceClose() once it's gone, calls this.
+static void drainRings( void )
+{
+  trace_ring_t *ring;
+
+  pthread_mutex_lock( &ringsMutex );
+  for( ring = rings; ring != NULL; ring = ring->next ) {
+    uint64_t head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+    uint64_t tail = ring->tail;
+
+    for( ; tail != head; tail++ ) {
+      writeEvent( ring, &ring->events[tail & (RING_SIZE - 1)] );
+    }
+    __atomic_store_n( &ring->tail, tail, __ATOMIC_RELEASE );
+  }
+  pthread_mutex_unlock( &ringsMutex );
+}
+
+static void *writer( void *arg )
+{
+  struct timespec interval = {0, DRAIN_INTERVAL_NS};
+
+  while( !__atomic_load_n( &stopWriter, __ATOMIC_ACQUIRE ) ) {
+    drainRings();
+    nanosleep( &interval, NULL );
+  }
+
+  return NULL;
+}
+
+bool traceOpen( const char *filename )
+{
+  traceFile = fopen( filename, "w" );
+  if( traceFile == NULL ) {
+    return false;
+  }
+
+  fprintf( traceFile, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" );
+  firstEvent = true;
+  startTime = nowNs();
+  stopWriter = false;
+
+  if( pthread_create( &writerThread, NULL, writer, NULL ) != 0 ) {
+    fclose( traceFile );
+    traceFile = NULL;
+    return false;
+  }
+
+  enabled = true;
+  return true;
+}
+
+bool traceEnabled( void )
+{
+  return enabled;
+}
+
+uint64_t traceNow( void )
+{
+  return enabled ? nowNs() : 0;
+}
+
+void traceSpan( const char *name, uint64_t start, uint64_t end, const char *argName, int64_t arg )
+{
+  if( !enabled ) {
+    return;
+  }
+
+  if( localRing == NULL ) {
+    localRing = createRing();
+    if( localRing == NULL ) {
+      return;
+    }
+  }
+
+  trace_ring_t *ring = localRing;
+  uint64_t head = ring->head;
+  if( head - __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE ) >= RING_SIZE ) {
+    __atomic_fetch_add( &ring->dropped, 1, __ATOMIC_RELAXED );
+    return;
+  }
+
+  trace_event_t *event = &ring->events[head & (RING_SIZE - 1)];
+  event->name = name;
+  event->argName = argName;
+  event->start = start;
+  event->end = end;
+  event->arg = arg;
+
+  // Publish the event to the writer
+  __atomic_store_n( &ring->head, head + 1, __ATOMIC_RELEASE );
+}
+
+void traceClose( void )
+{
+  trace_ring_t *ring;
+  uint64_t dropped = 0;
+
+  if( !enabled ) {
+    return;
+  }
+
+  __atomic_store_n( &stopWriter, true, __ATOMIC_RELEASE );
+  pthread_join( writerThread, NULL );
+  enabled = false;
+  drainRings();
+
+  pthread_mutex_lock( &ringsMutex );
+  for( ring = rings; ring != NULL; ring = ring->next ) {
+    dropped += ring->dropped;
+  }
+  pthread_mutex_unlock( &ringsMutex );
+
+  fprintf( traceFile, "\n], \"otherData\": {\"dropped_spans\": %llu}}\n", (unsigned long long)dropped );
+  fclose( traceFile );
+  traceFile = NULL;
+
+  if( dropped > 0 ) {
+    fprintf( stderr, "Trace is missing %llu spans, the ring buffers were full\n",
+	     (unsigned long long)dropped );
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Records spans of work per thread and writes them as Chrome trace-event JSON,
+//  which can be loaded in chrome://tracing or Perfetto.  Every thread writes to
+//  its own lock-free ring buffer that a background thread drains to the file.
+//  Spans are dropped, and counted, when a ring fills up faster than it's
+//  drained.
+
+// Start tracing to <filename>.  Returns false if the file or the writer thread
+//  can't be created.
+bool traceOpen( const char *filename );
+
+// Returns true between traceOpen() and traceClose()
+bool traceEnabled( void );
+
+// Monotonic time in nanoseconds to pass to traceSpan(), or 0 when tracing is
+//  off so callers don't have to check first.
+uint64_t traceNow( void );
+
+// Record a span called <name> that ran from <start> to <end> on the calling
+//  thread.  <argName> can be NULL, otherwise <arg> is added to the span under
+//  that name.  Both strings have to stay valid until traceClose(), literals
+//  are fine.  Does nothing when tracing is off.
+void traceSpan( const char *name, uint64_t start, uint64_t end, const char *argName, int64_t arg );
+
+// Write everything that's left, stop the writer thread and close the file.
+void traceClose( void );
+
+#endif